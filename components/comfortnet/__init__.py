@@ -7,20 +7,43 @@ from esphome.const import (
     CONF_ID,
     CONF_TRIGGER_ID,
 )
+from esphome.core import CORE
 from esphome.cpp_helpers import gpio_pin_expression
+from esphome.helpers import fnv1a_32bit_hash
 
 DEPENDENCIES = ["uart"]
+MULTI_CONF = 4
+
+DOMAIN = "comfortnet"
 
 CONF_CT_VERSION = "ct_version"
 CONF_DEVICE_TYPE = "device_type"
+CONF_FRAME_BRIDGE_PORT = "frame_bridge_port"
+CONF_LISTEN_ONLY = "listen_only"
 CONF_SENSOR_KEY = "data_key"
 CONF_TARGET_DEVICE_TYPE = "target_device_type"
 CONF_ON_CONTROL_COMMAND = "on_control_command"
 CONF_CONTROL_COMMAND = "control_command"
 CONF_ON_PACKET = "on_packet"
 CONF_PACKET_TYPE = "packet_type"
+CONF_PROFILING = "profiling"
+CONF_SLOW_LOOP_THRESHOLD = "slow_loop_threshold"
 CONF_REGISTER_PACKET_POLL = "register_polling"
 CONF_PACKET_POLL_ONCE = "poll_once"
+CONF_PACKET_POLL_INTERVAL = "poll_interval"
+CONF_REPLY_DELAY = "reply_delay"
+CONF_SHARED_DATA = "shared_data"
+
+
+def AUTO_LOAD():
+    # Only the frame bridge needs sockets, so leave them out unless a bus uses it
+    confs = CORE.raw_config.get(DOMAIN, [])
+    if isinstance(confs, dict):
+        confs = [confs]
+    if any(CONF_FRAME_BRIDGE_PORT in conf for conf in confs if isinstance(conf, dict)):
+        return ["socket"]
+    return []
+
 
 comfortnet_ns = cg.esphome_ns.namespace("comfortnet")
 Comfortnet = comfortnet_ns.class_("Comfortnet", cg.Component, uart.UARTDevice)
@@ -51,6 +74,19 @@ CONFIG_SCHEMA = (
             cv.Optional(CONF_CT_VERSION, default=2): cv.int_range(min=1, max=2),
             cv.Optional(CONF_DEVICE_TYPE, default=0x1E): cv.int_range(min=1, max=255),
             cv.Optional(CONF_FLOW_CONTROL_PIN): pins.gpio_output_pin_schema,
+            cv.Optional(CONF_FRAME_BRIDGE_PORT): cv.port,
+            cv.Optional(CONF_LISTEN_ONLY, default=False): cv.boolean,
+            cv.Optional(
+                CONF_REPLY_DELAY, default="10ms"
+            ): cv.positive_time_period_milliseconds,
+            cv.Optional(CONF_SHARED_DATA, default=True): cv.boolean,
+            cv.Optional(CONF_PROFILING): cv.Schema(
+                {
+                    cv.Optional(
+                        CONF_SLOW_LOOP_THRESHOLD, default="20ms"
+                    ): cv.positive_time_period_microseconds,
+                }
+            ),
             cv.Optional(CONF_ON_CONTROL_COMMAND): automation.validate_automation(
                 {
                     cv.GenerateID(CONF_TRIGGER_ID): cv.declare_id(
@@ -72,6 +108,9 @@ CONFIG_SCHEMA = (
                     cv.Optional(CONF_TARGET_DEVICE_TYPE, default=0): cv.uint8_t,
                     cv.Optional(CONF_REGISTER_PACKET_POLL, default=False): cv.boolean,
                     cv.Optional(CONF_PACKET_POLL_ONCE, default=False): cv.boolean,
+                    cv.Optional(
+                        CONF_PACKET_POLL_INTERVAL
+                    ): cv.positive_time_period_milliseconds,
                 },
                 extra_validators=lambda *args, **kwargs: assign_declare_id(
                     ComfortnetPacketTrigger, *args, **kwargs
@@ -93,15 +132,46 @@ COMFORTNET_CLIENT_SCHEMA = cv.Schema(
 )
 
 
+def validate_control_command_target(config):
+    if CONF_CONTROL_COMMAND in config and config[CONF_TARGET_DEVICE_TYPE] == 0:
+        raise cv.Invalid(
+            f"{CONF_CONTROL_COMMAND} needs a {CONF_TARGET_DEVICE_TYPE} to send the command to"
+        )
+    return config
+
+
 async def to_code(config):
     var = cg.new_Pvariable(config[CONF_ID])
     await cg.register_component(var, config)
     await uart.register_uart_device(var, config)
+    bus_count = len(CORE.config[DOMAIN])
+    cg.add_define("COMFORTNET_BUS_COUNT", bus_count)
+    if bus_count > 1:
+        # Keep each bus's saved state apart, while a lone bus keeps the keys it always had
+        cg.add(var.set_preference_salt(fnv1a_32bit_hash(str(config[CONF_ID]))))
     cg.add(var.set_device_type(config[CONF_DEVICE_TYPE]))
     cg.add(var.set_ct_version(config[CONF_CT_VERSION]))
+    cg.add(var.set_listen_only(config[CONF_LISTEN_ONLY]))
+    cg.add(var.set_reply_delay(config[CONF_REPLY_DELAY]))
+    if CONF_FRAME_BRIDGE_PORT in config:
+        cg.add_define("USE_COMFORTNET_FRAME_BRIDGE")
+        cg.add(var.set_frame_bridge_port(config[CONF_FRAME_BRIDGE_PORT]))
+    if CONF_PROFILING in config:
+        cg.add_define("USE_COMFORTNET_PROFILING")
+        cg.add(
+            var.set_slow_loop_threshold(
+                config[CONF_PROFILING][CONF_SLOW_LOOP_THRESHOLD]
+            )
+        )
+    if config[CONF_SHARED_DATA] and not config[CONF_LISTEN_ONLY]:
+        # Only nodes that join the network are asked to keep other nodes' shared data. The define is global, so
+        # every bus in the firmware carries the storage once one of them needs it.
+        cg.add_define("USE_COMFORTNET_SHARED_DATA")
     if CONF_FLOW_CONTROL_PIN in config:
         pin = await gpio_pin_expression(config[CONF_FLOW_CONTROL_PIN])
         cg.add(var.set_flow_control_pin(pin))
+    if CONF_ON_CONTROL_COMMAND in config:
+        cg.add_define("USE_COMFORTNET_COMMAND_LISTENERS")
     for conf in config.get(CONF_ON_CONTROL_COMMAND, []):
         trigger = cg.new_Pvariable(
             conf[CONF_TRIGGER_ID],
@@ -114,6 +184,8 @@ async def to_code(config):
             [(ComfortnetCommandData, "data"), (ComfortnetPointer, "client")],
             conf,
         )
+    if CONF_ON_PACKET in config:
+        cg.add_define("USE_COMFORTNET_PACKET_LISTENERS")
     for conf in config.get(CONF_ON_PACKET, []):
         trigger = cg.new_Pvariable(
             conf[CONF_TRIGGER_ID],
@@ -122,6 +194,7 @@ async def to_code(config):
             conf[CONF_TARGET_DEVICE_TYPE],
             conf[CONF_REGISTER_PACKET_POLL],
             conf[CONF_PACKET_POLL_ONCE],
+            conf.get(CONF_PACKET_POLL_INTERVAL, 0),
         )
         await automation.build_automation(
             trigger,
@@ -6,6 +6,7 @@ static const char *const TAG = "comfortnet.automation";
 
 namespace comfortnet {
 
+#ifdef USE_COMFORTNET_COMMAND_LISTENERS
 ComfortnetCommandTrigger::ComfortnetCommandTrigger(Comfortnet *parent, uint16_t control_command,
                                                    uint8_t target_device_type) {
   parent->register_command_listener(static_cast<CommandType>(control_command),
@@ -16,9 +17,11 @@ ComfortnetCommandTrigger::ComfortnetCommandTrigger(Comfortnet *parent, uint16_t
                                       }
                                     });
 }
+#endif
 
+#ifdef USE_COMFORTNET_PACKET_LISTENERS
 ComfortnetPacketTrigger::ComfortnetPacketTrigger(Comfortnet *parent, uint8_t packet_type, uint8_t target_device_type,
-                                                 bool register_polling, bool poll_once) {
+                                                 bool register_polling, bool poll_once, uint32_t poll_interval) {
   parent->register_packet_listener(static_cast<MessageType>(packet_type),
                                    [this, target_device_type, parent](const ComfortnetPacketData &data) {
                                      if (data.node_type == static_cast<NodeType>(target_device_type) ||
@@ -36,8 +39,9 @@ ComfortnetPacketTrigger::ComfortnetPacketTrigger(Comfortnet *parent, uint8_t pac
       return;
     }
     parent->register_device_polling(static_cast<NodeType>(target_device_type),
-                                    PACKET_REQUEST(static_cast<MessageType>(packet_type)), poll_once);
+                                    PACKET_REQUEST(static_cast<MessageType>(packet_type)), poll_once, poll_interval);
   }
 }
+#endif
 
 }  // namespace comfortnet
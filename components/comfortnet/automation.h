@@ -8,15 +8,19 @@
 
 namespace comfortnet {
 
+#ifdef USE_COMFORTNET_COMMAND_LISTENERS
 class ComfortnetCommandTrigger : public esphome::Trigger<ComfortnetCommandData, Comfortnet *> {
  public:
   explicit ComfortnetCommandTrigger(Comfortnet *parent, uint16_t control_command, uint8_t target_device_type);
 };
+#endif
 
+#ifdef USE_COMFORTNET_PACKET_LISTENERS
 class ComfortnetPacketTrigger : public esphome::Trigger<ComfortnetPacketData, Comfortnet *> {
  public:
   explicit ComfortnetPacketTrigger(Comfortnet *parent, uint8_t packet_type, uint8_t target_device_type,
-                                   bool register_polling, bool poll_once);
+                                   bool register_polling, bool poll_once, uint32_t poll_interval);
 };
+#endif
 
 }  // namespace comfortnet
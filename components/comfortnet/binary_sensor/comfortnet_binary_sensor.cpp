@@ -6,6 +6,7 @@ namespace comfortnet {
 static const char *const TAG = "comfortnet.binary_sensor";
 
 void ComfortnetBinarySensor::setup() {
+  this->parent_->register_catalog_polling(this->sensor_key_, this->sensor_target_device_type_);
   this->parent_->register_listener(
     this->sensor_key_,
     [this](const ComfortnetData &datapoint) {
@@ -1,249 +1,187 @@
-#include "esphome/core/defines.h"
-#include "esphome/core/component.h"
-#include "esphome/core/hal.h"
+#include <algorithm>
+#include <cmath>
 #include "esphome/core/log.h"
-#include "esphome/components/climate/climate_traits.h"
 #include "comfortnet_climate.h"
 
-using namespace esphome;
-
-namespace esphome {
 namespace comfortnet {
 
-namespace {
+static const char *const TAG = "comfortnet.climate";
 
-float fahrenheit_to_celsius(float f) { return (f - 32) * 5 / 9; }
-float celsius_to_fahrenheit(float c) { return c * 9 / 5 + 32; }
+// Fan key selection values
+static const uint8_t FAN_KEY_AUTO = 0x00;
+static const uint8_t FAN_KEY_ON = 0x01;
 
-template<class K, class V> std::set<V> map_values_as_set(std::map<K, V> map) {
-  std::set<V> v;
-  std::transform(map.begin(), map.end(), std::inserter(v, v.end()), [](const std::pair<K, V> &p) { return p.second; });
-  return v;
-}
+static float fahrenheit_to_celsius(float f) { return (f - 32.0f) * 5.0f / 9.0f; }
+static float celsius_to_fahrenheit(float c) { return c * 9.0f / 5.0f + 32.0f; }
 
-}  // namespace
+void ComfortnetClimate::setup() {
+  this->mode = esphome::climate::CLIMATE_MODE_OFF;
+  this->action = esphome::climate::CLIMATE_ACTION_OFF;
+  this->target_temperature_low = NAN;
+  this->target_temperature_high = NAN;
+  this->current_temperature = NAN;
 
-static const char *const TAG = "comfortnet.climate";
+  for (CommandType command_type :
+       {CommandType::HEAT_SET_POINT_TEMPERATURE_MODIFY, CommandType::COOL_SET_POINT_TEMPERATURE_MODIFY,
+        CommandType::SYSTEM_SWITCH_MODIFY, CommandType::FAN_KEY_SELECTION, CommandType::HEAT_DEMAND,
+        CommandType::COOL_DEMAND, CommandType::FAN_DEMAND}) {
+    this->parent_->register_command_listener(
+        command_type, [this](const ComfortnetCommandData &data) { this->handle_command_(data); });
+  }
 
-void ComfortnetClimate::dump_config() {
-  LOG_CLIMATE("", "ComfortNet Climate", this);
-  dump_traits_(TAG);
+  if (!this->current_temperature_key_.empty()) {
+    this->parent_->register_listener(this->current_temperature_key_, [this](const ComfortnetData &datapoint) {
+      if (datapoint.device_type != this->target_device_type_ && this->target_device_type_ != NodeType::ANY) {
+        return;
+      }
+      if (datapoint.type != ComfortnetData::DataType::FLOAT) {
+        ESP_LOGW(TAG, "Current temperature key %s received wrong data type %u", this->current_temperature_key_.c_str(),
+                 datapoint.type);
+        return;
+      }
+      this->current_temperature = fahrenheit_to_celsius(std::get<float>(datapoint.data));
+      this->publish_state();
+    });
+  }
 }
 
-climate::ClimateTraits ComfortnetClimate::traits() {
-  auto traits = climate::ClimateTraits();
-  traits.set_supports_current_temperature(!current_temperature_id_.empty());
-  traits.set_supports_current_humidity(!current_humidity_id_.empty());
-  traits.set_supports_target_humidity(!target_dehumidification_level_id_.empty());
-  traits.set_supports_two_point_target_temperature(!target_temperature_high_id_.empty());
-  if (!mode_id_.empty()) {
-    traits.set_supported_modes(map_values_as_set(modes_));
-  }
-  if (!custom_preset_id_.empty()) {
-    traits.set_supported_custom_presets(map_values_as_set(custom_presets_));
+void ComfortnetClimate::handle_command_(const ComfortnetCommandData &data) {
+  if (data.payload_len < 1) {
+    return;
+  }
+  switch (data.cmd_type) {
+    case CommandType::HEAT_DEMAND:
+      if (data.payload_len < 2) {
+        return;
+      }
+      this->heat_demand_ = data.payload[1] / 2.0f;
+      this->update_action_();
+      return;
+    case CommandType::COOL_DEMAND:
+      if (data.payload_len < 2) {
+        return;
+      }
+      this->cool_demand_ = data.payload[1] / 2.0f;
+      this->update_action_();
+      return;
+    case CommandType::FAN_DEMAND:
+      if (data.payload_len < 3 || !data.response) {
+        return;
+      }
+      this->fan_demand_ = data.payload[2] / 2.0f;
+      this->update_action_();
+      return;
+    default:
+      break;
   }
-  if (!custom_fan_mode_id_.empty()) {
-    traits.set_supported_custom_fan_modes(map_values_as_set(custom_fan_modes_));
+
+  // The rest are thermostat settings, so only follow the ones going to our thermostat
+  if (data.response ||
+      (data.node_type != this->target_device_type_ && this->target_device_type_ != NodeType::ANY)) {
+    return;
+  }
+  switch (data.cmd_type) {
+    case CommandType::HEAT_SET_POINT_TEMPERATURE_MODIFY:
+      this->target_temperature_low = fahrenheit_to_celsius(data.payload[0]);
+      break;
+    case CommandType::COOL_SET_POINT_TEMPERATURE_MODIFY:
+      this->target_temperature_high = fahrenheit_to_celsius(data.payload[0]);
+      break;
+    case CommandType::SYSTEM_SWITCH_MODIFY: {
+      auto it = this->modes_.find(data.payload[0]);
+      if (it == this->modes_.end()) {
+        ESP_LOGW(TAG, "In modes of your yaml add a climate mode for system switch value 0x%02X", data.payload[0]);
+        return;
+      }
+      this->mode = it->second;
+      this->update_action_();
+      break;
+    }
+    case CommandType::FAN_KEY_SELECTION:
+      this->fan_mode = data.payload[0] == FAN_KEY_ON ? esphome::climate::CLIMATE_FAN_ON
+                                                     : esphome::climate::CLIMATE_FAN_AUTO;
+      break;
+    default:
+      return;
+  }
+  this->publish_state();
+}
+
+void ComfortnetClimate::update_action_() {
+  esphome::climate::ClimateAction action;
+  if (this->mode == esphome::climate::CLIMATE_MODE_OFF) {
+    action = esphome::climate::CLIMATE_ACTION_OFF;
+  } else if (this->heat_demand_ > 0.0f) {
+    action = esphome::climate::CLIMATE_ACTION_HEATING;
+  } else if (this->cool_demand_ > 0.0f) {
+    action = esphome::climate::CLIMATE_ACTION_COOLING;
+  } else if (this->fan_demand_ > 0.0f) {
+    action = esphome::climate::CLIMATE_ACTION_FAN;
+  } else {
+    action = esphome::climate::CLIMATE_ACTION_IDLE;
+  }
+  if (action != this->action) {
+    this->action = action;
+    this->publish_state();
   }
-  return traits;
 }
 
-void ComfortnetClimate::setup() {
-  if (!current_temperature_id_.empty()) {
-    parent_->register_listener(
-        current_temperature_id_, request_mod_, request_once_,
-        [this](const ComfortnetDatapoint &datapoint) {
-          current_temperature = fahrenheit_to_celsius(datapoint.value_float);
-          publish_state();
-        },
-        false, this->src_adr_);
-  }
-  if (!current_humidity_id_.empty()) {
-    parent_->register_listener(
-        current_humidity_id_, request_mod_, request_once_,
-        [this](const ComfortnetDatapoint &datapoint) {
-          current_humidity = datapoint.value_float;
-          publish_state();
-        },
-        false, this->src_adr_);
-  }
-  if (!target_dehumidification_level_id_.empty()) {
-    parent_->register_listener(
-        target_dehumidification_level_id_, request_mod_, request_once_,
-        [this](const ComfortnetDatapoint &datapoint) {
-          target_humidity = datapoint.value_float;
-          publish_state();
-        },
-        false, this->src_adr_);
-  }
-  if (!target_temperature_id_.empty()) {
-    parent_->register_listener(
-        target_temperature_id_, request_mod_, request_once_,
-        [this](const ComfortnetDatapoint &datapoint) {
-          target_temperature = fahrenheit_to_celsius(datapoint.value_float);
-          publish_state();
-        },
-        false, this->src_adr_);
-  }
-  if (!target_temperature_low_id_.empty()) {
-    parent_->register_listener(
-        target_temperature_low_id_, request_mod_, request_once_,
-        [this](const ComfortnetDatapoint &datapoint) {
-          target_temperature_low = fahrenheit_to_celsius(datapoint.value_float);
-          publish_state();
-        },
-        false, this->src_adr_);
-  }
-  if (!target_temperature_high_id_.empty()) {
-    parent_->register_listener(
-        target_temperature_high_id_, request_mod_, request_once_,
-        [this](const ComfortnetDatapoint &datapoint) {
-          target_temperature_high = fahrenheit_to_celsius(datapoint.value_float);
-          publish_state();
-        },
-        false, this->src_adr_);
-  }
-  if (!mode_id_.empty()) {
-    parent_->register_listener(
-        mode_id_, request_mod_, request_once_,
-        [this](const ComfortnetDatapoint &datapoint) {
-          auto it = modes_.find(datapoint.value_enum);
-          if (it == modes_.end()) {
-            ESP_LOGW(TAG, "In modes of your yaml add a ClimateMode that corresponds to: %d: \"%s\"",
-                     datapoint.value_enum, datapoint.value_string.c_str());
-          } else {
-            mode = it->second;
-            publish_state();
-          }
-        },
-        false, this->src_adr_);
-  }
-  if (!custom_preset_id_.empty()) {
-    parent_->register_listener(
-        custom_preset_id_, request_mod_, request_once_,
-        [this](const ComfortnetDatapoint &datapoint) {
-          auto it = custom_presets_.find(datapoint.value_enum);
-          if (it == custom_presets_.end()) {
-            ESP_LOGW(TAG, "In custom_presets of your yaml add: %d: \"%s\"", datapoint.value_enum,
-                     datapoint.value_string.c_str());
-          } else {
-            set_custom_preset_(it->second);
-            publish_state();
-          }
-        },
-        false, this->src_adr_);
-  }
-  if (!custom_fan_mode_id_.empty()) {
-    parent_->register_listener(
-        custom_fan_mode_id_, request_mod_, request_once_,
-        [this](const ComfortnetDatapoint &datapoint) {
-          auto it = custom_fan_modes_.find(datapoint.value_enum);
-          if (it == custom_fan_modes_.end()) {
-            ESP_LOGW(TAG, "In custom_fan_modes of your yaml add: %d: \"%s\"", datapoint.value_enum,
-                     datapoint.value_string.c_str());
-          } else {
-            fan_mode_ = it->second;
-            if (follow_schedule_.has_value()) {
-              if (follow_schedule_.value()) {
-                set_custom_fan_mode_(fan_mode_);
-                publish_state();
-              }
-            }
-          }
-        },
-        false, this->src_adr_);
-  }
-  if (!custom_fan_mode_no_schedule_id_.empty()) {
-    parent_->register_listener(
-        custom_fan_mode_no_schedule_id_, request_mod_, request_once_,
-        [this](const ComfortnetDatapoint &datapoint) {
-          auto it = custom_fan_modes_.find(datapoint.value_enum);
-          if (it == custom_fan_modes_.end()) {
-            ESP_LOGW(TAG, "In custom_fan_modes of your yaml add: %d: \"%s\"", datapoint.value_enum,
-                     datapoint.value_string.c_str());
-          } else {
-            fan_mode_no_schedule_ = it->second;
-            if (follow_schedule_.has_value()) {
-              if (!follow_schedule_.value()) {
-                set_custom_fan_mode_(fan_mode_no_schedule_);
-                publish_state();
-              }
-            }
-          }
-        },
-        false, this->src_adr_);
-  }
-  if (!follow_schedule_id_.empty()) {
-    parent_->register_listener(
-        follow_schedule_id_, request_mod_, request_once_,
-        [this](const ComfortnetDatapoint &datapoint) {
-          ESP_LOGI(TAG, "MCU reported climate sensor %s is: %s", this->follow_schedule_id_.c_str(),
-                   datapoint.value_string.c_str());
-          follow_schedule_ = datapoint.value_enum > 0;
-          if (follow_schedule_.value()) {
-            if (!fan_mode_.empty()) {
-              set_custom_fan_mode_(fan_mode_);
-              publish_state();
-            }
-          } else {
-            if (!fan_mode_no_schedule_.empty()) {
-              set_custom_fan_mode_(fan_mode_no_schedule_);
-              publish_state();
-            }
-          }
-        },
-        false, this->src_adr_);
+void ComfortnetClimate::send_command_(CommandType command_type, float value) {
+  if (!this->parent_->set_control_command(this->target_device_type_, command_type, value)) {
+    ESP_LOGW(TAG, "Unable to send control command 0x%04X", command_type);
   }
 }
 
-void ComfortnetClimate::control(const climate::ClimateCall &call) {
-  if (call.get_target_temperature().has_value() && !target_temperature_id_.empty()) {
-    parent_->set_float_datapoint_value(target_temperature_id_,
-                                       celsius_to_fahrenheit(call.get_target_temperature().value()), this->src_adr_);
-  }
-  if (call.get_target_temperature_low().has_value() && !target_temperature_low_id_.empty()) {
-    parent_->set_float_datapoint_value(
-        target_temperature_low_id_, celsius_to_fahrenheit(call.get_target_temperature_low().value()), this->src_adr_);
-  }
-  if (call.get_target_temperature_high().has_value() && !target_temperature_high_id_.empty()) {
-    parent_->set_float_datapoint_value(
-        target_temperature_high_id_, celsius_to_fahrenheit(call.get_target_temperature_high().value()), this->src_adr_);
-  }
-  if (call.get_mode().has_value() && !mode_id_.empty()) {
-    climate::ClimateMode mode = call.get_mode().value();
-    auto it = std::find_if(modes_.begin(), modes_.end(),
-                           [&mode](const std::pair<uint8_t, climate::ClimateMode> &p) { return p.second == mode; });
-    if (it != modes_.end()) {
-      parent_->set_enum_datapoint_value(mode_id_, it->first, this->src_adr_);
+void ComfortnetClimate::control(const esphome::climate::ClimateCall &call) {
+  // State is only published once the command is seen on the bus, so the entity always reflects the thermostat
+  if (call.get_mode().has_value()) {
+    esphome::climate::ClimateMode mode = call.get_mode().value();
+    auto it = std::find_if(this->modes_.begin(), this->modes_.end(),
+                           [&mode](const std::pair<uint8_t, esphome::climate::ClimateMode> &p) {
+                             return p.second == mode;
+                           });
+    if (it != this->modes_.end()) {
+      this->send_command_(CommandType::SYSTEM_SWITCH_MODIFY, it->first);
     }
   }
-  if (call.get_custom_preset().has_value() && !custom_preset_id_.empty()) {
-    const std::string &preset = call.get_custom_preset().value();
-    auto it = std::find_if(custom_presets_.begin(), custom_presets_.end(),
-                           [&preset](const std::pair<uint8_t, std::string> &p) { return p.second == preset; });
-    if (it != custom_presets_.end()) {
-      parent_->set_enum_datapoint_value(custom_preset_id_, it->first, this->src_adr_);
-    }
+  if (call.get_target_temperature_low().has_value()) {
+    // Rounded to whole degrees and clamped to what the command can carry when the value is encoded
+    this->send_command_(CommandType::HEAT_SET_POINT_TEMPERATURE_MODIFY,
+                        celsius_to_fahrenheit(call.get_target_temperature_low().value()));
   }
-  if (call.get_custom_fan_mode().has_value() && !custom_fan_mode_id_.empty()) {
-    const std::string &fan_mode = call.get_custom_fan_mode().value();
-    auto it = std::find_if(custom_fan_modes_.begin(), custom_fan_modes_.end(),
-                           [&fan_mode](const std::pair<uint8_t, std::string> &p) { return p.second == fan_mode; });
-    if (it != custom_fan_modes_.end()) {
-      if (follow_schedule_.has_value()) {
-        if (follow_schedule_.value()) {
-          parent_->set_enum_datapoint_value(custom_fan_mode_id_, it->first, this->src_adr_);
-        } else {
-          parent_->set_enum_datapoint_value(custom_fan_mode_no_schedule_id_, it->first, this->src_adr_);
-        }
-      }
-    }
+  if (call.get_target_temperature_high().has_value()) {
+    this->send_command_(CommandType::COOL_SET_POINT_TEMPERATURE_MODIFY,
+                        celsius_to_fahrenheit(call.get_target_temperature_high().value()));
+  }
+  if (call.get_fan_mode().has_value()) {
+    this->send_command_(CommandType::FAN_KEY_SELECTION,
+                        call.get_fan_mode().value() == esphome::climate::CLIMATE_FAN_ON ? FAN_KEY_ON : FAN_KEY_AUTO);
+  }
+}
+
+esphome::climate::ClimateTraits ComfortnetClimate::traits() {
+  auto traits = esphome::climate::ClimateTraits();
+  traits.set_supports_current_temperature(!this->current_temperature_key_.empty());
+  traits.set_supports_two_point_target_temperature(true);
+  traits.set_supports_action(true);
+  traits.set_visual_temperature_step(0.5f);
+  for (const auto &mode : this->modes_) {
+    traits.add_supported_mode(mode.second);
+  }
+  traits.add_supported_fan_mode(esphome::climate::CLIMATE_FAN_AUTO);
+  traits.add_supported_fan_mode(esphome::climate::CLIMATE_FAN_ON);
+  return traits;
+}
+
+void ComfortnetClimate::dump_config() {
+  LOG_CLIMATE("", "ComfortNet Climate", this);
+  ESP_LOGCONFIG(TAG, "  Target Device Type: %02x", this->target_device_type_);
+  if (!this->current_temperature_key_.empty()) {
+    ESP_LOGCONFIG(TAG, "  Current Temperature Key: %s", this->current_temperature_key_.c_str());
   }
-  if (call.get_target_humidity().has_value() && !target_dehumidification_level_id_.empty()) {
-    parent_->set_float_datapoint_value(target_dehumidification_level_id_, call.get_target_humidity().value(),
-                                       this->src_adr_);
+  for (const auto &mode : this->modes_) {
+    ESP_LOGCONFIG(TAG, "  System Switch 0x%02X: Mode %u", mode.first, mode.second);
   }
 }
 
 }  // namespace comfortnet
-}  // namespace esphome
@@ -1,71 +1,37 @@
 #pragma once
 
+#include <map>
 #include "esphome/core/component.h"
-#include "../comfortnet.h"
 #include "esphome/components/climate/climate.h"
+#include "../comfortnet.h"
 
 namespace comfortnet {
 
+/**
+ * Climate entity that follows the thermostat by eavesdropping on the control commands sent over the network, and
+ * changes it by sending control commands of its own.
+ */
 class ComfortnetClimate : public esphome::climate::Climate, public esphome::Component, public ComfortnetClient {
  public:
   void setup() override;
   void dump_config() override;
-  void set_current_temperature_id(const std::string &current_temperature_id) {
-    current_temperature_id_ = current_temperature_id;
-  }
-  void set_target_temperature_id(const std::string &target_temperature_id) {
-    target_temperature_id_ = target_temperature_id;
-  }
-  void set_target_temperature_low_id(const std::string &target_temperature_low_id) {
-    target_temperature_low_id_ = target_temperature_low_id;
-  }
-  void set_target_temperature_high_id(const std::string &target_temperature_high_id) {
-    target_temperature_high_id_ = target_temperature_high_id;
-  }
-  void set_mode_id(const std::string &mode_id) { mode_id_ = mode_id; }
-  void set_custom_preset_id(const std::string &custom_preset_id) { custom_preset_id_ = custom_preset_id; }
-  void set_custom_fan_mode_id(const std::string &custom_fan_mode_id) { custom_fan_mode_id_ = custom_fan_mode_id; }
-  void set_custom_fan_mode_no_schedule_id(const std::string &custom_fan_mode_no_schedule_id) {
-    custom_fan_mode_no_schedule_id_ = custom_fan_mode_no_schedule_id;
-  }
-  void set_follow_schedule_id(const std::string &follow_schedule_id) { follow_schedule_id_ = follow_schedule_id; }
-  void set_modes(const std::vector<uint8_t> &keys, const std::vector<climate::ClimateMode> &values) {
-    std::transform(keys.begin(), keys.end(), values.begin(), std::inserter(modes_, modes_.end()),
-                   [](uint8_t k, climate::ClimateMode v) { return std::make_pair(k, v); });
-  }
-  void set_custom_presets(const std::vector<uint8_t> &keys, const std::vector<std::string> &values) {
-    std::transform(keys.begin(), keys.end(), values.begin(), std::inserter(custom_presets_, custom_presets_.end()),
-                   [](uint8_t k, const std::string &v) { return std::make_pair(k, v); });
-  }
-  void set_custom_fan_modes(const std::vector<uint8_t> &keys, const std::vector<std::string> &values) {
-    std::transform(keys.begin(), keys.end(), values.begin(), std::inserter(custom_fan_modes_, custom_fan_modes_.end()),
-                   [](uint8_t k, const std::string &v) { return std::make_pair(k, v); });
-  }
-  void set_current_humidity_id(const std::string &current_humidity_id) { current_humidity_id_ = current_humidity_id; }
-  void set_target_dehumidification_level_id(const std::string &target_dehumidification_level_id) {
-    target_dehumidification_level_id_ = target_dehumidification_level_id;
-  }
+  void set_target_device_type(uint8_t type) { this->target_device_type_ = static_cast<NodeType>(type); };
+  void set_current_temperature_key(const std::string &key) { this->current_temperature_key_ = key; };
+  void add_mode(uint8_t system_switch, esphome::climate::ClimateMode mode) { this->modes_[system_switch] = mode; };
 
  protected:
-  std::string current_temperature_id_{""};
-  std::string target_temperature_id_{""};
-  std::string target_temperature_low_id_{""};
-  std::string target_temperature_high_id_{""};
-  std::string mode_id_{""};
-  std::string custom_preset_id_{""};
-  std::string custom_fan_mode_id_{""};
-  std::string custom_fan_mode_no_schedule_id_{""};
-  std::string follow_schedule_id_{""};
-  optional<bool> follow_schedule_;
-  std::string fan_mode_{""};
-  std::string fan_mode_no_schedule_{""};
-  std::map<uint8_t, climate::ClimateMode> modes_;
-  std::map<uint8_t, std::string> custom_presets_;
-  std::map<uint8_t, std::string> custom_fan_modes_;
-  std::string current_humidity_id_{""};
-  std::string target_dehumidification_level_id_{""};
-  void control(const climate::ClimateCall &call) override;
-  climate::ClimateTraits traits() override;
+  void control(const esphome::climate::ClimateCall &call) override;
+  esphome::climate::ClimateTraits traits() override;
+  void handle_command_(const ComfortnetCommandData &data);
+  void update_action_();
+  void send_command_(CommandType command_type, float value);
+
+  NodeType target_device_type_{NodeType::THERMOSTAT};
+  std::string current_temperature_key_{""};
+  std::map<uint8_t, esphome::climate::ClimateMode> modes_;  // System switch value -> climate mode
+  float heat_demand_{0.0f};
+  float cool_demand_{0.0f};
+  float fan_demand_{0.0f};
 };
 
 }  // namespace comfortnet
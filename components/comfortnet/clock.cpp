@@ -0,0 +1,59 @@
+#include "clock.h"
+#ifdef ARDUINO
+#include <Arduino.h>
+#elif defined(USE_HOST)
+#include "esphome/core/hal.h"
+#include "esphome/core/helpers.h"
+#else
+#include "esp_random.h"
+#include "esp_timer.h"
+#endif
+
+namespace comfortnet {
+
+Clock *Clock::hardware() {
+  static HardwareClock clock;
+  return &clock;
+}
+
+uint32_t HardwareClock::millis() {
+#ifdef ARDUINO
+  return ::millis();
+#elif defined(USE_HOST)
+  return esphome::millis();
+#else
+  return (uint32_t) (esp_timer_get_time() / 1000);
+#endif
+}
+
+uint32_t HardwareClock::micros() {
+#ifdef ARDUINO
+  return ::micros();
+#elif defined(USE_HOST)
+  return esphome::micros();
+#else
+  return (uint32_t) esp_timer_get_time();
+#endif
+}
+
+uint32_t HardwareClock::random(uint32_t min, uint32_t max) {
+#ifdef ARDUINO
+  return ::random(min, max);
+#elif defined(USE_HOST)
+  return (esphome::random_uint32() % (max - min + 1)) + min;
+#else
+  return (esp_random() % (max - min + 1)) + min;
+#endif
+}
+
+uint32_t VirtualClock::random(uint32_t min, uint32_t max) {
+  // xorshift32, plenty for spreading slot delays
+  uint32_t x = this->random_state_;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  this->random_state_ = x;
+  return (x % (max - min + 1)) + min;
+}
+
+}  // namespace comfortnet
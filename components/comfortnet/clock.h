@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+
+namespace comfortnet {
+
+/**
+ * Time and slot delay randomness for the protocol logic.
+ *
+ * Every timeout, slot delay and transmit deadline is measured against the clock Comfortnet was given, so a host build
+ * can install a VirtualClock and run hours of bus time without waiting for them.
+ */
+class Clock {
+ public:
+  virtual uint32_t millis() = 0;
+  virtual uint32_t micros() = 0;
+  /**
+   * Random number from min up to max
+   */
+  virtual uint32_t random(uint32_t min, uint32_t max) = 0;
+
+  /**
+   * The device's own timer and random number generator
+   */
+  static Clock *hardware();
+};
+
+class HardwareClock : public Clock {
+ public:
+  uint32_t millis() override;
+  uint32_t micros() override;
+  uint32_t random(uint32_t min, uint32_t max) override;
+};
+
+/**
+ * Clock that only moves when advanced, with a seeded random sequence so every run of a scenario plays out the same
+ */
+class VirtualClock : public Clock {
+ public:
+  explicit VirtualClock(uint32_t seed = 1) : random_state_(seed == 0 ? 1 : seed) {};
+
+  inline void advance_millis(uint32_t millis) { this->micros_ += static_cast<uint64_t>(millis) * 1000; }
+  inline void advance_micros(uint32_t micros) { this->micros_ += micros; }
+
+  uint32_t millis() override { return static_cast<uint32_t>(this->micros_ / 1000); }
+  uint32_t micros() override { return static_cast<uint32_t>(this->micros_); }
+  uint32_t random(uint32_t min, uint32_t max) override;
+
+ protected:
+  uint64_t micros_{0};
+  uint32_t random_state_;
+};
+
+}  // namespace comfortnet
@@ -1,6 +1,10 @@
 #include "comfortnet.h"
-#ifndef ARDUINO
-#include "esp_timer.h"
+#ifdef USE_ESP32
+#include <esp_heap_caps.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#elif defined(USE_ESP8266)
+#include <Esp.h>
 #endif
 
 namespace comfortnet {
@@ -15,25 +19,12 @@ static const uint32_t SILENCE_TIMEOUT = 60000;  // How long we will wait for any
                                                 // unavailable (This is not official spec,
                                                 // but for monitoring purposes. May need adjustment.)
 
-// Packet information
-static const uint8_t PACKET_HEADER_SIZE = 10;
-static const uint8_t PACKET_CRC_SIZE = 2;
-
-// Header indices (Relative to packet)
-static const uint8_t DESTINATION_ADDRESS_POS = 0;
-static const uint8_t SOURCE_ADDRESS_POS = 1;
-static const uint8_t SUBNET_POS = 2;
-static const uint8_t SEND_METHOD_POS = 3;
-static const uint8_t SEND_PARAMETER_1_POS = 4; /* Extra data for send method */
-static const uint8_t SEND_PARAMETER_2_POS = 5; /* Generally 0 on sending, as coordinator will fill it with the ID of the
-                                    target device when routing packets */
-static const uint8_t SOURCE_NODE_TYPE_POS = 6;
-static const uint8_t MESSAGE_TYPE_POS = 7;
-static const uint8_t PACKET_NUMBER_POS =
-    8; /* Defined in ClimateTalk Alliance CT2.0 CT-485 API Reference Revision 01 4.3 - Packet Number*/
-static const uint8_t PAYLOAD_LENGTH_POS = 9; /* 0-MAX_PAYLOAD_SIZE */
-
 static const uint8_t CMD_HEADER_SIZE = 2;
+// Times a control command is sent without being acknowledged before we give up on it
+static const uint8_t COMMAND_MAX_ATTEMPTS = 3;
+// How long a background message may wait at the head of the queue for its response after it first went out. Longer
+// than the memory reader waits, so the reader gets to ask again for its own requests first.
+static const uint32_t BACKGROUND_RESPONSE_TIMEOUT = 15000;
 
 // Data indices (Relative to data, not packet)
 static const uint8_t ACK_POS = 0;
@@ -51,12 +42,64 @@ static const uint8_t ADDRESS_MAC_POS = 2;
 
 // ComfortnetData keys for listeners
 static const std::string DATA_KEY_NETWORK_STATUS = "NETWORK_STATUS";
+static const std::string DATA_KEY_FREE_HEAP = "FREE_HEAP";
+static const std::string DATA_KEY_LARGEST_FREE_BLOCK = "LARGEST_FREE_BLOCK";
+static const std::string DATA_KEY_MIN_STACK_HEADROOM = "MIN_STACK_HEADROOM";
+static const std::string DATA_KEY_PEAK_PENDING_MESSAGES = "PEAK_PENDING_MESSAGES";
+static const std::string DATA_KEY_PEAK_PAYLOAD_BLOCKS = "PEAK_PAYLOAD_BLOCKS";
+#ifdef USE_COMFORTNET_PROFILING
+static const std::string DATA_KEY_LOOP_TIME_MAX = "LOOP_TIME_MAX";
+static const std::string DATA_KEY_LOOP_TIME_MEAN = "LOOP_TIME_MEAN";
+static const std::string DATA_KEY_SLOW_LOOPS = "SLOW_LOOPS";
+// Per phase keys are LOOP_<phase>_MAX and LOOP_<phase>_MEAN, such as LOOP_CHECKSUM_MAX
+static const char *const DATA_KEY_LOOP_PHASE_PREFIX = "LOOP_";
+#endif
+
+// Bytes read from the UART at once, keeps stack usage bounded no matter how much is buffered
+static const uint8_t READ_CHUNK_SIZE = 64;
+// Extra time after the calculated end of a transmit before the driver is released, in microseconds
+static const uint32_t TRANSMIT_MARGIN = 200;
+
+// Preference keys for the persisted network identity and network shared data
+static const uint32_t IDENTITY_PREFERENCE_HASH = 0x434E4944;
+static const uint32_t SHARED_DATA_PREFERENCE_HASH = 0x434E5344;
 
 void Comfortnet::setup() {
   if (flow_control_pin_ != nullptr) {
     flow_control_pin_->setup();
   }
-  mac_address_.setRandom();
+  this->segment_assembler_.set_callback(
+      [this](const FrameView &header, const uint8_t *payload, uint16_t payload_len, uint32_t now) {
+        this->dispatch_message_(header, payload, payload_len, now);
+      });
+  this->identity_pref_ = esphome::global_preferences->make_preference<PersistedIdentity>(
+      IDENTITY_PREFERENCE_HASH ^ this->preference_salt_, true);
+  if (this->identity_pref_.load(&this->saved_identity_)) {
+    this->mac_address_ = this->saved_identity_.mac_address;
+    if (this->saved_identity_.node_id != static_cast<NodeAddress>(0) && !this->listen_only_) {
+      // Assume our previous address is still valid, the next address confirmation will tell us if it isn't
+      const uint32_t now = this->clock_->millis();
+      this->node_id_ = this->saved_identity_.node_id;
+      this->subnet_ = this->saved_identity_.subnet;
+      this->session_id_ = this->saved_identity_.session_id;
+      this->last_address_confirm_time_ = now;
+      this->last_read_time_ = now;
+      this->resuming_identity_ = true;
+      ESP_LOGI(TAG, "Resuming network address 0x%02X from previous session", this->node_id_);
+    }
+  } else {
+    this->mac_address_.setRandom();
+    this->save_identity_();
+  }
+#ifdef USE_COMFORTNET_SHARED_DATA
+  this->network_shared_data_.setup(SHARED_DATA_PREFERENCE_HASH ^ this->preference_salt_);
+#endif
+}
+
+void Comfortnet::on_safe_shutdown() {
+#ifdef USE_COMFORTNET_SHARED_DATA
+  this->network_shared_data_.flush();
+#endif
 }
 
 void Comfortnet::dump_config() {
@@ -66,21 +109,365 @@ void Comfortnet::dump_config() {
                 mac_address_.mac[2], mac_address_.mac[3], mac_address_.mac[4], mac_address_.mac[5], mac_address_.mac[6],
                 mac_address_.mac[7]);
   ESP_LOGCONFIG(TAG, "  Device Type: %02x", device_type_);
+  ESP_LOGCONFIG(TAG, "  Listen Only: %s", YESNO(this->listen_only_));
+  ESP_LOGCONFIG(TAG, "  Network Address: 0x%02X%s", this->node_id_, this->resuming_identity_ ? " (Resuming)" : "");
+#ifdef USE_COMFORTNET_SHARED_DATA
+  ESP_LOGCONFIG(TAG, "  Network Shared Data Slots Used: %u/%u", this->network_shared_data_.slots_used(),
+                SHARED_DATA_SLOT_COUNT);
+#else
+  ESP_LOGCONFIG(TAG, "  Network Shared Data: Not stored");
+#endif
+#ifdef USE_COMFORTNET_COMMAND_LISTENERS
+  ESP_LOGCONFIG(TAG, "  Command Listeners: %u", this->command_listeners_.size());
+#endif
+#ifdef USE_COMFORTNET_PACKET_LISTENERS
+  ESP_LOGCONFIG(TAG, "  Packet Listeners: %u", this->packet_listeners_.size());
+#endif
+  ESP_LOGCONFIG(TAG, "  Reply Delay: %" PRIu32 " ms (Longest Turnaround: %" PRIu32 " ms)", this->reply_delay_,
+                this->max_reply_turnaround_);
+  ESP_LOGCONFIG(TAG, "  Outbound Frames: %u (Overwritten: %" PRIu32 ")", OUTBOUND_FRAME_QUEUE_SIZE,
+                this->outbound_overwrite_count_);
+  ESP_LOGCONFIG(TAG,
+                "  Pending Messages: %u/%u (Queue Full: %" PRIu32 ", Pool Exhausted: %" PRIu32
+                ", Timed Out: %" PRIu32 ")",
+                this->pending_messages_.size(), this->pending_messages_.capacity(), this->queue_full_count_,
+                PayloadPool::get_exhausted_count(), this->stalled_message_count_);
+  ESP_LOGCONFIG(TAG, "  Control Command Slots: %u (Coalesced: %" PRIu32 ", No Free Slot: %" PRIu32
+                ", Abandoned: %" PRIu32 ")",
+                COMMAND_SLOT_COUNT, this->command_coalesced_count_, this->command_no_slot_count_,
+                this->command_abandoned_count_);
+  ESP_LOGCONFIG(TAG, "  Segmented Messages: %" PRIu32 " (Dropped: %" PRIu32 ")",
+                this->segment_assembler_.get_completed_count(), this->segment_assembler_.get_dropped_count());
+  if (this->memory_reader_.get_bytes_read() > 0) {
+    ESP_LOGCONFIG(TAG,
+                  "  Memory Read: %" PRIu32 " bytes in %" PRIu32 " cycles (%.1f bytes/cycle, Retries: %" PRIu32 ")",
+                  this->memory_reader_.get_bytes_read(), this->memory_reader_.get_cycles(),
+                  this->memory_reader_.get_bytes_per_cycle(), this->memory_reader_.get_retry_count());
+    // The window only keeps requests queued ahead, the bus still carries one request and its response per token
+    ESP_LOGCONFIG(TAG, "  Memory Read Requests: %u queued ahead, one sent per token", DMA_REQUEST_WINDOW);
+  }
+#ifdef USE_COMFORTNET_FRAME_BRIDGE
+  if (this->frame_bridge_.is_enabled()) {
+    ESP_LOGCONFIG(TAG, "  Frame Bridge Port: %u (Client: %s)", this->frame_bridge_.get_port(),
+                  YESNO(this->frame_bridge_.is_connected()));
+    ESP_LOGCONFIG(TAG, "  Frame Bridge Frames: %" PRIu32 " (Dropped: %" PRIu32 "), Injected: %" PRIu32
+                  " (Rejected: %" PRIu32 ")",
+                  this->frame_bridge_.get_sent_count(), this->frame_bridge_.get_dropped_count(),
+                  this->frame_bridge_.get_injected_count(), this->frame_bridge_.get_rejected_count());
+  }
+#endif
+  ESP_LOGCONFIG(TAG,
+                "  Token Bids: %" PRIu32 " (Won: %" PRIu32 ", Lost: %" PRIu32 ", Held Back: %" PRIu32 "), Credits: %u",
+                this->token_bid_policy_.get_bid_count(), this->token_bid_policy_.get_win_count(),
+                this->token_bid_policy_.get_loss_count(), this->token_bid_policy_.get_deferred_count(),
+                this->token_bid_policy_.get_credits());
+  ESP_LOGCONFIG(TAG, "  Polling: %u (Suppressed: %" PRIu32 ")", this->polling_queue_.size(),
+                this->poll_suppressed_count_);
+#ifdef USE_COMFORTNET_PROFILING
+  const LoopProfiler &profiler = this->loop_profiler_;
+  ESP_LOGCONFIG(TAG, "  Loop Time: Mean %" PRIu32 " us, Max %" PRIu32 " us over the last %" PRIu32 " calls",
+                profiler.get_mean(profiler.get_loop()), profiler.get_loop().max, profiler.get_loop_count());
+  ESP_LOGCONFIG(TAG, "  Slow Loops: %" PRIu32 " (Threshold: %" PRIu32 " us, Slowest: %" PRIu32 " us)",
+                profiler.get_slow_count(), profiler.get_slow_threshold(), profiler.get_slowest_time());
+  for (uint8_t i = 0; i < static_cast<uint8_t>(LoopPhase::COUNT); i++) {
+    LoopPhase phase = static_cast<LoopPhase>(i);
+    const LoopPhaseStats &stats = profiler.get_phase(phase);
+    ESP_LOGCONFIG(TAG, "    %-12s Mean %" PRIu32 " us, Max %" PRIu32 " us, Slowest Loop %" PRIu32 " us",
+                  loop_phase_to_string(phase), profiler.get_mean(stats), stats.max,
+                  profiler.get_slowest_phase_time(phase));
+  }
+#endif
+  ESP_LOGCONFIG(TAG, "  Known Nodes: %u", this->node_registry_.size());
+#if ESPHOME_LOG_LEVEL >= ESPHOME_LOG_LEVEL_CONFIG
+  for (const NodeInfo &node : this->node_registry_) {
+    ESP_LOGCONFIG(TAG, "    0x%02X: Type 0x%02X, Latency %.0f ms, NAKs %u, Missed %u", node.address, node.node_type,
+                  node.latency_ewma, node.nak_count, node.missed_responses);
+  }
+#endif
+}
+
+void Comfortnet::save_identity_() {
+  PersistedIdentity identity{};
+  identity.mac_address = this->mac_address_;
+  identity.session_id = this->session_id_;
+  identity.node_id = this->node_id_;
+  identity.subnet = this->subnet_;
+  if (memcmp(&identity, &this->saved_identity_, sizeof(PersistedIdentity)) == 0) {
+    return;  // Nothing changed, save a flash write
+  }
+  if (this->identity_pref_.save(&identity)) {
+    this->saved_identity_ = identity;
+    // Joins are rare, so write now rather than risk losing the identity to an unexpected reset
+    esphome::global_preferences->sync();
+  }
+}
+
+bool Comfortnet::queue_message(PendingMessage &&message) {
+  if (this->listen_only_) {
+    ESP_LOGW(TAG, "Listen only mode, not sending 0x%02X message", message.packet_type);
+    return false;
+  }
+  message.queued_time = this->clock_->millis();
+  if (message.packet_type == MessageType::SET_CONTROL_COMMAND) {
+    message.priority = MessagePriority::URGENT;
+  }
+  if (message.payload.is_too_large()) {
+    ESP_LOGW(TAG, "0x%02X message is over %u bytes, dropping it. Use queue_segmented_message() for larger payloads.",
+             message.packet_type, MAX_PAYLOAD_SIZE);
+    return false;
+  }
+  if (!message.payload.is_valid()) {
+    ESP_LOGW(TAG, "Payload pool exhausted, dropping 0x%02X message", message.packet_type);
+    return false;
+  }
+  if (!this->pending_messages_.push(std::move(message))) {
+    this->queue_full_count_++;
+    ESP_LOGW(TAG, "Pending message queue full, dropping 0x%02X message", message.packet_type);
+    return false;
+  }
+  this->watermarks_.peak_pending_messages =
+      std::max(this->watermarks_.peak_pending_messages, this->pending_messages_.size());
+  return true;
+}
+
+bool Comfortnet::queue_segmented_message(SendMethod send_method, uint8_t send_param_1, MessageType packet_type,
+                                         const uint8_t *data, uint16_t data_len) {
+  if (data_len <= MAX_PAYLOAD_SIZE) {
+    return this->queue_message(PendingMessage(send_method, send_param_1, packet_type, data, data_len));
+  }
+  if (data_len > MAX_SEGMENTED_PAYLOAD_SIZE) {
+    ESP_LOGW(TAG, "0x%02X message of %u bytes is too large to send", packet_type, data_len);
+    return false;
+  }
+  // A full frame tells the receiver another segment follows, so the message always ends on a short or empty one
+  uint8_t segments = data_len / MAX_PAYLOAD_SIZE + 1;
+  uint8_t blocks = (data_len + MAX_PAYLOAD_SIZE - 1) / MAX_PAYLOAD_SIZE;
+  if (this->pending_messages_.capacity() - this->pending_messages_.size() < segments ||
+      PAYLOAD_POOL_SIZE - PayloadPool::get_blocks_in_use() < blocks) {
+    this->queue_full_count_++;
+    ESP_LOGW(TAG, "No room for the %u segments of a 0x%02X message, dropping it", segments, packet_type);
+    return false;
+  }
+  for (uint8_t i = 0; i < segments; i++) {
+    uint16_t offset = i * MAX_PAYLOAD_SIZE;
+    PendingMessage segment(send_method, send_param_1, packet_type, data + offset,
+                           std::min<uint16_t>(data_len - offset, MAX_PAYLOAD_SIZE));
+    segment.segment = i;
+    segment.more_segments = i + 1 < segments;
+    if (!this->queue_message(std::move(segment))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool Comfortnet::queue_control_command(NodeType node_type, CommandType command_type, const uint8_t *data,
+                                       uint8_t data_len) {
+  if (data_len > MAX_PAYLOAD_SIZE - CONTROL_CMD_SIZE) {
+    ESP_LOGW(TAG, "Control command 0x%04X is too large to send", command_type);
+    return false;
+  }
+  uint8_t payload[MAX_PAYLOAD_SIZE];
+  payload[CONTROL_CMD_POS] = static_cast<uint16_t>(command_type) & 0xFF;
+  payload[CONTROL_CMD_POS + 1] = (static_cast<uint16_t>(command_type) >> 8) & 0xFF;
+  std::copy(data, data + data_len, payload + CONTROL_CMD_SIZE);
+  return this->queue_message(
+      PendingMessageToType(node_type, MessageType::SET_CONTROL_COMMAND, payload, CONTROL_CMD_SIZE + data_len));
 }
 
-uint16_t Comfortnet::calculate_crc_(const uint8_t *data, uint8_t data_len) {
-  uint8_t sum1 = 0xAA;  // Fletcher seed
-  uint8_t sum2 = 0;
+bool Comfortnet::set_control_command(NodeType node_type, CommandType command_type, float value) {
+  if (this->listen_only_) {
+    ESP_LOGW(TAG, "Listen only mode, not sending control command 0x%04X", command_type);
+    return false;
+  }
+  CommandSlot *slot = nullptr;
+  CommandSlot *unused = nullptr;
+  for (auto &candidate : this->command_slots_) {
+    if (!candidate.command.is_built()) {
+      unused = unused == nullptr ? &candidate : unused;
+    } else if (candidate.command.get_node_type() == node_type && candidate.command.get_command() == command_type) {
+      slot = &candidate;
+      break;
+    } else if (!candidate.dirty && &candidate != this->command_in_flight_ && unused == nullptr) {
+      unused = &candidate;  // Settled commands are rebuilt the next time they are needed
+    }
+  }
+  if (slot == nullptr) {
+    if (unused == nullptr) {
+      this->command_no_slot_count_++;
+      ESP_LOGW(TAG, "No free command slot, dropping control command 0x%04X", command_type);
+      return false;
+    }
+    slot = unused;
+    slot->command.build(node_type, command_type, this->device_type_);
+    slot->dirty = false;
+  }
+  slot->command.set_value(value);
+  if (slot->dirty && slot->sent_revision != slot->revision) {
+    this->command_coalesced_count_++;
+  } else if (!slot->dirty) {
+    slot->queued_time = this->clock_->millis();
+  }
+  slot->dirty = true;
+  slot->revision++;
+  slot->attempts = 0;
+  return true;
+}
 
-  for (short i = 0; i < data_len; i++) {
-    sum1 = (sum1 + data[i]) % 0xFF;
-    sum2 = (sum2 + sum1) % 0xFF;
+bool Comfortnet::start_memory_read(NodeType node_type, uint16_t start_address, uint32_t length,
+                                   MemoryReader::Callback callback) {
+  if (this->listen_only_) {
+    ESP_LOGW(TAG, "Listen only mode, can't read memory");
+    return false;
   }
+  if (!this->memory_reader_.start(node_type, start_address, length, std::move(callback), this->clock_->millis())) {
+    return false;
+  }
+  this->pump_memory_reader_();
+  return true;
+}
 
-  uint8_t tmp = 0xFF - ((sum1 + sum2) % 0xFF);
-  return (static_cast<uint16_t>(tmp) << 8) | static_cast<uint16_t>(0xFF - ((sum1 + tmp) % 0xFF));
+void Comfortnet::drop_memory_requests_() {
+  uint8_t dropped = this->pending_messages_.remove_if([](const PendingMessage &message) {
+    return message.packet_type == MessageType::DIRECT_MEMORY_ACCESS_READ;
+  });
+  if (dropped > 0) {
+    ESP_LOGD(TAG, "Dropped %u unanswered memory read requests", dropped);
+  }
 }
 
+void Comfortnet::expire_stalled_message_(uint32_t now) {
+  if (this->pending_messages_.empty()) {
+    return;
+  }
+  const PendingMessage &head = this->pending_messages_.front();
+  if (head.priority != MessagePriority::BACKGROUND || !head.sent ||
+      now - head.sent_time <= BACKGROUND_RESPONSE_TIMEOUT) {
+    return;
+  }
+  ESP_LOGW(TAG, "No response to our 0x%02X after %" PRIu32 " ms, dropping it", head.packet_type, now - head.sent_time);
+  this->pending_messages_.pop();
+  this->stalled_message_count_++;
+}
+
+void Comfortnet::pump_memory_reader_() {
+  uint8_t request[DMA_REQUEST_SIZE];
+  while (!this->pending_messages_.full() && PayloadPool::get_blocks_in_use() < PAYLOAD_POOL_SIZE &&
+         this->memory_reader_.next_request(request)) {
+    PendingMessageToType message(this->memory_reader_.get_node_type(), MessageType::DIRECT_MEMORY_ACCESS_READ, request,
+                                 DMA_REQUEST_SIZE);
+    message.priority = MessagePriority::BACKGROUND;
+    this->queue_message(std::move(message));
+  }
+}
+
+BidBacklog Comfortnet::bid_backlog_(uint32_t now) {
+  BidBacklog backlog;
+  backlog.pending_messages = this->pending_messages_.size();
+  if (!this->pending_messages_.empty()) {
+    backlog.oldest_age = now - this->pending_messages_.front().queued_time;
+    for (uint8_t i = 0; i < this->pending_messages_.size(); i++) {
+      backlog.top_priority = std::max(backlog.top_priority, this->pending_messages_.at(i).priority);
+    }
+  }
+  for (const auto &slot : this->command_slots_) {
+    if (slot.dirty) {
+      backlog.pending_messages++;
+      backlog.top_priority = MessagePriority::URGENT;
+      backlog.oldest_age = std::max(backlog.oldest_age, now - slot.queued_time);
+    }
+  }
+  backlog.has_due_poll = this->has_due_poll_(now);
+  return backlog;
+}
+
+void Comfortnet::command_not_acknowledged_(CommandSlot *slot) {
+  if (slot->attempts < COMMAND_MAX_ATTEMPTS) {
+    return;  // Sent again on the next token
+  }
+  ESP_LOGW(TAG, "Giving up on control command 0x%04X to node type 0x%02X after %u attempts",
+           slot->command.get_command(), slot->command.get_node_type(), slot->attempts);
+  slot->dirty = false;
+  this->command_abandoned_count_++;
+}
+
+CommandSlot *Comfortnet::next_command_slot_() {
+  CommandSlot *next = nullptr;
+  for (auto &slot : this->command_slots_) {
+    // Older than the best so far, allowing for the millisecond clock wrapping
+    if (slot.dirty && (next == nullptr || slot.queued_time - next->queued_time > UINT32_MAX / 2)) {
+      next = &slot;
+    }
+  }
+  return next;
+}
+
+void Comfortnet::sample_watermarks_() {
+  ResourceWatermarks &marks = this->watermarks_;
+  marks.peak_payload_blocks = std::max(marks.peak_payload_blocks, PayloadPool::get_blocks_in_use());
+#if defined(USE_ESP32) || defined(USE_ESP8266)
+#ifdef USE_ESP32
+  uint32_t free_heap = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+  uint32_t largest_free_block = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+  uint32_t stack_headroom = uxTaskGetStackHighWaterMark(nullptr);  // Already in bytes on ESP-IDF
+#else
+  uint32_t free_heap = ESP.getFreeHeap();
+  uint32_t largest_free_block = ESP.getMaxFreeBlockSize();
+  uint32_t stack_headroom = ESP.getFreeContStack();
+#endif
+  marks.min_free_heap = std::min(marks.min_free_heap, free_heap);
+  marks.min_largest_free_block = std::min(marks.min_largest_free_block, largest_free_block);
+  marks.min_stack_headroom = std::min(marks.min_stack_headroom, stack_headroom);
+#endif
+}
+
+void Comfortnet::publish_watermarks_() {
+  const ResourceWatermarks &marks = this->watermarks_;
+  if (marks.min_free_heap != UINT32_MAX) {
+    call_listener_(DATA_KEY_FREE_HEAP, (struct ComfortnetData) {this->device_type_, ComfortnetData::DataType::FLOAT,
+                                                                 static_cast<float>(marks.min_free_heap)});
+    call_listener_(DATA_KEY_LARGEST_FREE_BLOCK,
+                   (struct ComfortnetData) {this->device_type_, ComfortnetData::DataType::FLOAT,
+                                            static_cast<float>(marks.min_largest_free_block)});
+    call_listener_(DATA_KEY_MIN_STACK_HEADROOM,
+                   (struct ComfortnetData) {this->device_type_, ComfortnetData::DataType::FLOAT,
+                                            static_cast<float>(marks.min_stack_headroom)});
+  }
+  call_listener_(DATA_KEY_PEAK_PENDING_MESSAGES,
+                 (struct ComfortnetData) {this->device_type_, ComfortnetData::DataType::FLOAT,
+                                          static_cast<float>(marks.peak_pending_messages)});
+  call_listener_(DATA_KEY_PEAK_PAYLOAD_BLOCKS,
+                 (struct ComfortnetData) {this->device_type_, ComfortnetData::DataType::FLOAT,
+                                          static_cast<float>(marks.peak_payload_blocks)});
+}
+
+#ifdef USE_COMFORTNET_PROFILING
+void Comfortnet::publish_profile_() {
+  LoopProfiler &profiler = this->loop_profiler_;
+  if (profiler.get_loop_count() == 0) {
+    return;
+  }
+  call_listener_(DATA_KEY_LOOP_TIME_MAX, (struct ComfortnetData) {this->device_type_, ComfortnetData::DataType::FLOAT,
+                                                                   static_cast<float>(profiler.get_loop().max)});
+  call_listener_(DATA_KEY_LOOP_TIME_MEAN,
+                 (struct ComfortnetData) {this->device_type_, ComfortnetData::DataType::FLOAT,
+                                          static_cast<float>(profiler.get_mean(profiler.get_loop()))});
+  call_listener_(DATA_KEY_SLOW_LOOPS, (struct ComfortnetData) {this->device_type_, ComfortnetData::DataType::FLOAT,
+                                                                static_cast<float>(profiler.get_slow_count())});
+  for (uint8_t i = 0; i < static_cast<uint8_t>(LoopPhase::COUNT); i++) {
+    LoopPhase phase = static_cast<LoopPhase>(i);
+    const LoopPhaseStats &stats = profiler.get_phase(phase);
+    std::string key = std::string(DATA_KEY_LOOP_PHASE_PREFIX) + loop_phase_to_string(phase);
+    call_listener_(key + "_MAX", (struct ComfortnetData) {this->device_type_, ComfortnetData::DataType::FLOAT,
+                                                          static_cast<float>(stats.max)});
+    call_listener_(key + "_MEAN", (struct ComfortnetData) {this->device_type_, ComfortnetData::DataType::FLOAT,
+                                                           static_cast<float>(profiler.get_mean(stats))});
+  }
+  // Max and mean cover one update interval, so a single slow call doesn't hide every later one
+  profiler.reset();
+}
+#endif
+
 /**
  * Defined in ClimateTalk Alliance CT2.0 CT-485 Networking Specification Revision 01
  * 11.1 Slot Delay
@@ -89,75 +476,83 @@ uint16_t Comfortnet::calculate_crc_(const uint8_t *data, uint8_t data_len) {
   100  // Additionally, bus must be silent for at least 100ms before we can speak (Networking Specification 9.5)
 #define MAXIMUM_SLOT_DELAY 2500
 
-uint32_t Comfortnet::generate_slot_delay_() {
-#ifdef ARDUINO
-  return random(MINIMUM_SLOT_DELAY, MAXIMUM_SLOT_DELAY);
-#else
-  return (esp_random() % (MAXIMUM_SLOT_DELAY - MINIMUM_SLOT_DELAY + 1)) + MINIMUM_SLOT_DELAY;
-#endif
-}
-
-void Comfortnet::set_node_list_(const uint8_t *data, uint8_t data_len) {
-  for (uint8_t i = 0; i < data_len; i++) {
-    node_list_[i] = static_cast<NodeType>(data[i]);
-  }
-  node_list_size_ = data_len;
-}
+uint32_t Comfortnet::generate_slot_delay_() { return this->clock_->random(MINIMUM_SLOT_DELAY, MAXIMUM_SLOT_DELAY); }
 
-void Comfortnet::handle_message_(bool is_tx, uint32_t now) {
-  const uint8_t *data = is_tx ? tx_message_.data() : rx_message_.data();
-  uint8_t length = is_tx ? tx_message_.size() : rx_message_.size();
+void Comfortnet::handle_message_(const Frame &raw_frame, bool is_tx, uint32_t now) {
+  const FrameView frame(raw_frame);
 
   // ESP_LOGD(TAG, "[RAW DUMP] %s", format_hex_pretty(data, packet->payload_length_ + PACKET_HEADER_SIZE +
   // PACKET_CRC_SIZE).c_str());
 
-  NodeAddress dst_adr = static_cast<NodeAddress>(data[DESTINATION_ADDRESS_POS]);
-  NodeAddress src_adr = static_cast<NodeAddress>(data[SOURCE_ADDRESS_POS]);
-  Subnet subnet = static_cast<Subnet>(data[SUBNET_POS]);
-  SendMethod send_method = static_cast<SendMethod>(data[SEND_METHOD_POS]);
-  uint8_t send_param_1 = data[SEND_PARAMETER_1_POS];
-  uint8_t send_param_2 = data[SEND_PARAMETER_2_POS];
-  NodeType source_node_type = static_cast<NodeType>(data[SOURCE_NODE_TYPE_POS]);
-  MessageType message_type = static_cast<MessageType>(data[MESSAGE_TYPE_POS]);
-  uint8_t packet_number = data[PACKET_NUMBER_POS];
-  uint8_t payload_len = data[PAYLOAD_LENGTH_POS];
+  NodeAddress dst_adr = frame.destination();
+  NodeAddress src_adr = frame.source();
+  Subnet subnet = frame.subnet();
+  uint8_t send_param_1 = frame.send_param_1();
+  NodeType source_node_type = frame.source_node_type();
+  MessageType message_type = frame.message_type();
+  uint8_t packet_number = frame.packet_number();
+  uint8_t payload_len = frame.payload_length();
   // Packet data with len=payload_len
-  const uint8_t *payload = data + PACKET_HEADER_SIZE;
+  const uint8_t *payload = frame.payload();
 
   // Checksum validation by reading last 2 bytes after the data
-  uint16_t crc = (data[PACKET_HEADER_SIZE + payload_len] << 8) | data[PACKET_HEADER_SIZE + payload_len + 1];
-  uint16_t crc_check = calculate_crc_(data, PACKET_HEADER_SIZE + payload_len);
+  uint16_t crc = frame.checksum();
+  uint16_t crc_check;
+  {
+    COMFORTNET_PROFILE_PHASE(CHECKSUM);
+    crc_check = frame.calculate_checksum();
+  }
   if (crc != crc_check) {
     ESP_LOGW(TAG, "Checksum mismatch. Expected 0x%04X, got 0x%04X", crc, crc_check);
     return;
   }
+#ifdef USE_COMFORTNET_FRAME_BRIDGE
+  {
+    COMFORTNET_PROFILE_PHASE(FRAME_BRIDGE);
+    this->frame_bridge_.publish(frame, is_tx, now);
+  }
+#endif
 
-  // Notice, the checksum and payload are printed out of order here for viewing convenience!
-  ESP_LOGD(TAG,
-           "Dir | Dest | Src  | Subnet | Meth | Params | SrcNode | MsgType | PktNum | Len | Checksum | Payload HEX");
-  ESP_LOGD(
-      TAG,
-      "%s  | 0x%02X | 0x%02X | 0x%02X   | 0x%02X | 0x%04X | 0x%02X    | 0x%02X    | 0x%02X   | %-3u | 0x%04X   | %s",
-      is_tx ? "TX" : "RX", dst_adr, src_adr, subnet, send_method, (send_param_1 << 8) | send_param_2, source_node_type,
-      message_type, packet_number, payload_len, crc, esphome::format_hex_pretty(payload, payload_len).c_str());
+  {
+    COMFORTNET_PROFILE_PHASE(LOGGING);
+    // Notice, the checksum and payload are printed out of order here for viewing convenience!
+    ESP_LOGD(TAG,
+             "Dir | Dest | Src  | Subnet | Meth | Params | SrcNode | MsgType | PktNum | Len | Checksum | Payload HEX");
+    ESP_LOGD(
+        TAG,
+        "%s  | 0x%02X | 0x%02X | 0x%02X   | 0x%02X | 0x%04X | 0x%02X    | 0x%02X    | 0x%02X   | %-3u | 0x%04X   | %s",
+        is_tx ? "TX" : "RX", dst_adr, src_adr, subnet, frame.send_method(), (send_param_1 << 8) | frame.send_param_2(),
+        source_node_type, message_type, packet_number, payload_len, crc,
+        esphome::format_hex_pretty(payload, payload_len).c_str());
+  }
+  COMFORTNET_PROFILE_PHASE(DISPATCH);
   if (is_tx) {
-    if (message_type == MessageType::TOKEN_OFFER_RESPONSE) {
-      // Most likely we won the token offer broadcast
-      // We should only respond to 1 token offer per dataflow cycle to give other devices a chance
-      has_won_token_broadcast_ = true;
+    if (message_type == MessageType::SET_CONTROL_COMMAND) {
+      // Our own commands change network state just like anyone else's, so let listeners see them
+      this->eavesdrop_(frame, now);
     }
     // Stop here if this is a transmitted message
     return;
   }
 
+  this->node_registry_.observe_frame(dst_adr, src_adr, source_node_type, message_type, packet_number, payload,
+                                     payload_len, now);
+
   bool is_broadcast = dst_adr == NodeAddress::BROADCAST && (subnet == this->subnet_ || subnet == Subnet::BROADCAST);
 
   // Signals the start of a new dataflow cycle
   if (message_type == MessageType::NODE_DISCOVERY) {
-    has_won_token_broadcast_ = false;
+    this->token_bid_policy_.on_cycle();
+    this->sample_watermarks_();
+    this->memory_reader_.on_cycle();
+  }
+
+  if (this->listen_only_) {
+    // Never join the network, just watch everyone else's traffic
+    this->eavesdrop_(frame, now);
+    return;
   }
 
-  std::vector<uint8_t> return_payload;
   // Network member logic
   if (node_id_ != static_cast<NodeAddress>(0)) {
     /**
@@ -173,6 +568,11 @@ void Comfortnet::handle_message_(bool is_tx, uint32_t now) {
         if (idnum >= payload_len || static_cast<NodeType>(payload[idnum]) != device_type_) {
           ESP_LOGW(TAG, "Not in node list, disconnecting");
           disconnect_();
+        } else if (this->resuming_identity_) {
+          this->resuming_identity_ = false;
+          ESP_LOGI(TAG, "Resumed network address: 0x%02X", this->node_id_);
+          call_listener_(DATA_KEY_NETWORK_STATUS,
+                         (struct ComfortnetData) {this->device_type_, ComfortnetData::DataType::BOOLEAN, true});
         }
       } else if (message_type == MessageType::SET_ADDRESS) {
         for (uint8_t i = 0; i < MAC_ADDRESS_SIZE; i++) {
@@ -193,27 +593,34 @@ void Comfortnet::handle_message_(bool is_tx, uint32_t now) {
         this->last_address_confirm_time_ = now;
         this->node_id_ = static_cast<NodeAddress>(payload[ADDRESS_NODE_ID_POS]);
         this->subnet_ = static_cast<Subnet>(payload[ADDRESS_SUBNET_POS]);
-        return_payload.push_back(static_cast<uint8_t>(this->node_id_));
-        return_payload.push_back(static_cast<uint8_t>(this->subnet_));
-        this->mac_address_.write(return_payload);
-        this->session_id_.write(return_payload);
-        return_payload.push_back(0x01);  // Write byte must be 0x01
-        transmit_message_(NodeAddress::COORDINATOR, this->node_id_, this->subnet_, SendMethod::NO_ROUTE, 0, 0,
-                          this->device_type_, PACKET_RESPONSE(message_type),
-                          PACKET_NUMBER(false, this->subnet_ == Subnet::VERSION_1), return_payload);
+        this->queue_frame_(QueuedMessageType::NORMAL, NodeAddress::COORDINATOR, this->subnet_, SendMethod::NO_ROUTE, 0,
+                           PACKET_RESPONSE(message_type), this->packet_number_(false))
+            .append(static_cast<uint8_t>(this->node_id_))
+            .append(static_cast<uint8_t>(this->subnet_))
+            .append(this->mac_address_)
+            .append(this->session_id_)
+            .append(0x01)  // Write byte must be 0x01
+            .finish();
         this->awaiting_discovery_ = false;
+        if (this->resuming_identity_) {
+          this->resuming_identity_ = false;
+          call_listener_(DATA_KEY_NETWORK_STATUS,
+                         (struct ComfortnetData) {this->device_type_, ComfortnetData::DataType::BOOLEAN, true});
+        }
+        this->save_identity_();
         ESP_LOGI(TAG, "Network address reassigned: 0x%02X (Old: 0x%02X)", this->node_id_, start_id);
-      } else if (message_type == MessageType::TOKEN_OFFER && !has_won_token_broadcast_ &&
-                 (pending_messages_.size() > 0 || polling_queue_.size() > 0)) {
+      } else if (message_type == MessageType::TOKEN_OFFER) {
+        this->token_bid_policy_.on_offer();
         NodeType offer_node_type = static_cast<NodeType>(payload[TOKEN_OFFER_NODE_TYPE_POS]);
-        if (offer_node_type == NodeType::ANY || offer_node_type == this->device_type_) {
-          return_payload.push_back(static_cast<uint8_t>(this->node_id_));
-          return_payload.push_back(static_cast<uint8_t>(this->subnet_));
-          this->mac_address_.write(return_payload);
-          this->session_id_.write(return_payload);
-          transmit_message_(NodeAddress::COORDINATOR, this->node_id_, this->subnet_, SendMethod::NO_ROUTE, 0, 0,
-                            this->device_type_, PACKET_RESPONSE(message_type),
-                            PACKET_NUMBER(false, this->subnet_ == Subnet::VERSION_1), return_payload, true);
+        if ((offer_node_type == NodeType::ANY || offer_node_type == this->device_type_) &&
+            this->token_bid_policy_.should_bid(this->bid_backlog_(now))) {
+          this->queue_frame_(QueuedMessageType::ARBITRATION, NodeAddress::COORDINATOR, this->subnet_,
+                             SendMethod::NO_ROUTE, 0, PACKET_RESPONSE(message_type), this->packet_number_(false))
+              .append(static_cast<uint8_t>(this->node_id_))
+              .append(static_cast<uint8_t>(this->subnet_))
+              .append(this->mac_address_)
+              .append(this->session_id_)
+              .finish();
         }
       }
     } else if (dst_adr == this->node_id_ && subnet == this->subnet_) {
@@ -224,19 +631,28 @@ void Comfortnet::handle_message_(bool is_tx, uint32_t now) {
         /**
          * Core network packet
          */
-        set_node_list_(payload, payload_len);
-        transmit_message_(src_adr, this->node_id_, this->subnet_, SendMethod::NO_ROUTE, 0, 0, this->device_type_,
-                          MessageType::SET_NETWORK_NODE_LIST_RESPONSE,
-                          PACKET_NUMBER(false, this->subnet_ == Subnet::VERSION_1),
-                          reinterpret_cast<uint8_t *>(node_list_ + 0), node_list_size_);
+        this->node_registry_.set_node_list(payload, payload_len);
+        this->queue_frame_(QueuedMessageType::REPLY, src_adr, this->subnet_, SendMethod::NO_ROUTE, 0,
+                           MessageType::SET_NETWORK_NODE_LIST_RESPONSE, this->packet_number_(false))
+            .append(payload, payload_len)
+            .finish();
       } else if (message_type == MessageType::REQUEST_TO_RECEIVE_RESPONSE) {
         /**
          * R2R section
          */
-        if (pending_messages_.size() == 0 && polling_queue_.size() > 0) {
+        this->token_bid_policy_.on_granted();
+        this->expire_stalled_message_(now);
+        if (this->command_in_flight_ != nullptr) {
+          // No reply at all to the command we sent on the last token, e.g. its node type isn't on the bus
+          this->command_not_acknowledged_(this->command_in_flight_);
+          this->command_in_flight_ = nullptr;
+        }
+        CommandSlot *command = this->next_command_slot_();
+        PollQueueEntry *next_poll =
+            pending_messages_.size() == 0 && command == nullptr ? this->next_due_poll_(now) : nullptr;
+        if (next_poll != nullptr) {
           // If we have no commands to send, queue up a request to poll a device's status
-          PollQueueEntry dev = polling_queue_.front();
-          std::vector<uint8_t> payload;
+          PollQueueEntry dev = *next_poll;
           bool can_reply = true;
           if (dev.poll_message == MessageType::GET_STATUS || dev.poll_message == MessageType::GET_SENSOR_DATA ||
               dev.poll_message == MessageType::GET_IDENTIFICATION ||
@@ -249,40 +665,50 @@ void Comfortnet::handle_message_(bool is_tx, uint32_t now) {
             can_reply = false;
           }
           if (can_reply) {
-            pending_messages_.push((struct PendingMessageToType) {
-                dev.node_type,
-                dev.poll_message,
-                payload,
-            });
+            PendingMessageToType poll(dev.node_type, dev.poll_message, nullptr, 0);
+            poll.priority = MessagePriority::BACKGROUND;
+            this->queue_message(std::move(poll));
           }
         }
-        if (!this->r2r_reply_.empty()) {
+        OutboundFrame *deferred = this->find_outbound_(QueuedMessageType::DEFERRED_R2R);
+        if (deferred != nullptr) {
           /**
            * We previously received a packet that this R2R is confirming
            */
-          tx_message_.clear();
-          tx_message_.insert(tx_message_.end(), r2r_reply_.begin(), r2r_reply_.end());
-          r2r_reply_.clear();
-          message_queued_ = QueuedMessageType::NORMAL;
+          deferred->timing = QueuedMessageType::REPLY;
+          deferred->delay = this->reply_delay_;
+        } else if (command != nullptr) {
+          /**
+           * Control commands are already serialized, only the route may need patching
+           */
+          command->command.set_route(src_adr, this->node_id_, this->subnet_, this->packet_number_(false));
+          this->claim_outbound_(QueuedMessageType::REPLY)->frame = command->command.get_frame();
+          command->sent_revision = command->revision;
+          command->attempts++;
+          this->command_in_flight_ = command;
         } else if (pending_messages_.size() > 0) {
           /**
            * We have packets we need to send, send them!
            */
-          PendingMessage msg = pending_messages_.front();
-          return_payload.insert(return_payload.end(), msg.payload.begin(), msg.payload.end());
-          transmit_message_(src_adr, this->node_id_, this->subnet_, msg.send_method, msg.send_param_1, 0,
-                            this->device_type_, msg.packet_type,
-                            PACKET_NUMBER(false, this->subnet_ == Subnet::VERSION_1), return_payload);
+          PendingMessage &msg = pending_messages_.front();
+          if (!msg.sent) {
+            msg.sent = true;
+            msg.sent_time = now;
+          }
+          this->queue_frame_(QueuedMessageType::REPLY, src_adr, this->subnet_, msg.send_method, msg.send_param_1,
+                             msg.packet_type, this->packet_number_(false) | msg.segment)
+              .append(msg.payload.data(), msg.payload.size())
+              .finish();
         } else {
           /**
            * We have nothing to send, just ACK
            */
-          return_payload.push_back(R2R_ACK);
-          this->mac_address_.write(return_payload);
-          this->session_id_.write(return_payload);
-          transmit_message_(src_adr, this->node_id_, this->subnet_, SendMethod::NO_ROUTE, 0, 0, this->device_type_,
-                            MessageType::REQUEST_TO_RECEIVE_RESPONSE,
-                            PACKET_NUMBER(true, this->subnet_ == Subnet::VERSION_1), return_payload);
+          this->queue_frame_(QueuedMessageType::REPLY, src_adr, this->subnet_, SendMethod::NO_ROUTE, 0,
+                             MessageType::REQUEST_TO_RECEIVE_RESPONSE, this->packet_number_(true))
+              .append(R2R_ACK)
+              .append(this->mac_address_)
+              .append(this->session_id_)
+              .finish();
         }
       } else {
         /**
@@ -291,13 +717,27 @@ void Comfortnet::handle_message_(bool is_tx, uint32_t now) {
          * ACK...
          */
         MessageAckAction should_ack = MessageAckAction::UNKNOWN;
-        if (pending_messages_.size() > 0) {
+        CommandSlot *command = this->command_in_flight_;
+        if (command != nullptr && message_type == MessageType::SET_CONTROL_COMMAND &&
+            send_param_1 == static_cast<uint8_t>(command->command.get_node_type())) {
+          should_ack = MessageAckAction::NONE;
+          this->command_in_flight_ = nullptr;
+          if (payload_len < 1 || payload[ACK_POS] != R2R_ACK) {
+            ESP_LOGW(TAG, "Coordinator did not ACK our control command 0x%04X", command->command.get_command());
+            this->command_not_acknowledged_(command);
+          } else if (command->sent_revision == command->revision) {
+            command->dirty = false;
+          }
+        } else if (pending_messages_.size() > 0) {
           // Check if this is a reply to our request
           if (message_type == pending_messages_.front().packet_type &&
               send_param_1 == pending_messages_.front().send_param_1) {
             should_ack = MessageAckAction::NONE;
             if (payload_len < 1 || payload[ACK_POS] != R2R_ACK) {
               ESP_LOGW(TAG, "Corodinator did not ACK our 0x%02X", message_type);
+            } else if (pending_messages_.front().more_segments) {
+              // Only the last segment gets a response, so move on to the next one on the next token
+              pending_messages_.pop();
             }
           } else if (message_type == PACKET_RESPONSE(pending_messages_.front().packet_type) &&
                      send_param_1 == pending_messages_.front().send_param_1) {
@@ -305,41 +745,46 @@ void Comfortnet::handle_message_(bool is_tx, uint32_t now) {
             pending_messages_.pop();
           }
         }
-        if (should_ack == MessageAckAction::UNKNOWN && message_type == MessageType::GET_NODE_ID) {
+        if (should_ack == MessageAckAction::UNKNOWN && message_type == MessageType::SET_CONTROL_COMMAND_RESPONSE) {
+          should_ack = MessageAckAction::ACK;  // Response to a command sent from a command slot
+        } else if (should_ack == MessageAckAction::UNKNOWN && message_type == MessageType::GET_NODE_ID) {
           should_ack = MessageAckAction::ACK;
-          return_payload.push_back(static_cast<uint8_t>(this->device_type_));
-          this->mac_address_.write(return_payload);
-          this->session_id_.write(return_payload);
-          write_message_to_buffer_(r2r_reply_, src_adr, this->node_id_, this->subnet_, SendMethod::NO_ROUTE, 0, 0,
-                                   this->device_type_, PACKET_RESPONSE(message_type),
-                                   PACKET_NUMBER(false, this->subnet_ == Subnet::VERSION_1), return_payload.data(),
-                                   return_payload.size(), false, false);
+          this->queue_frame_(QueuedMessageType::DEFERRED_R2R, src_adr, this->subnet_, SendMethod::NO_ROUTE, 0,
+                             PACKET_RESPONSE(message_type), this->packet_number_(false))
+              .append(static_cast<uint8_t>(this->device_type_))
+              .append(this->mac_address_)
+              .append(this->session_id_)
+              .finish();
         } else if (should_ack == MessageAckAction::UNKNOWN && message_type == MessageType::GET_NODE_ID_RESPONSE) {
           should_ack = MessageAckAction::ACK;
-        } else if (should_ack == MessageAckAction::UNKNOWN &&
+        } else if (should_ack == MessageAckAction::UNKNOWN && payload_len > 0 &&
                    message_type == MessageType::NETWORK_SHARED_DATA_SECTOR_IMAGE_READ_WRITE_REQUEST) {
           /**
            * For redundant data storage across all network nodes
            */
           NodeType requesting_type = static_cast<NodeType>(payload[0] & 0x7F);  // Clear bit 7 and extract the node type
-          std::vector<uint8_t> *shared_data = nullptr;
-          auto iter = network_shared_data_.find(requesting_type);
-          if (iter == network_shared_data_.end()) {
-            shared_data = &network_shared_data_[requesting_type];
-          } else {
-            shared_data = &iter->second;
-          }
           should_ack = MessageAckAction::ACK;
-          return_payload.push_back(static_cast<uint8_t>(requesting_type));
+          FrameBuilder reply = this->queue_frame_(QueuedMessageType::DEFERRED_R2R, src_adr, this->subnet_,
+                                                  SendMethod::NO_ROUTE, 0, PACKET_RESPONSE(message_type),
+                                                  this->packet_number_(false));
+#ifdef USE_COMFORTNET_SHARED_DATA
+          const SharedDataSlot *shared_data = nullptr;
           if ((payload[0] & 0x80) == 0) {  // Write operation
-            shared_data->clear();
-            shared_data->insert(shared_data->end(), payload + 1, payload + payload_len);
+            shared_data = this->network_shared_data_.write(requesting_type, payload + 1, payload_len - 1);
+          } else {
+            shared_data = this->network_shared_data_.find(requesting_type);
+          }
+          // Slots hold the node type right before the image, so the reply is serialized straight from the slot
+          if (shared_data != nullptr) {
+            reply.append(shared_data->image, shared_data->length + 1);
+          } else {
+            reply.append(static_cast<uint8_t>(requesting_type));
           }
-          return_payload.insert(return_payload.end(), shared_data->begin(), shared_data->end());
-          write_message_to_buffer_(r2r_reply_, src_adr, this->node_id_, this->subnet_, SendMethod::NO_ROUTE, 0, 0,
-                                   this->device_type_, PACKET_RESPONSE(message_type),
-                                   PACKET_NUMBER(false, this->subnet_ == Subnet::VERSION_1), return_payload.data(),
-                                   return_payload.size(), false, false);
+#else
+          // Without storage every read comes back empty, like a node that has nothing saved for the requester
+          reply.append(static_cast<uint8_t>(requesting_type));
+#endif
+          reply.finish();
         } else if (should_ack == MessageAckAction::UNKNOWN &&
                    message_type == MessageType::NETWORK_SHARED_DATA_SECTOR_IMAGE_READ_WRITE_REQUEST_RESPONSE) {
           should_ack = MessageAckAction::NONE;
@@ -348,12 +793,12 @@ void Comfortnet::handle_message_(bool is_tx, uint32_t now) {
           }
         }
         if (should_ack == MessageAckAction::ACK) {
-          return_payload.clear();
-          return_payload.push_back(R2R_ACK);
-          this->mac_address_.write(return_payload);
-          this->session_id_.write(return_payload);
-          transmit_message_(src_adr, this->node_id_, this->subnet_, SendMethod::NO_ROUTE, 0, 0, this->device_type_,
-                            message_type, PACKET_NUMBER(true, this->subnet_ == Subnet::VERSION_1), return_payload);
+          this->queue_frame_(QueuedMessageType::REPLY, src_adr, this->subnet_, SendMethod::NO_ROUTE, 0, message_type,
+                             this->packet_number_(true))
+              .append(R2R_ACK)
+              .append(this->mac_address_)
+              .append(this->session_id_)
+              .finish();
         } else if (should_ack == MessageAckAction::NAK) {
           ESP_LOGW(TAG, "We are supposed to NAK to 0x%02X, but don't know how!", message_type);
         } else if (!PACKET_IS_DATAFLOW(packet_number) && should_ack == MessageAckAction::UNKNOWN) {
@@ -370,13 +815,14 @@ void Comfortnet::handle_message_(bool is_tx, uint32_t now) {
       if (discovery_node_type == NodeType::ANY || discovery_node_type == this->device_type_) {
         ESP_LOGI(TAG, "Received discovery request, responding...");
         session_id_.setRandom();  // Generate a session ID
-        return_payload.push_back(static_cast<uint8_t>(this->device_type_));
-        return_payload.push_back(0x00);  // Reserved
-        this->mac_address_.write(return_payload);
-        this->session_id_.write(return_payload);
-        transmit_message_(NodeAddress::COORDINATOR, this->node_id_, Subnet::BROADCAST, SendMethod::NO_ROUTE, 0, 0,
-                          this->device_type_, PACKET_RESPONSE(message_type),
-                          PACKET_NUMBER(false, this->ct_version_ == 1), return_payload, true);
+        this->queue_frame_(QueuedMessageType::ARBITRATION, NodeAddress::COORDINATOR, Subnet::BROADCAST,
+                           SendMethod::NO_ROUTE, 0, PACKET_RESPONSE(message_type),
+                           PACKET_NUMBER(false, this->ct_version_ == 1))
+            .append(static_cast<uint8_t>(this->device_type_))
+            .append(0x00)  // Reserved
+            .append(this->mac_address_)
+            .append(this->session_id_)
+            .finish();
         awaiting_discovery_ = true;
       }
     } else if (is_broadcast && message_type == MessageType::SET_ADDRESS) {
@@ -398,15 +844,16 @@ void Comfortnet::handle_message_(bool is_tx, uint32_t now) {
       this->last_address_confirm_time_ = now;
       this->node_id_ = static_cast<NodeAddress>(payload[ADDRESS_NODE_ID_POS]);
       this->subnet_ = static_cast<Subnet>(payload[ADDRESS_SUBNET_POS]);
-      return_payload.push_back(static_cast<uint8_t>(this->node_id_));
-      return_payload.push_back(static_cast<uint8_t>(this->subnet_));
-      this->mac_address_.write(return_payload);
-      this->session_id_.write(return_payload);
-      return_payload.push_back(0x01);  // Write byte must be 0x01
-      transmit_message_(NodeAddress::COORDINATOR, this->node_id_, this->subnet_, SendMethod::NO_ROUTE, 0, 0,
-                        this->device_type_, PACKET_RESPONSE(message_type),
-                        PACKET_NUMBER(false, this->subnet_ == Subnet::VERSION_1), return_payload);
+      this->queue_frame_(QueuedMessageType::NORMAL, NodeAddress::COORDINATOR, this->subnet_, SendMethod::NO_ROUTE, 0,
+                         PACKET_RESPONSE(message_type), this->packet_number_(false))
+          .append(static_cast<uint8_t>(this->node_id_))
+          .append(static_cast<uint8_t>(this->subnet_))
+          .append(this->mac_address_)
+          .append(this->session_id_)
+          .append(0x01)  // Write byte must be 0x01
+          .finish();
       this->awaiting_discovery_ = false;
+      this->save_identity_();
       if (start_id == static_cast<NodeAddress>(0)) {
         ESP_LOGI(TAG, "Joined network as address: 0x%02X", this->node_id_);
         call_listener_(DATA_KEY_NETWORK_STATUS,
@@ -418,120 +865,331 @@ void Comfortnet::handle_message_(bool is_tx, uint32_t now) {
   }
   // End network member logic
 
-  // Network eavesdropping logic
-  if (PACKET_IS_DATAFLOW(packet_number) && payload_len == 17 && payload[ACK_POS] == R2R_ACK &&
-      src_adr != NodeAddress::BROADCAST &&
-      static_cast<uint8_t>(src_adr) < MAX_PAYLOAD_SIZE) {  // Simple check for ACK messages
-    for (uint8_t i = 0; i < MAC_ADDRESS_SIZE; i++) {
-      this->node_mac_list_[static_cast<uint8_t>(src_adr)].mac[i] = payload[i + 1];  // Copy MAC to list
+  this->eavesdrop_(frame, now);
+}
+
+void Comfortnet::eavesdrop_(const FrameView &frame, uint32_t now) {
+  if (frame.message_type() == MessageType::DIRECT_MEMORY_ACCESS_READ_RESPONSE &&
+      frame.destination() == this->node_id_ && this->memory_reader_.is_active() &&
+      frame.source_node_type() == this->memory_reader_.get_node_type()) {
+    // Always a single frame, even when a full chunk fills the payload
+    this->memory_reader_.handle_response(frame.payload(), frame.payload_length(), now);
+    if (!this->memory_reader_.is_active()) {
+      // The node had nothing more to give us, so any requests past the end are moot
+      this->drop_memory_requests_();
     }
+    this->pump_memory_reader_();
+    return;
+  }
+
+  if (this->segment_assembler_.feed(frame, now)) {
+    return;  // Passed on once the rest of the message is in
   }
+  this->dispatch_message_(frame, frame.payload(), frame.payload_length(), now);
+}
+
+void Comfortnet::dispatch_message_(const FrameView &frame, const uint8_t *payload, uint16_t payload_len,
+                                   uint32_t now) {
+  NodeAddress dst_adr = frame.destination();
+  NodeAddress src_adr = frame.source();
+  NodeType source_node_type = frame.source_node_type();
+  MessageType message_type = frame.message_type();
+
+#ifdef USE_COMFORTNET_COMMAND_LISTENERS
   if (message_type == MessageType::SET_CONTROL_COMMAND || message_type == MessageType::SET_CONTROL_COMMAND_RESPONSE) {
     if (message_type == MessageType::SET_CONTROL_COMMAND_RESPONSE && payload_len <= CONTROL_CMD_SIZE) {
       return;  // This is just an ACK, so we can't get any useful data from it
     }
     CommandType command_type = static_cast<CommandType>((payload[CONTROL_CMD_POS + 1] << 8) | payload[CONTROL_CMD_POS]);
     const uint8_t *cmd_payload = payload + CONTROL_CMD_SIZE;
-    uint8_t cmd_payload_len = payload_len - CONTROL_CMD_SIZE;
+    uint16_t cmd_payload_len = payload_len - CONTROL_CMD_SIZE;
     ESP_LOGD(TAG, "Command | Payload HEX");
     ESP_LOGD(TAG, "0x%04X  | %s", command_type, esphome::format_hex_pretty(cmd_payload, cmd_payload_len).c_str());
+    NodeType command_node_type = source_node_type;
+    if (message_type == MessageType::SET_CONTROL_COMMAND) {
+      // Commands routed by the coordinator name the target type in the header rather than the address
+      command_node_type = frame.send_method() == SendMethod::NODE_TYPE ? static_cast<NodeType>(frame.send_param_1())
+                                                                       : get_node_type_(dst_adr);
+    }
     call_command_listener_((struct ComfortnetCommandData) {
-        message_type == MessageType::SET_CONTROL_COMMAND ? get_node_type_(dst_adr) : source_node_type,
-        get_node_mac_(message_type == MessageType::SET_CONTROL_COMMAND ? dst_adr : src_adr), command_type,
-        message_type == MessageType::SET_CONTROL_COMMAND_RESPONSE, cmd_payload, cmd_payload_len});
-  } else if (!PACKET_IS_DATAFLOW(packet_number) && (message_type == MessageType::GET_STATUS_RESPONSE ||
-                                                    message_type == MessageType::GET_SENSOR_DATA_RESPONSE ||
-                                                    message_type == MessageType::GET_CONFIGURATION_RESPONSE ||
-                                                    message_type == MessageType::GET_IDENTIFICATION_RESPONSE)) {
+        command_node_type, get_node_mac_(message_type == MessageType::SET_CONTROL_COMMAND ? dst_adr : src_adr),
+        command_type, message_type == MessageType::SET_CONTROL_COMMAND_RESPONSE, cmd_payload, cmd_payload_len});
+    return;
+  }
+#endif
+  if (!PACKET_IS_DATAFLOW(frame.packet_number()) && (message_type == MessageType::GET_STATUS_RESPONSE ||
+                                                            message_type == MessageType::GET_SENSOR_DATA_RESPONSE ||
+                                                            message_type == MessageType::GET_CONFIGURATION_RESPONSE ||
+                                                            message_type == MessageType::GET_IDENTIFICATION_RESPONSE)) {
+    if (dst_adr != this->node_id_) {
+      // Someone else asked for this, so there is no need for us to poll it as well for a while
+      MessageType request_type = PACKET_REQUEST(message_type);
+      for (auto &entry : this->polling_queue_) {
+        if (entry.node_type == source_node_type && entry.poll_message == request_type) {
+          entry.seen_passively = true;
+          entry.last_passive_time = now;
+          entry.suppression_counted = false;
+        }
+      }
+    } else {
+      this->device_poll_to_end(source_node_type, PACKET_REQUEST(message_type));
+    }
+    this->decode_catalog_(source_node_type, message_type, payload, payload_len);
+#ifdef USE_COMFORTNET_PACKET_LISTENERS
     call_packet_listener_(
         (struct ComfortnetPacketData) {source_node_type, get_node_mac_(src_adr), message_type, payload, payload_len});
+#endif
+  }
+}
+
+void Comfortnet::register_catalog_polling(const std::string &data_key, NodeType node_type) {
+  if (node_type == NodeType::ANY) {
+    return;  // We can't poll without knowing who to ask
   }
-  // End network eavesdropping logic
-}
-
-void Comfortnet::write_message_to_buffer_(std::vector<uint8_t> &buffer, NodeAddress dst_adr, NodeAddress src_adr,
-                                          Subnet subnet, SendMethod send_method, uint8_t send_param_1,
-                                          uint8_t send_param_2, NodeType src_node_type, MessageType msg_type,
-                                          uint8_t packet_num, const uint8_t *data, uint8_t data_len, bool queue_send,
-                                          bool require_arbitration) {
-  buffer.clear();
-  // Write packet header
-  buffer.push_back(static_cast<uint8_t>(dst_adr));
-  buffer.push_back(static_cast<uint8_t>(src_adr));
-  buffer.push_back(static_cast<uint8_t>(subnet));
-  buffer.push_back(static_cast<uint8_t>(send_method));
-  buffer.push_back(send_param_1);
-  buffer.push_back(send_param_2);
-  buffer.push_back(static_cast<uint8_t>(src_node_type));
-  buffer.push_back(static_cast<uint8_t>(msg_type));
-  buffer.push_back(packet_num);
-  buffer.push_back(data_len);
-  // Write packet
-  buffer.insert(buffer.end(), data, data + data_len);
-  // Calculate CRC
-  uint16_t crc = calculate_crc_(buffer.data(), PACKET_HEADER_SIZE + data_len);
-  buffer.push_back((crc >> 8) & 0xFF);
-  buffer.push_back(crc & 0xFF);
-
-  if (queue_send) {
-    message_queued_ = require_arbitration ? QueuedMessageType::ARBITRATION : QueuedMessageType::NORMAL;
-    if (message_queued_ == QueuedMessageType::ARBITRATION) {
-      slot_delay_ = generate_slot_delay_();
-      ESP_LOGI(TAG, "Will arbitrate with slot delay of %u", slot_delay_);
+  for (size_t i = 0; i < CATALOG_FIELD_COUNT; i++) {
+    const CatalogField &field = CATALOG_FIELDS[i];
+    if (data_key == field.data_key && (field.node_type == NodeType::ANY || field.node_type == node_type)) {
+      this->register_device_polling(node_type, PACKET_REQUEST(field.message_type),
+                                    field.message_type == MessageType::GET_IDENTIFICATION_RESPONSE);
     }
   }
 }
 
-void Comfortnet::read_buffer_(int bytes_available, uint32_t now) {
-  uint8_t bytes[bytes_available];
+void Comfortnet::decode_catalog_(NodeType node_type, MessageType message_type, const uint8_t *payload,
+                                 uint16_t payload_len) {
+  if (this->catalog_dirty_) {
+    this->catalog_dirty_ = false;
+    this->bound_catalog_fields_.clear();
+    for (size_t i = 0; i < CATALOG_FIELD_COUNT; i++) {
+      auto iter = this->listeners_.find(CATALOG_FIELDS[i].data_key);
+      if (iter != this->listeners_.end()) {
+        this->bound_catalog_fields_.push_back((struct BoundCatalogField) {&CATALOG_FIELDS[i], &iter->second});
+      }
+    }
+  }
+
+  if (this->bound_catalog_fields_.empty()) {
+    return;
+  }
 
-  if (!this->read_array(bytes, bytes_available)) {
+  if (message_type == MessageType::GET_IDENTIFICATION_RESPONSE) {
+    // Not MDI formatted, fields are read from the payload as is
+    this->match_catalog_(node_type, message_type, CATALOG_RAW_PAYLOAD, payload, payload_len);
     return;
   }
+  uint16_t i = 0;
+  while (i + 2 <= payload_len) {
+    uint8_t tag = payload[i];
+    uint8_t len = payload[i + 1];
+    if (i + 2 + len > payload_len) {
+      return;
+    }
+    this->match_catalog_(node_type, message_type, tag, payload + i + 2, len);
+    i += 2 + len;
+  }
+}
+
+void Comfortnet::match_catalog_(NodeType node_type, MessageType message_type, uint8_t tag, const uint8_t *data,
+                                uint16_t data_len) {
+  for (const auto &bound : this->bound_catalog_fields_) {
+    const CatalogField &field = *bound.field;
+    if (field.message_type == message_type && field.dbid_tag == tag && data_len >= field.min_len &&
+        (field.node_type == NodeType::ANY || field.node_type == node_type)) {
+      this->publish_catalog_field_(bound, node_type, data);
+    }
+  }
+}
+
+void Comfortnet::publish_catalog_field_(const BoundCatalogField &bound, NodeType node_type, const uint8_t *data) {
+  const CatalogField &field = *bound.field;
+  const uint8_t *value = data + field.offset;
+  char text[7];
+  ComfortnetData::DataType type = ComfortnetData::DataType::FLOAT;
+  ComfortnetData::DataVariant decoded;
+  switch (field.format) {
+    case FieldFormat::PERCENT_HALF:
+      decoded = value[0] / 2.0f;
+      break;
+    case FieldFormat::UINT8:
+      if (value[0] == 0xFF) {
+        return;  // Not available
+      }
+      decoded = static_cast<float>(value[0]);
+      break;
+    case FieldFormat::UINT16:
+      decoded = static_cast<float>((value[1] << 8) | value[0]);
+      break;
+    case FieldFormat::SENSOR: {
+      std::optional<float> reading = decode_sensor_value(value);
+      if (!reading.has_value()) {
+        return;
+      }
+      decoded = *reading;
+      break;
+    }
+    case FieldFormat::FLAG:
+      type = ComfortnetData::DataType::BOOLEAN;
+      decoded = (value[0] & (1 << field.bit)) != 0;
+      break;
+    case FieldFormat::HEX8:
+      type = ComfortnetData::DataType::STRING;
+      snprintf(text, sizeof(text), "0x%02X", value[0]);
+      decoded = std::string(text);
+      break;
+    case FieldFormat::HEX16:
+      type = ComfortnetData::DataType::STRING;
+      snprintf(text, sizeof(text), "0x%04X", (value[1] << 8) | value[0]);
+      decoded = std::string(text);
+      break;
+  }
+  const ComfortnetData datapoint(node_type, type, decoded);
+  for (auto &callback : *bound.listeners) {
+    callback(datapoint);
+  }
+}
+
+bool Comfortnet::has_due_poll_(uint32_t now) const {
+  for (const auto &entry : this->polling_queue_) {
+    if (!this->is_poll_fresh_(entry, now)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+PollQueueEntry *Comfortnet::next_due_poll_(uint32_t now) {
+  for (size_t i = 0; i < this->polling_queue_.size(); i++) {
+    PollQueueEntry &entry = this->polling_queue_.front();
+    if (!this->is_poll_fresh_(entry, now)) {
+      return &entry;
+    }
+    if (!entry.suppression_counted) {
+      // Later scans keep passing over it until it goes stale, but that is still the one poll we didn't send
+      entry.suppression_counted = true;
+      this->poll_suppressed_count_++;
+    }
+    std::rotate(this->polling_queue_.begin(), this->polling_queue_.begin() + 1, this->polling_queue_.end());
+  }
+  return nullptr;
+}
+
+OutboundFrame *Comfortnet::claim_outbound_(QueuedMessageType timing) {
+  OutboundFrame *slot = nullptr;
+  for (auto &outbound : this->outbound_frames_) {
+    if (outbound.timing == QueuedMessageType::NONE) {
+      slot = &outbound;
+      break;
+    }
+  }
+  if (slot == nullptr) {
+    // Every slot is in use, so give up on the oldest frame rather than the one we are building now
+    for (auto &outbound : this->outbound_frames_) {
+      if (&outbound != this->transmitting_ && (slot == nullptr || outbound.sequence < slot->sequence)) {
+        slot = &outbound;
+      }
+    }
+    this->outbound_overwrite_count_++;
+    ESP_LOGW(TAG, "Outbound frame queue full, dropping queued message type 0x%02X",
+             FrameView(slot->frame).message_type());
+  }
+
+  slot->timing = timing;
+  slot->sequence = this->outbound_sequence_++;
+  if (timing == QueuedMessageType::ARBITRATION) {
+    slot->delay = generate_slot_delay_();
+    ESP_LOGI(TAG, "Will arbitrate with slot delay of %u", slot->delay);
+  } else if (timing == QueuedMessageType::REPLY) {
+    slot->delay = this->reply_delay_;
+  } else {
+    slot->delay = MINIMUM_SLOT_DELAY;
+  }
+  return slot;
+}
 
-  for (int i = 0; i < bytes_available; i++) {
-    rx_message_.push_back(bytes[i]);
+FrameBuilder Comfortnet::queue_frame_(QueuedMessageType timing, NodeAddress dst_adr, Subnet subnet,
+                                      SendMethod send_method, uint8_t send_param_1, MessageType msg_type,
+                                      uint8_t packet_num) {
+  FrameBuilder builder(this->claim_outbound_(timing)->frame);
+  builder.header(dst_adr, this->node_id_, subnet, send_method, send_param_1, 0, this->device_type_, msg_type,
+                 packet_num);
+  return builder;
+}
 
-    if (rx_message_.size() > PAYLOAD_LENGTH_POS &&
-        rx_message_.size() == PACKET_HEADER_SIZE + rx_message_[PAYLOAD_LENGTH_POS] + PACKET_CRC_SIZE) {
-      // We have a full message
-      this->handle_message_(false, now);
-      rx_message_.clear();
+OutboundFrame *Comfortnet::find_outbound_(QueuedMessageType timing) {
+  OutboundFrame *found = nullptr;
+  for (auto &outbound : this->outbound_frames_) {
+    bool matches = timing == QueuedMessageType::NONE
+                       ? outbound.timing == QueuedMessageType::NORMAL ||
+                             outbound.timing == QueuedMessageType::ARBITRATION ||
+                             outbound.timing == QueuedMessageType::REPLY
+                       : outbound.timing == timing;
+    if (matches && (found == nullptr || outbound.sequence < found->sequence)) {
+      found = &outbound;
+    }
+  }
+  return found;
+}
+
+void Comfortnet::clear_outbound_() {
+  for (auto &outbound : this->outbound_frames_) {
+    if (&outbound == this->transmitting_) {
+      continue;  // Still on the wire, finish_transmit_() releases it
+    }
+    outbound.timing = QueuedMessageType::NONE;
+    outbound.frame.clear();
+  }
+}
+
+void Comfortnet::read_buffer_(int bytes_available, uint32_t now) {
+  uint8_t bytes[READ_CHUNK_SIZE];
+
+  while (bytes_available > 0) {
+    int chunk_size = std::min<int>(bytes_available, READ_CHUNK_SIZE);
+    if (!this->read_array(bytes, chunk_size)) {
+      return;
+    }
+    bytes_available -= chunk_size;
+
+    for (int i = 0; i < chunk_size; i++) {
+      if (!rx_message_.push_back(bytes[i])) {
+        ESP_LOGW(TAG, "Frame exceeds the maximum size, dropping it");
+        rx_message_.clear();
+        continue;
+      }
+
+      if (rx_message_.is_complete()) {
+        // We have a full message
+        this->handle_message_(this->rx_message_, false, now);
+        rx_message_.clear();
+      }
     }
   }
 }
 
 void Comfortnet::loop() {
-#ifdef ARDUINO
-  const uint32_t now = millis();
-#else
-  const uint32_t now = (uint32_t) (esp_timer_get_time() / 1000);
+  const uint32_t now = this->clock_->millis();
+#ifdef USE_COMFORTNET_PROFILING
+  this->loop_profiler_.begin_loop(this->clock_->micros());
 #endif
-  if (message_queued_ != QueuedMessageType::NONE) {
-    uint32_t delay = message_queued_ == QueuedMessageType::ARBITRATION ? this->slot_delay_ : MINIMUM_SLOT_DELAY;
-    if (now - this->last_read_time_ > delay) {
+  {
+    COMFORTNET_PROFILE_PHASE(TRANSMIT);
+    if (this->transmitting_ != nullptr &&
+        static_cast<int32_t>(this->clock_->micros() - this->transmit_done_time_) >= 0) {
+      this->finish_transmit_(now);
+    }
+    OutboundFrame *outbound =
+        this->transmitting_ == nullptr ? this->find_outbound_(QueuedMessageType::NONE) : nullptr;
+    if (outbound != nullptr && now - this->last_read_time_ > outbound->delay) {
       if (this->available() > 0) {
         // Final check if line is busy
-        message_queued_ = QueuedMessageType::NONE;
-        slot_delay_ = 0;
-        tx_message_.clear();
+        outbound->timing = QueuedMessageType::NONE;
+        outbound->frame.clear();
         if (awaiting_discovery_) {
           session_id_.clear();
         }
         awaiting_discovery_ = false;
       } else {
-        if (this->flow_control_pin_ != nullptr) {
-          this->flow_control_pin_->digital_write(true);
-        }
-        this->write_array(tx_message_.data(), tx_message_.size());
-        this->flush();
-        if (this->flow_control_pin_ != nullptr) {
-          this->flow_control_pin_->digital_write(false);
-        }
-        this->handle_message_(true, now);
-        message_queued_ = QueuedMessageType::NONE;
-        slot_delay_ = 0;
-        tx_message_.clear();
+        this->start_transmit_(outbound, now);
       }
     }
   }
@@ -539,6 +1197,7 @@ void Comfortnet::loop() {
   // Read Everything that is in the buffer
   int bytes_available = this->available();
   if (bytes_available > 0) {
+    COMFORTNET_PROFILE_PHASE(UART_READ);
     this->last_read_time_ = now;
     this->read_buffer_(bytes_available, now);
   } else if (node_id_ != static_cast<NodeAddress>(0) && now - this->last_read_time_ > SILENCE_TIMEOUT) {
@@ -553,16 +1212,116 @@ void Comfortnet::loop() {
     ESP_LOGW(TAG, "Dropped from network, discarding session information");
     disconnect_();
   }
+  {
+    COMFORTNET_PROFILE_PHASE(HOUSEKEEPING);
+#ifdef USE_COMFORTNET_SHARED_DATA
+    this->network_shared_data_.loop(now);
+#endif
+    this->segment_assembler_.expire(now);
+    bool reading = this->memory_reader_.is_active();
+    bool retry = this->memory_reader_.expire(now);
+    if (retry || (reading && !this->memory_reader_.is_active())) {
+      // Requests still queued were either lost or are about to be asked for again, and would only block the queue
+      this->drop_memory_requests_();
+    }
+    if (retry) {
+      this->pump_memory_reader_();
+    }
+  }
+#ifdef USE_COMFORTNET_FRAME_BRIDGE
+  if (this->frame_bridge_.is_enabled()) {
+    COMFORTNET_PROFILE_PHASE(FRAME_BRIDGE);
+    this->frame_bridge_.loop(now, [this](const FrameView &frame) {
+      if (this->pending_messages_.full() || PayloadPool::get_blocks_in_use() >= PAYLOAD_POOL_SIZE) {
+        return FrameBridge::InjectResult::BUSY;
+      }
+      // Our own address, node type and packet number are filled in when the frame is actually sent
+      bool queued = this->queue_message(PendingMessage(frame.send_method(), frame.send_param_1(),
+                                                       frame.message_type(), frame.payload(), frame.payload_length()));
+      return queued ? FrameBridge::InjectResult::ACCEPTED : FrameBridge::InjectResult::REJECTED;
+    });
+  }
+#endif
+  if (now - this->last_watermark_publish_time_ >= this->update_interval_millis_) {
+    this->last_watermark_publish_time_ = now;
+    this->publish_watermarks_();
+#ifdef USE_COMFORTNET_PROFILING
+    this->publish_profile_();
+#endif
+  }
+#ifdef USE_COMFORTNET_PROFILING
+  LoopProfiler &profiler = this->loop_profiler_;
+  uint32_t loop_time = profiler.end_loop(this->clock_->micros());
+  if (loop_time >= profiler.get_slow_threshold()) {
+    // Logged after the loop is timed, so the log line itself isn't part of the capture
+    ESP_LOGW(TAG,
+             "Slow loop: %" PRIu32 " us (Transmit %" PRIu32 ", UART Read %" PRIu32 ", Checksum %" PRIu32
+             ", Logging %" PRIu32 ", Dispatch %" PRIu32 ", Listeners %" PRIu32 ", Frame Bridge %" PRIu32
+             ", Housekeeping %" PRIu32 ", Other %" PRIu32 ")",
+             loop_time, profiler.get_last_slow_phase_time(LoopPhase::TRANSMIT),
+             profiler.get_last_slow_phase_time(LoopPhase::UART_READ),
+             profiler.get_last_slow_phase_time(LoopPhase::CHECKSUM),
+             profiler.get_last_slow_phase_time(LoopPhase::LOGGING),
+             profiler.get_last_slow_phase_time(LoopPhase::DISPATCH),
+             profiler.get_last_slow_phase_time(LoopPhase::LISTENERS),
+             profiler.get_last_slow_phase_time(LoopPhase::FRAME_BRIDGE),
+             profiler.get_last_slow_phase_time(LoopPhase::HOUSEKEEPING),
+             profiler.get_last_slow_phase_time(LoopPhase::OTHER));
+  }
+#endif
+}
+
+void Comfortnet::start_transmit_(OutboundFrame *outbound, uint32_t now) {
+  if (outbound->timing == QueuedMessageType::REPLY) {
+    this->max_reply_turnaround_ = std::max(this->max_reply_turnaround_, now - this->last_read_time_);
+  }
+  if (this->flow_control_pin_ != nullptr) {
+    this->flow_control_pin_->digital_write(true);
+  }
+  // The UART shifts the frame out in the background, we only need to know when it will be done
+  uint32_t start = this->clock_->micros();
+  this->write_array(outbound->frame.data, outbound->frame.size);
+  this->transmit_done_time_ = start + this->frame_airtime_(outbound->frame.size);
+  this->transmitting_ = outbound;
+  // Keep loop() running fast, so the driver is released as soon as the last bit is out
+  this->high_freq_.start();
+}
+
+void Comfortnet::finish_transmit_(uint32_t now) {
+  if (this->flow_control_pin_ != nullptr) {
+    this->flow_control_pin_->digital_write(false);
+  }
+  this->high_freq_.stop();
+  OutboundFrame *outbound = this->transmitting_;
+  this->handle_message_(outbound->frame, true, now);
+  this->transmitting_ = nullptr;
+  outbound->timing = QueuedMessageType::NONE;
+  outbound->frame.clear();
+}
+
+uint32_t Comfortnet::frame_airtime_(uint8_t frame_size) const {
+  const esphome::uart::UARTComponent *uart = this->parent_;
+  uint32_t baud_rate = uart->get_baud_rate();
+  if (baud_rate == 0) {
+    return 0;
+  }
+  uint32_t bits_per_byte = 1 + uart->get_data_bits() + uart->get_stop_bits() +
+                           (uart->get_parity() == esphome::uart::UART_CONFIG_PARITY_NONE ? 0 : 1);
+  return static_cast<uint32_t>(static_cast<uint64_t>(frame_size) * bits_per_byte * 1000000 / baud_rate) +
+         TRANSMIT_MARGIN;
 }
 
 void Comfortnet::disconnect_() {
   rx_message_.clear();
-  tx_message_.clear();
-  r2r_reply_.clear();
-  message_queued_ = QueuedMessageType::NONE;
-  slot_delay_ = 0;
+  this->clear_outbound_();
+  this->segment_assembler_.clear();
+  this->memory_reader_.cancel();
+  this->drop_memory_requests_();
+  this->node_registry_.clear();
+  this->command_in_flight_ = nullptr;
   awaiting_discovery_ = false;
-  has_won_token_broadcast_ = false;
+  this->token_bid_policy_.reset();
+  resuming_identity_ = false;
 
   node_id_ = static_cast<NodeAddress>(0);
   subnet_ = Subnet::BROADCAST;
@@ -2,13 +2,26 @@
 
 #include <set>
 #include <map>
-#include <queue>
 #include <variant>
 #include <optional>
 #include <algorithm>
 #include "types.h"
+#include "frame.h"
+#include "node_registry.h"
+#include "shared_data_store.h"
+#include "segment_assembler.h"
+#include "memory_reader.h"
+#include "frame_bridge.h"
+#include "token_bid_policy.h"
+#include "datapoint_catalog.h"
+#include "command_template.h"
+#include "clock.h"
+#include "loop_profiler.h"
+#include "payload_pool.h"
+#include "static_queue.h"
 #include "esphome/core/component.h"
 #include "esphome/core/helpers.h"
+#include "esphome/core/preferences.h"
 #include "esphome/components/uart/uart.h"
 
 namespace comfortnet {
@@ -17,6 +30,8 @@ enum class QueuedMessageType : uint8_t {
   NONE = 0,
   NORMAL = 1,
   ARBITRATION = 2,
+  DEFERRED_R2R = 3,  // Held until the coordinator gives us the token with a R2R
+  REPLY = 4,         // Direct reply to a frame addressed to us, only needs the short reply turnaround
 };
 
 enum class MessageAckAction : uint8_t {
@@ -30,47 +45,123 @@ struct PollQueueEntry {
   NodeType node_type;
   MessageType poll_message;
   bool poll_once;
+  uint32_t interval;                // How long a response seen on the bus stays fresh, 0 to use the update interval
+  bool seen_passively{false};       // Whether another node's poll has been answered yet
+  uint32_t last_passive_time{0};    // When the response to another node's poll was last seen
+  bool suppression_counted{false};  // Whether skipping our poll for that response was already counted
 
-  PollQueueEntry(NodeType node_type, MessageType poll_message, bool poll_once)
-      : node_type(node_type), poll_message(poll_message), poll_once(poll_once) {};
+  PollQueueEntry(NodeType node_type, MessageType poll_message, bool poll_once, uint32_t interval = 0)
+      : node_type(node_type), poll_message(poll_message), poll_once(poll_once), interval(interval) {};
 
   bool operator==(const PollQueueEntry &other) const {
     return node_type == other.node_type && poll_message == other.poll_message;
   }
 };
 
+#define OUTBOUND_FRAME_QUEUE_SIZE 4
+// Bus idle time before a direct reply goes out, well inside the time a requester waits for its answer
+#define DEFAULT_REPLY_DELAY 10
+
+/**
+ * A fully serialized frame waiting for the bus
+ */
+struct OutboundFrame {
+  Frame frame;
+  QueuedMessageType timing{QueuedMessageType::NONE};  // NONE when the slot is free
+  uint32_t delay{0};                                  // Required bus idle time before sending
+  uint32_t sequence{0};                               // Order the frame was queued in
+};
+
+#define PENDING_MESSAGE_QUEUE_SIZE 8
+#define COMMAND_SLOT_COUNT 8
+
+/**
+ * Latest value of a control command we are writing. A new value replaces one that hasn't been sent yet.
+ */
+struct CommandSlot {
+  CommandTemplate command;
+  bool dirty{false};         // Holds a value the node hasn't acknowledged yet
+  uint8_t revision{0};       // Bumped on every new value
+  uint8_t sent_revision{0};  // Revision of the last frame sent
+  uint32_t queued_time{0};   // When the slot last became dirty
+  uint8_t attempts{0};       // Times the current value was sent without being acknowledged
+};
+
 struct PendingMessage {
   SendMethod send_method;
   uint8_t send_param_1;
   MessageType packet_type;
-  std::vector<uint8_t> payload;
-
-  PendingMessage(SendMethod send_method, uint8_t send_param_1, MessageType packet_type, std::vector<uint8_t> payload)
+  PooledPayload payload;
+  uint8_t segment{0};         // Index of this segment, when the message is too large for one frame
+  bool more_segments{false};  // Whether more segments of the same message follow this one, only kept for ourselves
+  MessagePriority priority{MessagePriority::NORMAL};
+  uint32_t queued_time{0};
+  bool sent{false};       // Whether it went out on a token and is waiting for its response
+  uint32_t sent_time{0};  // When it first went out
+
+  PendingMessage(SendMethod send_method, uint8_t send_param_1, MessageType packet_type, const uint8_t *data,
+                 size_t data_len)
+      : send_method(send_method), send_param_1(send_param_1), packet_type(packet_type), payload(data, data_len) {};
+  PendingMessage(SendMethod send_method, uint8_t send_param_1, MessageType packet_type,
+                 const std::vector<uint8_t> &payload)
       : send_method(send_method), send_param_1(send_param_1), packet_type(packet_type), payload(payload) {};
 };
 
 struct PendingMessageByCommand : PendingMessage {
   SendMethodControlCommand command_type;
 
-  PendingMessageByCommand(SendMethodControlCommand command_type, MessageType packet_type, std::vector<uint8_t> payload)
-      : command_type(command_type),
-        PendingMessage(SendMethod::CONTROL_COMMAND, static_cast<uint8_t>(command_type), packet_type, payload) {};
+  PendingMessageByCommand(SendMethodControlCommand command_type, MessageType packet_type, const uint8_t *data,
+                          size_t data_len)
+      : PendingMessage(SendMethod::CONTROL_COMMAND, static_cast<uint8_t>(command_type), packet_type, data, data_len),
+        command_type(command_type) {};
+  PendingMessageByCommand(SendMethodControlCommand command_type, MessageType packet_type,
+                          const std::vector<uint8_t> &payload)
+      : PendingMessage(SendMethod::CONTROL_COMMAND, static_cast<uint8_t>(command_type), packet_type, payload),
+        command_type(command_type) {};
 };
 
 struct PendingMessageToType : PendingMessage {
   NodeType node_type;
 
-  PendingMessageToType(NodeType node_type, MessageType packet_type, std::vector<uint8_t> payload)
-      : node_type(node_type),
-        PendingMessage(SendMethod::NODE_TYPE, static_cast<uint8_t>(node_type), packet_type, payload) {};
+  PendingMessageToType(NodeType node_type, MessageType packet_type, const uint8_t *data, size_t data_len)
+      : PendingMessage(SendMethod::NODE_TYPE, static_cast<uint8_t>(node_type), packet_type, data, data_len),
+        node_type(node_type) {};
+  PendingMessageToType(NodeType node_type, MessageType packet_type, const std::vector<uint8_t> &payload)
+      : PendingMessage(SendMethod::NODE_TYPE, static_cast<uint8_t>(node_type), packet_type, payload),
+        node_type(node_type) {};
 };
 
 struct PendingMessageToAddress : PendingMessage {
   NodeAddress dest_address;
 
-  PendingMessageToAddress(NodeAddress dest_address, MessageType packet_type, std::vector<uint8_t> payload)
-      : dest_address(dest_address),
-        PendingMessage(SendMethod::NODE_ID, static_cast<uint8_t>(dest_address), packet_type, payload) {};
+  PendingMessageToAddress(NodeAddress dest_address, MessageType packet_type, const uint8_t *data, size_t data_len)
+      : PendingMessage(SendMethod::NODE_ID, static_cast<uint8_t>(dest_address), packet_type, data, data_len),
+        dest_address(dest_address) {};
+  PendingMessageToAddress(NodeAddress dest_address, MessageType packet_type, const std::vector<uint8_t> &payload)
+      : PendingMessage(SendMethod::NODE_ID, static_cast<uint8_t>(dest_address), packet_type, payload),
+        dest_address(dest_address) {};
+};
+
+/**
+ * Low/high water marks of the resources Comfortnet uses, sampled every dataflow cycle
+ */
+struct ResourceWatermarks {
+  uint32_t min_free_heap{UINT32_MAX};
+  uint32_t min_largest_free_block{UINT32_MAX};
+  uint32_t min_stack_headroom{UINT32_MAX};  // Minimum free stack of the task running Comfortnet, in bytes
+  uint8_t peak_pending_messages{0};
+  uint8_t peak_payload_blocks{0};
+};
+
+/**
+ * Network identity saved to flash, so after a reboot we can rejoin under the same MAC, address and session instead of
+ * waiting for a full discovery cycle and leaving a stale entry behind in the coordinator's node list.
+ */
+struct PersistedIdentity {
+  MacAddress mac_address;
+  SessionId session_id;
+  NodeAddress node_id;
+  Subnet subnet;
 };
 
 struct ComfortnetData {
@@ -89,10 +180,10 @@ struct ComfortnetCommandData {
   CommandType cmd_type;
   bool response;
   const uint8_t *payload;
-  uint8_t payload_len;
+  uint16_t payload_len;
 
   ComfortnetCommandData(NodeType node_type, std::optional<MacAddress> node_mac, CommandType cmd_type, bool response,
-                        const uint8_t *payload, uint8_t payload_len)
+                        const uint8_t *payload, uint16_t payload_len)
       : node_type(node_type),
         node_mac(node_mac),
         cmd_type(cmd_type),
@@ -108,10 +199,10 @@ struct ComfortnetPacketData {
   MessageType packet_type_request;
   MessageType packet_type_response;
   const uint8_t *payload;
-  uint8_t payload_len;
+  uint16_t payload_len;
 
   ComfortnetPacketData(NodeType node_type, std::optional<MacAddress> node_mac, MessageType packet_type,
-                       const uint8_t *payload, uint8_t payload_len)
+                       const uint8_t *payload, uint16_t payload_len)
       : node_type(node_type),
         node_mac(node_mac),
         packet_type(packet_type),
@@ -121,6 +212,14 @@ struct ComfortnetPacketData {
         payload_len(payload_len) {};
 };
 
+/**
+ * A catalog field that has at least one listener
+ */
+struct BoundCatalogField {
+  const CatalogField *field;
+  std::vector<std::function<void(const ComfortnetData &)>> *listeners;
+};
+
 struct DBIDDatagram {
   uint8_t dbid_tag;
   uint8_t db_len;
@@ -135,15 +234,39 @@ class Comfortnet : public esphome::Component, public esphome::uart::UARTDevice {
   void setup() override;
   void loop() override;
   void dump_config() override;
+  void on_safe_shutdown() override;
 
   void set_device_type(uint8_t type) { device_type_ = static_cast<NodeType>(type); }
   void set_ct_version(uint8_t version) { ct_version_ = version; }
   void set_flow_control_pin(esphome::GPIOPin *flow_control_pin) { this->flow_control_pin_ = flow_control_pin; }
+  void set_listen_only(bool listen_only) { this->listen_only_ = listen_only; }
+  /**
+   * Bus idle time before we answer a frame addressed to us. Arbitrated frames keep the full slot delay.
+   */
+  void set_reply_delay(uint32_t reply_delay) { this->reply_delay_ = reply_delay; }
+#ifdef USE_COMFORTNET_FRAME_BRIDGE
+  void set_frame_bridge_port(uint16_t port) { this->frame_bridge_.set_port(port); }
+#endif
+  /**
+   * Mixed into the preference keys, so several buses in one firmware each keep their own saved state
+   */
+  void set_preference_salt(uint32_t salt) { this->preference_salt_ = salt; }
 
   void set_update_interval(uint32_t interval_millis) { update_interval_millis_ = interval_millis; }
+  /**
+   * Replaces the hardware clock, e.g. with a VirtualClock to run the protocol logic faster than real time
+   */
+  void set_clock(Clock *clock) { this->clock_ = clock; }
+  inline Clock *get_clock() const { return this->clock_; }
+#ifdef USE_COMFORTNET_PROFILING
+  /**
+   * loop() calls taking at least this long, in microseconds, are logged and counted as slow
+   */
+  void set_slow_loop_threshold(uint32_t threshold) { this->loop_profiler_.set_slow_threshold(threshold); }
+#endif
 
-  inline void register_listener(std::string sensor_key, std::function<void(ComfortnetData)> callback) {
-    std::vector<std::function<void(ComfortnetData)>> *listener_vector = nullptr;
+  inline void register_listener(const std::string &sensor_key, std::function<void(const ComfortnetData &)> callback) {
+    std::vector<std::function<void(const ComfortnetData &)>> *listener_vector = nullptr;
     auto iter = this->listeners_.find(sensor_key);
     if (iter == this->listeners_.end()) {
       listener_vector = &this->listeners_[sensor_key];
@@ -151,9 +274,12 @@ class Comfortnet : public esphome::Component, public esphome::uart::UARTDevice {
       listener_vector = &iter->second;
     }
     listener_vector->push_back(callback);
+    this->catalog_dirty_ = true;
   };
-  inline void register_command_listener(CommandType command_type, std::function<void(ComfortnetCommandData)> callback) {
-    std::vector<std::function<void(ComfortnetCommandData)>> *listener_vector = nullptr;
+#ifdef USE_COMFORTNET_COMMAND_LISTENERS
+  inline void register_command_listener(CommandType command_type,
+                                        std::function<void(const ComfortnetCommandData &)> callback) {
+    std::vector<std::function<void(const ComfortnetCommandData &)>> *listener_vector = nullptr;
     auto iter = this->command_listeners_.find(command_type);
     if (iter == this->command_listeners_.end()) {
       listener_vector = &this->command_listeners_[command_type];
@@ -162,8 +288,11 @@ class Comfortnet : public esphome::Component, public esphome::uart::UARTDevice {
     }
     listener_vector->push_back(callback);
   };
-  inline void register_packet_listener(MessageType message_type, std::function<void(ComfortnetPacketData)> callback) {
-    std::vector<std::function<void(ComfortnetPacketData)>> *listener_vector = nullptr;
+#endif
+#ifdef USE_COMFORTNET_PACKET_LISTENERS
+  inline void register_packet_listener(MessageType message_type,
+                                       std::function<void(const ComfortnetPacketData &)> callback) {
+    std::vector<std::function<void(const ComfortnetPacketData &)>> *listener_vector = nullptr;
     auto iter = this->packet_listeners_.find(message_type);
     if (iter == this->packet_listeners_.end()) {
       listener_vector = &this->packet_listeners_[message_type];
@@ -172,17 +301,29 @@ class Comfortnet : public esphome::Component, public esphome::uart::UARTDevice {
     }
     listener_vector->push_back(callback);
   };
+#endif
 
-  inline void register_device_polling(NodeType node_type, MessageType poll_message, bool poll_once) {
+  inline void register_device_polling(NodeType node_type, MessageType poll_message, bool poll_once,
+                                      uint32_t interval = 0) {
     auto it = std::find(polling_queue_.begin(), polling_queue_.end(),
                         (struct PollQueueEntry) {node_type, poll_message, poll_once});
     if (it == polling_queue_.end()) {
-      polling_queue_.emplace_back(node_type, poll_message, poll_once);
-    } else if (it.base()->poll_once && !poll_once) {
-      // If the existing request says to poll once, but this one says to repeatedly pull, reconfigure the request.
-      it.base()->poll_once = poll_once;
+      polling_queue_.emplace_back(node_type, poll_message, poll_once, interval);
+    } else {
+      if (it->poll_once && !poll_once) {
+        // If the existing request says to poll once, but this one says to repeatedly pull, reconfigure the request.
+        it->poll_once = poll_once;
+      }
+      if (interval != 0 && (it->interval == 0 || interval < it->interval)) {
+        // Keep the data as fresh as the most demanding request wants
+        it->interval = interval;
+      }
     }
   };
+  /**
+   * Polls whatever messages the built-in catalog decodes data_key from, for a node of the given type
+   */
+  void register_catalog_polling(const std::string &data_key, NodeType node_type);
   /**
    * Moves the given device to the end of the poll priority list
    */
@@ -190,15 +331,16 @@ class Comfortnet : public esphome::Component, public esphome::uart::UARTDevice {
     auto it = std::find(polling_queue_.begin(), polling_queue_.end(),
                         (struct PollQueueEntry) {node_type, poll_message, false});
     if (it != polling_queue_.end()) {
-      if (it.base()->poll_once) {
+      if (it->poll_once) {
         polling_queue_.erase(it);
+      } else {
+        std::rotate(it, it + 1, polling_queue_.end());
       }
-      std::rotate(it, it + 1, polling_queue_.end());
     }
   };
 
-  inline void read_mdi(const uint8_t *data, uint8_t data_len, std::vector<DBIDDatagram> *parsed) {
-    uint8_t i = 0;
+  inline void read_mdi(const uint8_t *data, uint16_t data_len, std::vector<DBIDDatagram> *parsed) {
+    uint16_t i = 0;
     while (i < data_len) {
       if (i + 2 >= data_len) {
         return;
@@ -213,89 +355,203 @@ class Comfortnet : public esphome::Component, public esphome::uart::UARTDevice {
     }
   };
 
-  inline void queue_message(PendingMessage message) { pending_messages_.push(message); };
+  /**
+   * Queues a message to be sent the next time the coordinator gives us the token.
+   * Returns false if the message could not be queued, e.g. its payload doesn't fit in one frame.
+   */
+  bool queue_message(PendingMessage &&message);
+  /**
+   * Queues a message of up to MAX_SEGMENTED_PAYLOAD_SIZE bytes, splitting it into segments that are sent one per token
+   * if it doesn't fit in a single frame. The last segment is short or empty, so the receiver knows the message ended.
+   * Either every segment is queued, or none are.
+   */
+  bool queue_segmented_message(SendMethod send_method, uint8_t send_param_1, MessageType packet_type,
+                               const uint8_t *data, uint16_t data_len);
+  /**
+   * Queues a SET_CONTROL_COMMAND for the best node of the given type, prefixing the command type to the data.
+   * Returns false if the message could not be queued.
+   */
+  bool queue_control_command(NodeType node_type, CommandType command_type, const uint8_t *data, uint8_t data_len);
+  /**
+   * Sets a control command for the best node of the given type to value, encoded the way the command expects.
+   * Only the latest value is sent, so this is cheap to call every time the value changes.
+   * Returns false if every command slot holds another command that hasn't been sent yet.
+   */
+  bool set_control_command(NodeType node_type, CommandType command_type, float value);
+
+  /**
+   * Starts a bulk DIRECT_MEMORY_ACCESS_READ of the given node's memory. Each chunk is passed to the callback as it
+   * arrives. Only one read can run at a time.
+   */
+  bool start_memory_read(NodeType node_type, uint16_t start_address, uint32_t length, MemoryReader::Callback callback);
+  inline const MemoryReader &get_memory_reader() const { return this->memory_reader_; }
+  inline uint8_t get_pending_message_count() const { return this->pending_messages_.size(); }
+
+  /**
+   * Our address on the network, 0 while we aren't a member
+   */
+  inline NodeAddress get_node_id() const { return this->node_id_; }
+  inline const MacAddress &get_mac_address() const { return this->mac_address_; }
+  /**
+   * Longest time from the last byte received to starting a reply, in millis
+   */
+  inline uint32_t get_max_reply_turnaround() const { return this->max_reply_turnaround_; }
+
+  /**
+   * Every node we know about on the network, along with its metadata and statistics
+   */
+  inline const NodeRegistry &get_node_registry() const { return this->node_registry_; }
+#ifdef USE_COMFORTNET_FRAME_BRIDGE
+  inline const FrameBridge &get_frame_bridge() const { return this->frame_bridge_; }
+#endif
 
  protected:
   uint32_t update_interval_millis_{30000};
   void read_buffer_(int bytes_available, uint32_t now);
-  void handle_message_(bool is_tx, uint32_t now);
-  uint16_t calculate_crc_(const uint8_t *data, uint8_t data_len);
-  uint32_t generate_slot_delay_();
-  void set_node_list_(const uint8_t *data, uint8_t data_len);
-  inline NodeType get_node_type_(NodeAddress address) {
-    uint8_t addr = static_cast<uint8_t>(address);
-    if (addr >= MAX_PAYLOAD_SIZE) {
-      return NodeType::ANY;
-    }
-    return this->node_list_[addr];
+  void handle_message_(const Frame &frame, bool is_tx, uint32_t now);
+  /**
+   * Passes data from any node's traffic on to the command and packet listeners
+   */
+  void eavesdrop_(const FrameView &frame, uint32_t now);
+  /**
+   * Passes a whole message on to the listeners. Only the header of frame is used, as the payload of a message that
+   * spanned several frames is reassembled elsewhere.
+   */
+  void dispatch_message_(const FrameView &frame, const uint8_t *payload, uint16_t payload_len, uint32_t now);
+  /**
+   * Whether a response to another node's poll was seen recently enough that we don't need to poll it ourselves
+   */
+  inline bool is_poll_fresh_(const PollQueueEntry &entry, uint32_t now) const {
+    uint32_t interval = entry.interval == 0 ? this->update_interval_millis_ : entry.interval;
+    return entry.seen_passively && now - entry.last_passive_time < interval;
   }
+  bool has_due_poll_(uint32_t now) const;
+  /**
+   * Rotates polls with fresh data to the back of the list, returning the first one that is due, if any
+   */
+  PollQueueEntry *next_due_poll_(uint32_t now);
+  uint32_t generate_slot_delay_();
+  inline NodeType get_node_type_(NodeAddress address) { return this->node_registry_.get_node_type(address); }
   inline std::optional<MacAddress> get_node_mac_(NodeAddress address) {
-    uint8_t addr = static_cast<uint8_t>(address);
-    if (addr >= MAX_PAYLOAD_SIZE) {
-      return std::nullopt;
-    }
-    return this->node_mac_list_[addr];
+    return this->node_registry_.get_node_mac(address);
   }
   void disconnect_();
-
-  inline void call_listener_(std::string sensor_key, ComfortnetData data) {
+  /**
+   * Keeps the bulk memory reader's requests queued up ahead of the bus
+   */
+  void pump_memory_reader_();
+  /**
+   * Drops the memory reader's requests that haven't been answered yet, once it asks again or stops reading
+   */
+  void drop_memory_requests_();
+  /**
+   * Drops a background message at the head of the queue once it has waited too long for its response, so it doesn't
+   * hold up everything queued behind it
+   */
+  void expire_stalled_message_(uint32_t now);
+  /**
+   * Dirty command slot that has waited the longest, if any
+   */
+  CommandSlot *next_command_slot_();
+  /**
+   * The coordinator didn't ACK the command in the slot, so give up on it once it has had enough attempts
+   */
+  void command_not_acknowledged_(CommandSlot *slot);
+  /**
+   * Summarizes what we have waiting to send, for the token bid policy
+   */
+  BidBacklog bid_backlog_(uint32_t now);
+  /**
+   * Publishes every catalog field found in a response to its data_key listeners
+   */
+  void decode_catalog_(NodeType node_type, MessageType message_type, const uint8_t *payload, uint16_t payload_len);
+  void match_catalog_(NodeType node_type, MessageType message_type, uint8_t tag, const uint8_t *data,
+                      uint16_t data_len);
+  void publish_catalog_field_(const BoundCatalogField &bound, NodeType node_type, const uint8_t *data);
+  void save_identity_();
+  void sample_watermarks_();
+  void publish_watermarks_();
+#ifdef USE_COMFORTNET_PROFILING
+  void publish_profile_();
+#endif
+
+  inline void call_listener_(const std::string &sensor_key, const ComfortnetData &data) {
     auto iter = this->listeners_.find(sensor_key);
     if (iter != this->listeners_.end()) {
-      std::vector<std::function<void(ComfortnetData)>> listener_vector = iter->second;
-      for (auto &callback : listener_vector) {
+      COMFORTNET_PROFILE_PHASE(LISTENERS);
+      for (auto &callback : iter->second) {
         callback(data);
       }
     }
   }
-  inline void call_command_listener_(ComfortnetCommandData data) {
+#ifdef USE_COMFORTNET_COMMAND_LISTENERS
+  inline void call_command_listener_(const ComfortnetCommandData &data) {
     auto iter = this->command_listeners_.find(data.cmd_type);
     if (iter != this->command_listeners_.end()) {
-      std::vector<std::function<void(ComfortnetCommandData)>> listener_vector = iter->second;
-      for (auto &callback : listener_vector) {
+      COMFORTNET_PROFILE_PHASE(LISTENERS);
+      for (auto &callback : iter->second) {
         callback(data);
       }
     }
   }
-  inline void call_packet_listener_(ComfortnetPacketData data) {
+#endif
+#ifdef USE_COMFORTNET_PACKET_LISTENERS
+  inline void call_packet_listener_(const ComfortnetPacketData &data) {
     auto iter = this->packet_listeners_.find(data.packet_type);
     if (iter != this->packet_listeners_.end()) {
-      std::vector<std::function<void(ComfortnetPacketData)>> listener_vector = iter->second;
-      for (auto &callback : listener_vector) {
+      COMFORTNET_PROFILE_PHASE(LISTENERS);
+      for (auto &callback : iter->second) {
         callback(data);
       }
     }
   }
+#endif
 
-  inline void transmit_message_(NodeAddress dst_adr, NodeAddress src_adr, Subnet subnet, SendMethod send_method,
-                                uint8_t send_param_1, uint8_t send_param_2, NodeType src_node_type,
-                                MessageType msg_type, uint8_t packet_num, const std::vector<uint8_t> &data,
-                                bool require_arbitration = false) {
-    write_message_to_buffer_(tx_message_, dst_adr, src_adr, subnet, send_method, send_param_1, send_param_2,
-                             src_node_type, msg_type, packet_num, data.data(), data.size(), true, require_arbitration);
-  }
-  inline void transmit_message_(NodeAddress dst_adr, NodeAddress src_adr, Subnet subnet, SendMethod send_method,
-                                uint8_t send_param_1, uint8_t send_param_2, NodeType src_node_type,
-                                MessageType msg_type, uint8_t packet_num, const uint8_t *data, uint8_t data_len,
-                                bool require_arbitration = false) {
-    write_message_to_buffer_(tx_message_, dst_adr, src_adr, subnet, send_method, send_param_1, send_param_2,
-                             src_node_type, msg_type, packet_num, data, data_len, true, require_arbitration);
+  inline uint8_t packet_number_(bool is_dataflow) const {
+    return PACKET_NUMBER(is_dataflow, this->subnet_ == Subnet::VERSION_1);
   }
-  void write_message_to_buffer_(std::vector<uint8_t> &buffer, NodeAddress dst_adr, NodeAddress src_adr, Subnet subnet,
-                                SendMethod send_method, uint8_t send_param_1, uint8_t send_param_2,
-                                NodeType src_node_type, MessageType msg_type, uint8_t packet_num, const uint8_t *data,
-                                uint8_t data_len, bool queue_send, bool require_arbitration);
+  /**
+   * Claims an outbound slot for a frame from us, evicting the oldest queued frame if every slot is in use
+   */
+  OutboundFrame *claim_outbound_(QueuedMessageType timing);
+  /**
+   * Claims an outbound slot and starts serializing a frame from us into it. The frame must be finished before
+   * returning to the loop.
+   */
+  FrameBuilder queue_frame_(QueuedMessageType timing, NodeAddress dst_adr, Subnet subnet, SendMethod send_method,
+                            uint8_t send_param_1, MessageType msg_type, uint8_t packet_num);
+  /**
+   * Oldest queued frame with the given timing, or any frame ready to send when timing is NONE
+   */
+  OutboundFrame *find_outbound_(QueuedMessageType timing);
+  void clear_outbound_();
+  /**
+   * Hands a frame to the UART and returns right away. finish_transmit_() completes it once it is on the wire.
+   */
+  void start_transmit_(OutboundFrame *outbound, uint32_t now);
+  void finish_transmit_(uint32_t now);
+  /**
+   * Time it takes to shift out a frame at the UART's settings, in microseconds
+   */
+  uint32_t frame_airtime_(uint8_t frame_size) const;
   esphome::GPIOPin *flow_control_pin_{nullptr};
-
-  std::vector<uint8_t> rx_message_;
-  std::vector<uint8_t> tx_message_;
-  std::vector<uint8_t> r2r_reply_;
-
-  uint32_t last_read_time_{0};                                 // Last time any data was read
-  uint32_t last_address_confirm_time_{0};                      // Last time our address was confirmed
-  uint32_t slot_delay_{0};                                     // Calculated slot delay when we are arbitrating
-  QueuedMessageType message_queued_{QueuedMessageType::NONE};  // Whether we should arbitrate, or are sending normally
-  bool awaiting_discovery_;                                    // Whether we are in the discovery process
-  bool has_won_token_broadcast_;                               // Devices can only win token offer once per dataflow
+  Clock *clock_{Clock::hardware()};
+
+  Frame rx_message_;
+  OutboundFrame outbound_frames_[OUTBOUND_FRAME_QUEUE_SIZE];
+  OutboundFrame *transmitting_{nullptr};  // Frame currently being sent and handled, never evicted
+  uint32_t transmit_done_time_{0};       // When the last bit of the transmitting frame is out, in micros
+  esphome::HighFrequencyLoopRequester high_freq_;
+  uint32_t outbound_sequence_{0};
+  uint32_t outbound_overwrite_count_{0};  // Frames lost because every outbound slot was in use
+  uint32_t reply_delay_{DEFAULT_REPLY_DELAY};
+  uint32_t max_reply_turnaround_{0};  // Longest time from the last byte received to sending a reply
+
+  uint32_t last_read_time_{0};             // Last time any data was read
+  uint32_t last_address_confirm_time_{0};  // Last time our address was confirmed
+  bool awaiting_discovery_{false};         // Whether we are in the discovery process
+  bool listen_only_{false};        // Never join the network or transmit, only eavesdrop
+  bool resuming_identity_{false};  // Whether we are using a persisted address that the coordinator hasn't confirmed yet
 
   MacAddress mac_address_;
   uint8_t ct_version_{2};  // Numerical value representing the desired CT version (either 1 or 2)
@@ -303,18 +559,47 @@ class Comfortnet : public esphome::Component, public esphome::uart::UARTDevice {
   NodeAddress node_id_{static_cast<NodeAddress>(0)};
   Subnet subnet_{Subnet::BROADCAST};
   SessionId session_id_;
-
-  std::queue<PendingMessage> pending_messages_;
+  uint32_t preference_salt_{0};
+  esphome::ESPPreferenceObject identity_pref_;
+  PersistedIdentity saved_identity_{};
+
+  StaticQueue<PendingMessage, PENDING_MESSAGE_QUEUE_SIZE> pending_messages_;
+  uint32_t queue_full_count_{0};       // Number of messages dropped because the pending message queue was full
+  uint32_t stalled_message_count_{0};  // Background messages dropped because no response to them arrived
+  CommandSlot command_slots_[COMMAND_SLOT_COUNT];
+  CommandSlot *command_in_flight_{nullptr};  // Slot sent on the last token, until the coordinator ACKs it
+  uint32_t command_coalesced_count_{0};      // Values replaced by a newer one before they were sent
+  uint32_t command_no_slot_count_{0};        // Commands dropped because every slot held an unsent command
+  uint32_t command_abandoned_count_{0};      // Commands given up on after too many unacknowledged attempts
+
+  ResourceWatermarks watermarks_;
+  uint32_t last_watermark_publish_time_{0};
+#ifdef USE_COMFORTNET_PROFILING
+  LoopProfiler loop_profiler_;
+#endif
   std::vector<PollQueueEntry> polling_queue_;
-
-  uint8_t node_list_size_ = 0;
-  NodeType node_list_[MAX_PAYLOAD_SIZE];
-  MacAddress node_mac_list_[MAX_PAYLOAD_SIZE];
-  std::map<NodeType, std::vector<uint8_t>> network_shared_data_;
-
-  std::map<std::string, std::vector<std::function<void(ComfortnetData)>>> listeners_;
-  std::map<CommandType, std::vector<std::function<void(ComfortnetCommandData)>>> command_listeners_;
-  std::map<MessageType, std::vector<std::function<void(ComfortnetPacketData)>>> packet_listeners_;
+  uint32_t poll_suppressed_count_{0};  // Polls skipped because another node's poll already fetched the data
+
+  NodeRegistry node_registry_;
+  TokenBidPolicy token_bid_policy_;
+  SegmentAssembler segment_assembler_;
+  MemoryReader memory_reader_;
+#ifdef USE_COMFORTNET_FRAME_BRIDGE
+  FrameBridge frame_bridge_;
+#endif
+#ifdef USE_COMFORTNET_SHARED_DATA
+  SharedDataStore network_shared_data_;
+#endif
+
+  std::map<std::string, std::vector<std::function<void(const ComfortnetData &)>>> listeners_;
+  std::vector<BoundCatalogField> bound_catalog_fields_;
+  bool catalog_dirty_{true};  // Listeners changed since bound_catalog_fields_ was built
+#ifdef USE_COMFORTNET_COMMAND_LISTENERS
+  std::map<CommandType, std::vector<std::function<void(const ComfortnetCommandData &)>>> command_listeners_;
+#endif
+#ifdef USE_COMFORTNET_PACKET_LISTENERS
+  std::map<MessageType, std::vector<std::function<void(const ComfortnetPacketData &)>>> packet_listeners_;
+#endif
 };
 
 class ComfortnetClient {
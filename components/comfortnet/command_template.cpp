@@ -0,0 +1,106 @@
+#include <cmath>
+#include <algorithm>
+#include "command_template.h"
+
+namespace comfortnet {
+
+static const float PERCENT_HALF_MAX = 100.0f;
+
+uint8_t encode_command_value(CommandEncoding encoding, float value, uint8_t *data) {
+  switch (encoding) {
+    case CommandEncoding::PERCENT_HALF:
+      data[0] = static_cast<uint8_t>(std::lround(std::clamp(value, 0.0f, PERCENT_HALF_MAX) * 2.0f));
+      return 1;
+    case CommandEncoding::UINT16: {
+      uint16_t raw = static_cast<uint16_t>(std::lround(std::clamp(value, 0.0f, 65535.0f)));
+      data[0] = raw & 0xFF;
+      data[1] = (raw >> 8) & 0xFF;
+      return 2;
+    }
+    case CommandEncoding::UINT8:
+    default:
+      data[0] = static_cast<uint8_t>(std::lround(std::clamp(value, 0.0f, 255.0f)));
+      return 1;
+  }
+}
+
+std::optional<float> decode_command_value(const CommandLayout &layout, const uint8_t *data, uint16_t data_len) {
+  const uint8_t *value = data + layout.value_offset;
+  switch (layout.encoding) {
+    case CommandEncoding::PERCENT_HALF:
+      if (data_len < layout.value_offset + 1) {
+        return std::nullopt;
+      }
+      return value[0] / 2.0f;
+    case CommandEncoding::UINT16:
+      if (data_len < layout.value_offset + 2) {
+        return std::nullopt;
+      }
+      return static_cast<float>((value[1] << 8) | value[0]);
+    case CommandEncoding::UINT8:
+    default:
+      if (data_len < layout.value_offset + 1) {
+        return std::nullopt;
+      }
+      return static_cast<float>(value[0]);
+  }
+}
+
+void CommandTemplate::build(NodeType node_type, CommandType command, NodeType src_node_type) {
+  this->layout_ = command_layout(command);
+  // Addresses are filled in by set_route() before sending
+  FrameBuilder builder(this->frame_);
+  builder
+      .header(NodeAddress::COORDINATOR, static_cast<NodeAddress>(0), Subnet::BROADCAST, SendMethod::NODE_TYPE,
+              static_cast<uint8_t>(node_type), 0, src_node_type, MessageType::SET_CONTROL_COMMAND, 0)
+      .append(static_cast<uint8_t>(static_cast<uint16_t>(command) & 0xFF))
+      .append(static_cast<uint8_t>((static_cast<uint16_t>(command) >> 8) & 0xFF));
+  for (uint8_t i = 0; i < this->layout_.data_len; i++) {
+    builder.append(static_cast<uint8_t>(0));
+  }
+  builder.finish();
+  this->sums_ = FletcherSums();
+  this->sums_.add(this->frame_.data, this->frame_.size - PACKET_CRC_SIZE);
+}
+
+bool CommandTemplate::set_value(float value) {
+  uint8_t encoded[2];
+  uint8_t encoded_len = encode_command_value(this->layout_.encoding, value, encoded);
+  uint8_t index = PACKET_HEADER_SIZE + CONTROL_COMMAND_HEADER_SIZE + this->layout_.value_offset;
+  bool changed = false;
+  for (uint8_t i = 0; i < encoded_len; i++) {
+    changed |= this->patch_(index + i, encoded[i]);
+  }
+  if (changed) {
+    this->store_checksum_();
+  }
+  return changed;
+}
+
+void CommandTemplate::set_route(NodeAddress dst_adr, NodeAddress src_adr, Subnet subnet, uint8_t packet_num) {
+  bool changed = this->patch_(DESTINATION_ADDRESS_POS, static_cast<uint8_t>(dst_adr));
+  changed |= this->patch_(SOURCE_ADDRESS_POS, static_cast<uint8_t>(src_adr));
+  changed |= this->patch_(SUBNET_POS, static_cast<uint8_t>(subnet));
+  changed |= this->patch_(PACKET_NUMBER_POS, packet_num);
+  if (changed) {
+    this->store_checksum_();
+  }
+}
+
+bool CommandTemplate::patch_(uint8_t index, uint8_t byte) {
+  uint8_t old_byte = this->frame_.data[index];
+  if (old_byte == byte) {
+    return false;
+  }
+  this->sums_.patch(index, this->frame_.size - PACKET_CRC_SIZE, old_byte, byte);
+  this->frame_.data[index] = byte;
+  return true;
+}
+
+void CommandTemplate::store_checksum_() {
+  uint16_t crc = this->sums_.checksum();
+  this->frame_.data[this->frame_.size - 2] = (crc >> 8) & 0xFF;
+  this->frame_.data[this->frame_.size - 1] = crc & 0xFF;
+}
+
+}  // namespace comfortnet
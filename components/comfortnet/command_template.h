@@ -0,0 +1,101 @@
+#pragma once
+
+#include <optional>
+#include "types.h"
+#include "frame.h"
+
+namespace comfortnet {
+
+// Control command data starts with the command type, little endian
+#define CONTROL_COMMAND_HEADER_SIZE 2
+
+enum class CommandEncoding : uint8_t {
+  UINT8,         // Plain byte, such as a whole degree set point, a mode or an on/off setting
+  PERCENT_HALF,  // Demands, in half percent steps
+  UINT16,        // Little endian, such as a motor speed or airflow
+};
+
+/**
+ * Where the value of a control command sits in the data following the command type, and how it is encoded
+ */
+struct CommandLayout {
+  CommandType command;
+  uint8_t data_len;
+  uint8_t value_offset;
+  CommandEncoding encoding;
+};
+
+// clang-format off
+static constexpr CommandLayout COMMAND_LAYOUTS[] = {
+    // Demands lead with a byte we always send as 0, then the demand. Fan demand has one more byte before the demand.
+    {CommandType::DEHUMIDIFICATION_DEMAND, 2, 1, CommandEncoding::PERCENT_HALF},
+    {CommandType::HUMIDIFICATION_DEMAND, 2, 1, CommandEncoding::PERCENT_HALF},
+    {CommandType::HEAT_DEMAND, 2, 1, CommandEncoding::PERCENT_HALF},
+    {CommandType::COOL_DEMAND, 2, 1, CommandEncoding::PERCENT_HALF},
+    {CommandType::FAN_DEMAND, 3, 2, CommandEncoding::PERCENT_HALF},
+    {CommandType::BACK_UP_HEAT_DEMAND, 2, 1, CommandEncoding::PERCENT_HALF},
+    {CommandType::DEFROST_HEAT_DEMAND, 2, 1, CommandEncoding::PERCENT_HALF},
+    {CommandType::AUX_HEAT_DEMAND, 2, 1, CommandEncoding::PERCENT_HALF},
+    {CommandType::SET_MOTOR_SPEED, 2, 0, CommandEncoding::UINT16},
+    {CommandType::SET_MOTOR_TORQUE, 2, 0, CommandEncoding::UINT16},
+    {CommandType::SET_AIRFLOW_DEMAND, 2, 0, CommandEncoding::UINT16},
+};
+// clang-format on
+
+/**
+ * Layout of the given command. Commands without an entry take a single byte, like set points and settings.
+ */
+constexpr CommandLayout command_layout(CommandType command) {
+  for (const CommandLayout &layout : COMMAND_LAYOUTS) {
+    if (layout.command == command) {
+      return layout;
+    }
+  }
+  return {command, 1, 0, CommandEncoding::UINT8};
+}
+
+/**
+ * Writes value in the given encoding, clamped to what the encoding can hold. Returns the number of bytes written.
+ */
+uint8_t encode_command_value(CommandEncoding encoding, float value, uint8_t *data);
+/**
+ * Reads the value of a command from its data, following the command type.
+ * Returns nullopt if the data is too short for the layout.
+ */
+std::optional<float> decode_command_value(const CommandLayout &layout, const uint8_t *data, uint16_t data_len);
+
+/**
+ * A complete SET_CONTROL_COMMAND frame, serialized once.
+ *
+ * Changing the value or the route only rewrites the bytes that differ, and patches the checksum to match instead of
+ * summing the frame again.
+ */
+class CommandTemplate {
+ public:
+  void build(NodeType node_type, CommandType command, NodeType src_node_type);
+  inline void clear() { this->frame_.clear(); }
+  inline bool is_built() const { return !this->frame_.empty(); }
+
+  /**
+   * Returns whether any byte changed
+   */
+  bool set_value(float value);
+  /**
+   * Addresses the frame for sending, the source and subnet can change whenever we rejoin the network
+   */
+  void set_route(NodeAddress dst_adr, NodeAddress src_adr, Subnet subnet, uint8_t packet_num);
+
+  inline NodeType get_node_type() const { return static_cast<NodeType>(FrameView(this->frame_).send_param_1()); }
+  inline CommandType get_command() const { return this->layout_.command; }
+  inline const Frame &get_frame() const { return this->frame_; }
+
+ protected:
+  bool patch_(uint8_t index, uint8_t byte);
+  void store_checksum_();
+
+  Frame frame_;
+  FletcherSums sums_;
+  CommandLayout layout_{command_layout(static_cast<CommandType>(0))};
+};
+
+}  // namespace comfortnet
@@ -0,0 +1,74 @@
+#include "datapoint_catalog.h"
+
+namespace comfortnet {
+
+static const uint16_t SENSOR_VALID_BIT = 1 << 15;
+static const uint16_t SENSOR_NEGATIVE_BIT = 1 << 14;
+
+// clang-format off
+const CatalogField CATALOG_FIELDS[] = {
+    // Identification, common to every node
+    {NodeType::ANY, MessageType::GET_IDENTIFICATION_RESPONSE, CATALOG_RAW_PAYLOAD, 2, 0, FieldFormat::HEX16, 0, "MANUFACTURER_ID"},
+
+    // Status faults, common to every node
+    {NodeType::ANY, MessageType::GET_STATUS_RESPONSE, 0, 3, 0, FieldFormat::HEX8, 0, "CRITICAL_FAULT"},
+    {NodeType::ANY, MessageType::GET_STATUS_RESPONSE, 0, 3, 1, FieldFormat::HEX8, 0, "MINOR_FAULT"},
+
+    // Thermostat configuration
+    {NodeType::THERMOSTAT, MessageType::GET_CONFIGURATION_RESPONSE, 0, 33, 2, FieldFormat::UINT8, 0, "BALANCE_POINT"},
+    {NodeType::THERMOSTAT, MessageType::GET_CONFIGURATION_RESPONSE, 0, 33, 10, FieldFormat::FLAG, 7, "COMFORT_RECOVERY"},
+    {NodeType::THERMOSTAT, MessageType::GET_CONFIGURATION_RESPONSE, 0, 33, 10, FieldFormat::FLAG, 6, "KEYPAD_LOCKOUT"},
+    {NodeType::THERMOSTAT, MessageType::GET_CONFIGURATION_RESPONSE, 0, 33, 10, FieldFormat::FLAG, 4, "FAST_SECOND_STAGE"},
+    {NodeType::THERMOSTAT, MessageType::GET_CONFIGURATION_RESPONSE, 0, 33, 10, FieldFormat::FLAG, 3, "CONTINUOUS_DISPLAY_LIGHT"},
+    {NodeType::THERMOSTAT, MessageType::GET_CONFIGURATION_RESPONSE, 0, 33, 10, FieldFormat::FLAG, 2, "COMPRESSOR_LOCKOUT"},
+    {NodeType::THERMOSTAT, MessageType::GET_CONFIGURATION_RESPONSE, 0, 33, 13, FieldFormat::UINT8, 0, "AIR_HANDLER_LOCKOUT_POINT"},
+
+    // Gas furnace status
+    {NodeType::GAS_FURNACE, MessageType::GET_STATUS_RESPONSE, 0, 22, 2, FieldFormat::PERCENT_HALF, 0, "HEAT_DEMAND"},
+    {NodeType::GAS_FURNACE, MessageType::GET_STATUS_RESPONSE, 0, 22, 3, FieldFormat::PERCENT_HALF, 0, "COOL_DEMAND"},
+    {NodeType::GAS_FURNACE, MessageType::GET_STATUS_RESPONSE, 0, 22, 5, FieldFormat::PERCENT_HALF, 0, "FAN_DEMAND"},
+    {NodeType::GAS_FURNACE, MessageType::GET_STATUS_RESPONSE, 0, 22, 8, FieldFormat::PERCENT_HALF, 0, "DEFROST_DEMAND"},
+    {NodeType::GAS_FURNACE, MessageType::GET_STATUS_RESPONSE, 0, 22, 9, FieldFormat::PERCENT_HALF, 0, "EMERGENCY_HEAT_DEMAND"},
+    {NodeType::GAS_FURNACE, MessageType::GET_STATUS_RESPONSE, 0, 22, 10, FieldFormat::PERCENT_HALF, 0, "AUX_HEAT_DEMAND"},
+    {NodeType::GAS_FURNACE, MessageType::GET_STATUS_RESPONSE, 0, 22, 11, FieldFormat::PERCENT_HALF, 0, "HUMIDIFICATION_DEMAND"},
+    {NodeType::GAS_FURNACE, MessageType::GET_STATUS_RESPONSE, 0, 22, 12, FieldFormat::PERCENT_HALF, 0, "DEHUMIDIFICATION_DEMAND"},
+    {NodeType::GAS_FURNACE, MessageType::GET_STATUS_RESPONSE, 0, 22, 13, FieldFormat::UINT16, 0, "AIRFLOW"},
+    {NodeType::GAS_FURNACE, MessageType::GET_STATUS_RESPONSE, 0, 22, 15, FieldFormat::PERCENT_HALF, 0, "HEAT_ACTUAL"},
+    {NodeType::GAS_FURNACE, MessageType::GET_STATUS_RESPONSE, 0, 22, 16, FieldFormat::PERCENT_HALF, 0, "COOL_ACTUAL"},
+    {NodeType::GAS_FURNACE, MessageType::GET_STATUS_RESPONSE, 0, 22, 17, FieldFormat::PERCENT_HALF, 0, "FAN_ACTUAL"},
+    {NodeType::GAS_FURNACE, MessageType::GET_STATUS_RESPONSE, 0, 22, 20, FieldFormat::PERCENT_HALF, 0, "HUMIDIFICATION_ACTUAL"},
+    {NodeType::GAS_FURNACE, MessageType::GET_STATUS_RESPONSE, 0, 22, 21, FieldFormat::PERCENT_HALF, 0, "DEHUMIDIFICATION_ACTUAL"},
+
+    // Gas furnace sensors
+    {NodeType::GAS_FURNACE, MessageType::GET_SENSOR_DATA_RESPONSE, 0, 2, 0, FieldFormat::SENSOR, 0, "RETURN_AIR_TEMPERATURE"},
+    {NodeType::GAS_FURNACE, MessageType::GET_SENSOR_DATA_RESPONSE, 1, 2, 0, FieldFormat::SENSOR, 0, "SUPPLY_AIR_TEMPERATURE"},
+
+    // Heat pump status
+    {NodeType::HEAT_PUMP, MessageType::GET_STATUS_RESPONSE, 0, 12, 2, FieldFormat::PERCENT_HALF, 0, "HEAT_DEMAND"},
+    {NodeType::HEAT_PUMP, MessageType::GET_STATUS_RESPONSE, 0, 12, 3, FieldFormat::PERCENT_HALF, 0, "COOL_DEMAND"},
+    {NodeType::HEAT_PUMP, MessageType::GET_STATUS_RESPONSE, 0, 12, 4, FieldFormat::PERCENT_HALF, 0, "DEHUMIDIFICATION_DEMAND"},
+    {NodeType::HEAT_PUMP, MessageType::GET_STATUS_RESPONSE, 0, 12, 5, FieldFormat::PERCENT_HALF, 0, "HEAT_ACTUAL"},
+    {NodeType::HEAT_PUMP, MessageType::GET_STATUS_RESPONSE, 0, 12, 6, FieldFormat::PERCENT_HALF, 0, "COOL_ACTUAL"},
+    {NodeType::HEAT_PUMP, MessageType::GET_STATUS_RESPONSE, 0, 12, 7, FieldFormat::PERCENT_HALF, 0, "DEFROST_DEMAND"},
+    {NodeType::HEAT_PUMP, MessageType::GET_STATUS_RESPONSE, 0, 12, 8, FieldFormat::PERCENT_HALF, 0, "FAN_DEMAND"},
+    {NodeType::HEAT_PUMP, MessageType::GET_STATUS_RESPONSE, 0, 12, 11, FieldFormat::PERCENT_HALF, 0, "DEHUMIDIFICATION_ACTUAL"},
+
+    // Heat pump sensors
+    {NodeType::HEAT_PUMP, MessageType::GET_SENSOR_DATA_RESPONSE, 0, 2, 0, FieldFormat::SENSOR, 0, "OUTDOOR_AIR_TEMPERATURE"},
+};
+// clang-format on
+
+const size_t CATALOG_FIELD_COUNT = sizeof(CATALOG_FIELDS) / sizeof(CATALOG_FIELDS[0]);
+
+std::optional<float> decode_sensor_value(const uint8_t *data) {
+  uint16_t combined = static_cast<uint16_t>((data[1] << 8) | data[0]);
+  if ((combined & SENSOR_VALID_BIT) == 0) {
+    return std::nullopt;
+  }
+  float whole = static_cast<float>((combined >> 4) & 0x3FF);
+  float fraction = static_cast<float>(combined & 0x0F) / 16.0f;
+  // Matches how the values were always decoded: the sign only applies to the whole part
+  return ((combined & SENSOR_NEGATIVE_BIT) != 0 ? -whole : whole) + fraction;
+}
+
+}  // namespace comfortnet
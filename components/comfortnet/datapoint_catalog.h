@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <optional>
+#include "types.h"
+
+namespace comfortnet {
+
+enum class FieldFormat : uint8_t {
+  PERCENT_HALF,  // Demands and actuals, in half percent steps
+  UINT8,         // Plain byte, 0xFF when the value isn't available
+  UINT16,        // Little endian
+  SENSOR,        // CT-485 sensor fixed point, little endian
+  FLAG,          // Single bit of a byte
+  HEX8,          // Codes such as faults, published as text
+  HEX16,         // Little endian, published as text
+};
+
+// dbid_tag of fields read straight from the payload, for messages that aren't MDI formatted
+#define CATALOG_RAW_PAYLOAD 0xFF
+
+/**
+ * Where to find a standard field, how to decode it and the data_key to publish it under
+ */
+struct CatalogField {
+  NodeType node_type;  // ANY when every node type uses the same layout
+  MessageType message_type;
+  uint8_t dbid_tag;
+  uint8_t min_len;  // Datagram length the layout needs, shorter datagrams are some other layout
+  uint8_t offset;
+  FieldFormat format;
+  uint8_t bit;  // Only for FLAG
+  const char *data_key;
+};
+
+extern const CatalogField CATALOG_FIELDS[];
+extern const size_t CATALOG_FIELD_COUNT;
+
+/**
+ * Decodes the sensor fixed point format: valid bit, sign bit, then a 10 bit whole part and a 4 bit fraction.
+ * Returns nullopt if the sensor reports its value as invalid.
+ */
+std::optional<float> decode_sensor_value(const uint8_t *data);
+
+}  // namespace comfortnet
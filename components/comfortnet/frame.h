@@ -0,0 +1,185 @@
+#pragma once
+
+#include <cinttypes>
+#include "types.h"
+
+namespace comfortnet {
+
+// Packet information
+static const uint8_t PACKET_HEADER_SIZE = 10;
+static const uint8_t PACKET_CRC_SIZE = 2;
+static const uint8_t MAX_FRAME_SIZE = PACKET_HEADER_SIZE + MAX_PAYLOAD_SIZE + PACKET_CRC_SIZE;
+
+// Header indices (Relative to packet)
+static const uint8_t DESTINATION_ADDRESS_POS = 0;
+static const uint8_t SOURCE_ADDRESS_POS = 1;
+static const uint8_t SUBNET_POS = 2;
+static const uint8_t SEND_METHOD_POS = 3;
+static const uint8_t SEND_PARAMETER_1_POS = 4; /* Extra data for send method */
+static const uint8_t SEND_PARAMETER_2_POS = 5; /* Generally 0 on sending, as coordinator will fill it with the ID of the
+                                    target device when routing packets */
+static const uint8_t SOURCE_NODE_TYPE_POS = 6;
+static const uint8_t MESSAGE_TYPE_POS = 7;
+static const uint8_t PACKET_NUMBER_POS =
+    8; /* Defined in ClimateTalk Alliance CT2.0 CT-485 API Reference Revision 01 4.3 - Packet Number*/
+static const uint8_t PAYLOAD_LENGTH_POS = 9; /* 0-MAX_PAYLOAD_SIZE */
+
+/**
+ * Running sums of the Fletcher checksum used by CT-485 frames
+ */
+struct FletcherSums {
+  uint8_t sum1{0xAA};  // Fletcher seed
+  uint8_t sum2{0};
+
+  inline void add(const uint8_t *data, uint8_t data_len) {
+    for (short i = 0; i < data_len; i++) {
+      this->sum1 = (this->sum1 + data[i]) % 0xFF;
+      this->sum2 = (this->sum2 + this->sum1) % 0xFF;
+    }
+  }
+  /**
+   * Updates the sums for the byte at index of a data_len byte message changing from old_byte to new_byte, without
+   * summing the message again. The change carries into sum1 once, and into sum2 once for every byte from index on.
+   */
+  inline void patch(uint8_t index, uint8_t data_len, uint8_t old_byte, uint8_t new_byte) {
+    uint8_t delta = (0xFF + new_byte % 0xFF - old_byte % 0xFF) % 0xFF;
+    this->sum1 = (this->sum1 + delta) % 0xFF;
+    this->sum2 = (this->sum2 + static_cast<uint16_t>(delta) * (data_len - index)) % 0xFF;
+  }
+  inline uint16_t checksum() const {
+    uint8_t tmp = 0xFF - ((this->sum1 + this->sum2) % 0xFF);
+    return (static_cast<uint16_t>(tmp) << 8) | static_cast<uint16_t>(0xFF - ((this->sum1 + tmp) % 0xFF));
+  }
+};
+
+/**
+ * Fletcher checksum used by CT-485 frames
+ */
+inline uint16_t calculate_checksum(const uint8_t *data, uint8_t data_len) {
+  FletcherSums sums;
+  sums.add(data, data_len);
+  return sums.checksum();
+}
+
+/**
+ * Fixed-size buffer holding a single raw frame
+ */
+struct Frame {
+  uint8_t data[MAX_FRAME_SIZE];
+  uint8_t size{0};
+
+  inline void clear() { this->size = 0; }
+  inline bool empty() const { return this->size == 0; }
+  inline bool push_back(uint8_t byte) {
+    if (this->size >= MAX_FRAME_SIZE) {
+      return false;
+    }
+    this->data[this->size++] = byte;
+    return true;
+  }
+  /**
+   * Whether the header, the full payload and the checksum have all been received
+   */
+  inline bool is_complete() const {
+    return this->size > PAYLOAD_LENGTH_POS &&
+           this->size == PACKET_HEADER_SIZE + this->data[PAYLOAD_LENGTH_POS] + PACKET_CRC_SIZE;
+  }
+};
+
+/**
+ * Typed, read-only accessors over a raw frame
+ */
+class FrameView {
+ public:
+  explicit FrameView(const uint8_t *data) : data_(data) {};
+  explicit FrameView(const Frame &frame) : data_(frame.data) {};
+
+  inline NodeAddress destination() const { return static_cast<NodeAddress>(this->data_[DESTINATION_ADDRESS_POS]); }
+  inline NodeAddress source() const { return static_cast<NodeAddress>(this->data_[SOURCE_ADDRESS_POS]); }
+  inline Subnet subnet() const { return static_cast<Subnet>(this->data_[SUBNET_POS]); }
+  inline SendMethod send_method() const { return static_cast<SendMethod>(this->data_[SEND_METHOD_POS]); }
+  inline uint8_t send_param_1() const { return this->data_[SEND_PARAMETER_1_POS]; }
+  inline uint8_t send_param_2() const { return this->data_[SEND_PARAMETER_2_POS]; }
+  inline NodeType source_node_type() const { return static_cast<NodeType>(this->data_[SOURCE_NODE_TYPE_POS]); }
+  inline MessageType message_type() const { return static_cast<MessageType>(this->data_[MESSAGE_TYPE_POS]); }
+  inline uint8_t packet_number() const { return this->data_[PACKET_NUMBER_POS]; }
+  inline uint8_t payload_length() const { return this->data_[PAYLOAD_LENGTH_POS]; }
+  inline const uint8_t *payload() const { return this->data_ + PACKET_HEADER_SIZE; }
+  inline uint16_t checksum() const {
+    const uint8_t *crc = this->payload() + this->payload_length();
+    return (crc[0] << 8) | crc[1];
+  }
+  inline uint16_t calculate_checksum() const {
+    return comfortnet::calculate_checksum(this->data_, PACKET_HEADER_SIZE + this->payload_length());
+  }
+  inline bool is_checksum_valid() const { return this->checksum() == this->calculate_checksum(); }
+  inline uint8_t size() const { return PACKET_HEADER_SIZE + this->payload_length() + PACKET_CRC_SIZE; }
+  inline const uint8_t *data() const { return this->data_; }
+
+ protected:
+  const uint8_t *data_;
+};
+
+/**
+ * Serializes a frame directly into a Frame buffer in one pass.
+ *
+ * Write the header, append the payload, then call finish() to fill in the payload length and checksum.
+ */
+class FrameBuilder {
+ public:
+  explicit FrameBuilder(Frame &frame) : frame_(frame) {};
+
+  inline FrameBuilder &header(NodeAddress dst_adr, NodeAddress src_adr, Subnet subnet, SendMethod send_method,
+                              uint8_t send_param_1, uint8_t send_param_2, NodeType src_node_type,
+                              MessageType msg_type, uint8_t packet_num) {
+    uint8_t *data = this->frame_.data;
+    data[DESTINATION_ADDRESS_POS] = static_cast<uint8_t>(dst_adr);
+    data[SOURCE_ADDRESS_POS] = static_cast<uint8_t>(src_adr);
+    data[SUBNET_POS] = static_cast<uint8_t>(subnet);
+    data[SEND_METHOD_POS] = static_cast<uint8_t>(send_method);
+    data[SEND_PARAMETER_1_POS] = send_param_1;
+    data[SEND_PARAMETER_2_POS] = send_param_2;
+    data[SOURCE_NODE_TYPE_POS] = static_cast<uint8_t>(src_node_type);
+    data[MESSAGE_TYPE_POS] = static_cast<uint8_t>(msg_type);
+    data[PACKET_NUMBER_POS] = packet_num;
+    data[PAYLOAD_LENGTH_POS] = 0;
+    this->frame_.size = PACKET_HEADER_SIZE;
+    return *this;
+  }
+  inline FrameBuilder &append(uint8_t byte) {
+    if (this->frame_.size < PACKET_HEADER_SIZE + MAX_PAYLOAD_SIZE) {
+      this->frame_.data[this->frame_.size++] = byte;
+    }
+    return *this;
+  }
+  inline FrameBuilder &append(const uint8_t *data, uint8_t data_len) {
+    for (uint8_t i = 0; i < data_len; i++) {
+      this->append(data[i]);
+    }
+    return *this;
+  }
+  inline FrameBuilder &append(const MacAddress &mac_address) {
+    return this->append(mac_address.mac, MAC_ADDRESS_SIZE);
+  }
+  inline FrameBuilder &append(const SessionId &session_id) {
+    return this->append(session_id.sessionid, SESSION_ID_SIZE);
+  }
+  /**
+   * Fills in the payload length and appends the checksum
+   */
+  inline void finish() {
+    uint8_t payload_len = this->frame_.size - PACKET_HEADER_SIZE;
+    this->frame_.data[PAYLOAD_LENGTH_POS] = payload_len;
+    uint16_t crc = calculate_checksum(this->frame_.data, this->frame_.size);
+    this->frame_.data[this->frame_.size++] = (crc >> 8) & 0xFF;
+    this->frame_.data[this->frame_.size++] = crc & 0xFF;
+  }
+
+ protected:
+  Frame &frame_;
+};
+
+inline void MacAddress::write(FrameBuilder &builder) const { builder.append(*this); }
+inline void SessionId::write(FrameBuilder &builder) const { builder.append(*this); }
+
+}  // namespace comfortnet
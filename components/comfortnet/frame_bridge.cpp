@@ -0,0 +1,199 @@
+#include "frame_bridge.h"
+
+#ifdef USE_COMFORTNET_FRAME_BRIDGE
+
+#include <cerrno>
+#include <cstring>
+#include "esphome/core/log.h"
+
+namespace comfortnet {
+
+static const char *const TAG = "comfortnet.bridge";
+
+// How long to wait before trying to open the server again, e.g. while the network is still coming up
+static const uint32_t START_RETRY_INTERVAL = 5000;
+
+void FrameBridge::loop(uint32_t now, const InjectCallback &inject) {
+  if (this->server_ == nullptr) {
+    if (this->start_attempted_ && now - this->last_start_attempt_ < START_RETRY_INTERVAL) {
+      return;
+    }
+    this->start_attempted_ = true;
+    this->last_start_attempt_ = now;
+    if (!this->start_server_()) {
+      return;
+    }
+  }
+  this->accept_client_();
+  if (this->client_ == nullptr) {
+    return;
+  }
+  this->flush_();
+
+  while (this->client_ != nullptr) {
+    if (this->rx_frame_held_) {
+      InjectResult result = inject(FrameView(this->rx_frame_));
+      if (result == InjectResult::BUSY) {
+        // No room yet, leave the rest in the socket so the host has to wait
+        return;
+      }
+      if (result == InjectResult::ACCEPTED) {
+        this->injected_count_++;
+      } else {
+        this->rejected_count_++;
+      }
+      this->rx_frame_held_ = false;
+      this->rx_frame_.clear();
+    }
+    if (!this->read_()) {
+      return;
+    }
+  }
+}
+
+void FrameBridge::publish(const FrameView &frame, bool is_tx, uint32_t now) {
+  if (this->client_ == nullptr) {
+    return;
+  }
+  uint8_t frame_size = frame.size();
+  uint16_t record_len = FRAME_BRIDGE_RECORD_HEADER_SIZE + frame_size;
+  if (this->tx_buffer_len_ + FRAME_BRIDGE_LENGTH_SIZE + record_len > FRAME_BRIDGE_BUFFER_SIZE) {
+    this->flush_();
+    if (this->tx_buffer_len_ + FRAME_BRIDGE_LENGTH_SIZE + record_len > FRAME_BRIDGE_BUFFER_SIZE) {
+      this->dropped_count_++;
+      return;
+    }
+  }
+  uint8_t *record = this->tx_buffer_ + this->tx_buffer_len_;
+  record[0] = record_len & 0xFF;
+  record[1] = (record_len >> 8) & 0xFF;
+  record[2] = now & 0xFF;
+  record[3] = (now >> 8) & 0xFF;
+  record[4] = (now >> 16) & 0xFF;
+  record[5] = (now >> 24) & 0xFF;
+  record[6] = is_tx ? FRAME_BRIDGE_DIRECTION_TX : FRAME_BRIDGE_DIRECTION_RX;
+  memcpy(record + FRAME_BRIDGE_LENGTH_SIZE + FRAME_BRIDGE_RECORD_HEADER_SIZE, frame.data(), frame_size);
+  this->tx_buffer_len_ += FRAME_BRIDGE_LENGTH_SIZE + record_len;
+  this->sent_count_++;
+  this->flush_();
+}
+
+bool FrameBridge::start_server_() {
+  this->server_ = esphome::socket::socket_ip(SOCK_STREAM, 0);
+  if (this->server_ == nullptr) {
+    ESP_LOGW(TAG, "Could not create socket, retrying");
+    return false;
+  }
+  int enable = 1;
+  this->server_->setsockopt(SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(int));
+  this->server_->setblocking(false);
+
+  struct sockaddr_storage server;
+  socklen_t server_len = esphome::socket::set_sockaddr_any((struct sockaddr *) &server, sizeof(server), this->port_);
+  if (server_len == 0 || this->server_->bind((struct sockaddr *) &server, server_len) != 0 ||
+      this->server_->listen(1) != 0) {
+    ESP_LOGW(TAG, "Could not listen on port %u: errno %d, retrying", this->port_, errno);
+    this->server_ = nullptr;
+    return false;
+  }
+  ESP_LOGI(TAG, "Frame bridge listening on port %u", this->port_);
+  return true;
+}
+
+void FrameBridge::accept_client_() {
+  struct sockaddr_storage source_addr;
+  socklen_t addr_len = sizeof(source_addr);
+  auto client = this->server_->accept((struct sockaddr *) &source_addr, &addr_len);
+  if (client == nullptr) {
+    return;
+  }
+  if (this->client_ != nullptr) {
+    this->close_client_("replaced by a new connection");
+  }
+  int enable = 1;
+  client->setsockopt(IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(int));
+  client->setblocking(false);
+  this->client_ = std::move(client);
+  ESP_LOGI(TAG, "Frame bridge client connected");
+}
+
+void FrameBridge::close_client_(const char *reason) {
+  ESP_LOGI(TAG, "Frame bridge client disconnected: %s", reason);
+  this->client_->close();
+  this->client_ = nullptr;
+  this->tx_buffer_len_ = 0;
+  this->rx_length_received_ = 0;
+  this->rx_frame_held_ = false;
+  this->rx_frame_.clear();
+}
+
+void FrameBridge::flush_() {
+  if (this->client_ == nullptr || this->tx_buffer_len_ == 0) {
+    return;
+  }
+  ssize_t written = this->client_->write(this->tx_buffer_, this->tx_buffer_len_);
+  if (written < 0) {
+    if (errno != EWOULDBLOCK && errno != EAGAIN) {
+      this->close_client_("write failed");
+    }
+    return;
+  }
+  this->tx_buffer_len_ -= written;
+  if (this->tx_buffer_len_ > 0) {
+    memmove(this->tx_buffer_, this->tx_buffer_ + written, this->tx_buffer_len_);
+  }
+}
+
+bool FrameBridge::read_() {
+  ssize_t received;
+  if (this->rx_length_received_ < FRAME_BRIDGE_LENGTH_SIZE) {
+    received = this->client_->read(this->rx_length_ + this->rx_length_received_,
+                                   FRAME_BRIDGE_LENGTH_SIZE - this->rx_length_received_);
+  } else {
+    received = this->client_->read(this->rx_frame_.data + this->rx_frame_.size,
+                                   this->rx_expected_ - this->rx_frame_.size);
+  }
+  if (received == 0) {
+    this->close_client_("closed by host");
+    return false;
+  }
+  if (received < 0) {
+    if (errno != EWOULDBLOCK && errno != EAGAIN) {
+      this->close_client_("read failed");
+    }
+    return false;
+  }
+
+  if (this->rx_length_received_ < FRAME_BRIDGE_LENGTH_SIZE) {
+    this->rx_length_received_ += received;
+    if (this->rx_length_received_ < FRAME_BRIDGE_LENGTH_SIZE) {
+      return true;
+    }
+    this->rx_expected_ = this->rx_length_[0] | (this->rx_length_[1] << 8);
+    if (this->rx_expected_ < PACKET_HEADER_SIZE + PACKET_CRC_SIZE || this->rx_expected_ > MAX_FRAME_SIZE) {
+      // There is no way to find the next record boundary after this
+      this->rejected_count_++;
+      this->close_client_("bad record length");
+      return false;
+    }
+    return true;
+  }
+
+  this->rx_frame_.size += received;
+  if (this->rx_frame_.size < this->rx_expected_) {
+    return true;
+  }
+  this->rx_length_received_ = 0;
+  if (!this->rx_frame_.is_complete() || !FrameView(this->rx_frame_).is_checksum_valid()) {
+    ESP_LOGW(TAG, "Discarding malformed frame from host");
+    this->rejected_count_++;
+    this->rx_frame_.clear();
+    return true;
+  }
+  this->rx_frame_held_ = true;
+  return true;
+}
+
+}  // namespace comfortnet
+
+#endif  // USE_COMFORTNET_FRAME_BRIDGE
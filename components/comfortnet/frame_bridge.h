@@ -0,0 +1,93 @@
+#pragma once
+
+#include "esphome/core/defines.h"
+
+#ifdef USE_COMFORTNET_FRAME_BRIDGE
+
+#include <functional>
+#include <memory>
+#include "esphome/components/socket/socket.h"
+#include "frame.h"
+
+namespace comfortnet {
+
+// Every record in either direction starts with its length (little endian), not counting the prefix itself
+#define FRAME_BRIDGE_LENGTH_SIZE 2
+// Device to host records: timestamp (little endian millis), direction, then the raw frame
+#define FRAME_BRIDGE_RECORD_HEADER_SIZE 5
+#define FRAME_BRIDGE_DIRECTION_RX 0
+#define FRAME_BRIDGE_DIRECTION_TX 1
+// Records waiting for the host to read them. Records that don't fit are dropped.
+#define FRAME_BRIDGE_BUFFER_SIZE 1024
+
+/**
+ * Single-client TCP server that streams every validated frame to a host tool, and accepts raw frames back to send.
+ *
+ * Host to device records are a length prefix followed by one complete frame. While the pending message queue is full
+ * the bridge stops reading, so TCP flow control pushes back on the host instead of frames being lost.
+ */
+class FrameBridge {
+ public:
+  enum class InjectResult : uint8_t {
+    ACCEPTED,
+    BUSY,      // No room for it yet, so it is offered again later
+    REJECTED,  // It can't be sent at all, e.g. in listen only mode
+  };
+  /**
+   * Called with each frame the host sent
+   */
+  using InjectCallback = std::function<InjectResult(const FrameView &frame)>;
+
+  inline void set_port(uint16_t port) { this->port_ = port; }
+  inline uint16_t get_port() const { return this->port_; }
+  inline bool is_enabled() const { return this->port_ != 0; }
+  inline bool is_connected() const { return this->client_ != nullptr; }
+
+  /**
+   * Accepts clients, writes out buffered records and reads frames from the host
+   */
+  void loop(uint32_t now, const InjectCallback &inject);
+  /**
+   * Queues a frame for the connected host, if there is one
+   */
+  void publish(const FrameView &frame, bool is_tx, uint32_t now);
+
+  inline uint32_t get_sent_count() const { return this->sent_count_; }
+  inline uint32_t get_dropped_count() const { return this->dropped_count_; }
+  inline uint32_t get_injected_count() const { return this->injected_count_; }
+  inline uint32_t get_rejected_count() const { return this->rejected_count_; }
+
+ protected:
+  bool start_server_();
+  void accept_client_();
+  void close_client_(const char *reason);
+  void flush_();
+  /**
+   * Reads whatever the host has sent so far. Returns false once there is nothing more to read right now.
+   */
+  bool read_();
+
+  uint16_t port_{0};
+  uint32_t last_start_attempt_{0};
+  bool start_attempted_{false};
+  std::unique_ptr<esphome::socket::Socket> server_;
+  std::unique_ptr<esphome::socket::Socket> client_;
+
+  uint8_t tx_buffer_[FRAME_BRIDGE_BUFFER_SIZE];
+  uint16_t tx_buffer_len_{0};
+
+  uint8_t rx_length_[FRAME_BRIDGE_LENGTH_SIZE];
+  uint8_t rx_length_received_{0};
+  uint16_t rx_expected_{0};
+  Frame rx_frame_;
+  bool rx_frame_held_{false};  // A complete frame is waiting for room in the pending message queue
+
+  uint32_t sent_count_{0};
+  uint32_t dropped_count_{0};   // Records lost because the host wasn't reading fast enough
+  uint32_t injected_count_{0};
+  uint32_t rejected_count_{0};  // Malformed frames from the host, and frames we couldn't queue
+};
+
+}  // namespace comfortnet
+
+#endif  // USE_COMFORTNET_FRAME_BRIDGE
@@ -0,0 +1,111 @@
+#include "loop_profiler.h"
+
+#ifdef USE_COMFORTNET_PROFILING
+
+#include <algorithm>
+#include <cstring>
+
+namespace comfortnet {
+
+const char *loop_phase_to_string(LoopPhase phase) {
+  switch (phase) {
+    case LoopPhase::OTHER:
+      return "OTHER";
+    case LoopPhase::TRANSMIT:
+      return "TRANSMIT";
+    case LoopPhase::UART_READ:
+      return "UART_READ";
+    case LoopPhase::CHECKSUM:
+      return "CHECKSUM";
+    case LoopPhase::LOGGING:
+      return "LOGGING";
+    case LoopPhase::DISPATCH:
+      return "DISPATCH";
+    case LoopPhase::LISTENERS:
+      return "LISTENERS";
+    case LoopPhase::FRAME_BRIDGE:
+      return "FRAME_BRIDGE";
+    case LoopPhase::HOUSEKEEPING:
+      return "HOUSEKEEPING";
+    default:
+      return "UNKNOWN";
+  }
+}
+
+void LoopProfiler::begin_loop(uint32_t now) {
+  this->stack_[0] = LoopPhase::OTHER;
+  this->depth_ = 1;
+  this->skipped_depth_ = 0;
+  this->mark_ = now;
+  this->start_ = now;
+  memset(this->current_, 0, sizeof(this->current_));
+}
+
+uint32_t LoopProfiler::end_loop(uint32_t now) {
+  if (this->depth_ == 0) {
+    return 0;
+  }
+  this->charge_(now);
+  this->depth_ = 0;
+  uint32_t elapsed = now - this->start_;
+
+  for (uint8_t i = 0; i < static_cast<uint8_t>(LoopPhase::COUNT); i++) {
+    this->phases_[i].total += this->current_[i];
+    this->phases_[i].max = std::max(this->phases_[i].max, this->current_[i]);
+  }
+  this->loop_.total += elapsed;
+  this->loop_.max = std::max(this->loop_.max, elapsed);
+  this->loop_count_++;
+
+  if (elapsed >= this->slow_threshold_) {
+    this->slow_count_++;
+    memcpy(this->last_slow_, this->current_, sizeof(this->current_));
+  }
+  if (elapsed > this->slowest_time_) {
+    this->slowest_time_ = elapsed;
+    memcpy(this->slowest_, this->current_, sizeof(this->current_));
+  }
+  return elapsed;
+}
+
+bool LoopProfiler::enter(LoopPhase phase, uint32_t now) {
+  if (this->depth_ == 0) {
+    return false;
+  }
+  if (this->depth_ >= LOOP_PROFILER_MAX_DEPTH) {
+    this->skipped_depth_++;
+    return true;
+  }
+  this->charge_(now);
+  this->stack_[this->depth_++] = phase;
+  return true;
+}
+
+void LoopProfiler::exit(uint32_t now) {
+  if (this->skipped_depth_ > 0) {
+    this->skipped_depth_--;
+    return;
+  }
+  if (this->depth_ <= 1) {
+    return;  // The loop already ended, or only OTHER is left
+  }
+  this->charge_(now);
+  this->depth_--;
+}
+
+void LoopProfiler::reset() {
+  for (LoopPhaseStats &phase : this->phases_) {
+    phase = LoopPhaseStats();
+  }
+  this->loop_ = LoopPhaseStats();
+  this->loop_count_ = 0;
+}
+
+void LoopProfiler::charge_(uint32_t now) {
+  this->current_[static_cast<uint8_t>(this->stack_[this->depth_ - 1])] += now - this->mark_;
+  this->mark_ = now;
+}
+
+}  // namespace comfortnet
+
+#endif
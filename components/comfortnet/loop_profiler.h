@@ -0,0 +1,144 @@
+#pragma once
+
+#include "esphome/core/defines.h"
+
+#ifdef USE_COMFORTNET_PROFILING
+
+#include <cstdint>
+#include "clock.h"
+
+namespace comfortnet {
+
+// Phases nested deeper than this are counted in their parent
+#define LOOP_PROFILER_MAX_DEPTH 6
+
+/**
+ * Parts of Comfortnet::loop() timed separately
+ */
+enum class LoopPhase : uint8_t {
+  OTHER,         // loop() itself, outside every other phase
+  TRANSMIT,      // Starting and finishing transmits
+  UART_READ,     // Reading the UART and assembling frames
+  CHECKSUM,      // Validating received and sent frames
+  LOGGING,       // Formatting and writing the frame log
+  DISPATCH,      // Protocol handling of a frame, including queueing replies
+  LISTENERS,     // Sensor, command and packet callbacks
+  FRAME_BRIDGE,  // Streaming frames to, and taking frames from, the bridge client
+  HOUSEKEEPING,  // Shared data, segment and timeout upkeep
+  COUNT,
+};
+
+const char *loop_phase_to_string(LoopPhase phase);
+
+/**
+ * Time spent in one phase, in microseconds per loop() call
+ */
+struct LoopPhaseStats {
+  uint32_t total{0};
+  uint32_t max{0};
+};
+
+/**
+ * Measures where the time in Comfortnet::loop() goes, split by phase.
+ *
+ * Time is only charged to the innermost phase, so a listener called while dispatching a frame counts as listener time
+ * and not dispatch time too. Stats cover the calls since the last reset(), and the slowest call since boot is kept
+ * with its breakdown.
+ */
+class LoopProfiler {
+ public:
+  /**
+   * RAII helper that times the rest of its scope as the given phase
+   */
+  class Scope {
+   public:
+    Scope(LoopProfiler &profiler, Clock *clock, LoopPhase phase) : profiler_(profiler), clock_(clock) {
+      this->active_ = profiler.enter(phase, clock->micros());
+    }
+    ~Scope() {
+      if (this->active_) {
+        this->profiler_.exit(this->clock_->micros());
+      }
+    }
+    Scope(const Scope &) = delete;
+    Scope &operator=(const Scope &) = delete;
+
+   protected:
+    LoopProfiler &profiler_;
+    Clock *clock_;
+    bool active_;
+  };
+
+  void begin_loop(uint32_t now);
+  /**
+   * Returns the time the call took, in microseconds
+   */
+  uint32_t end_loop(uint32_t now);
+  /**
+   * Returns false if the phase isn't timed, because no loop is running or the phases are nested too deep
+   */
+  bool enter(LoopPhase phase, uint32_t now);
+  void exit(uint32_t now);
+  void reset();
+
+  inline void set_slow_threshold(uint32_t slow_threshold) { this->slow_threshold_ = slow_threshold; }
+  inline uint32_t get_slow_threshold() const { return this->slow_threshold_; }
+
+  inline const LoopPhaseStats &get_phase(LoopPhase phase) const {
+    return this->phases_[static_cast<uint8_t>(phase)];
+  }
+  inline const LoopPhaseStats &get_loop() const { return this->loop_; }
+  inline uint32_t get_loop_count() const { return this->loop_count_; }
+  inline uint32_t get_mean(const LoopPhaseStats &stats) const {
+    return this->loop_count_ == 0 ? 0 : stats.total / this->loop_count_;
+  }
+  /**
+   * Calls at or over the slow threshold since boot
+   */
+  inline uint32_t get_slow_count() const { return this->slow_count_; }
+  /**
+   * Breakdown of the slowest call since boot
+   */
+  inline uint32_t get_slowest_phase_time(LoopPhase phase) const {
+    return this->slowest_[static_cast<uint8_t>(phase)];
+  }
+  inline uint32_t get_slowest_time() const { return this->slowest_time_; }
+  /**
+   * Breakdown of the last call that took too long, until the next one is captured
+   */
+  inline uint32_t get_last_slow_phase_time(LoopPhase phase) const {
+    return this->last_slow_[static_cast<uint8_t>(phase)];
+  }
+
+ protected:
+  void charge_(uint32_t now);
+
+  uint32_t slow_threshold_{20000};
+
+  LoopPhase stack_[LOOP_PROFILER_MAX_DEPTH];
+  uint8_t depth_{0};          // 0 while no loop is running
+  uint8_t skipped_depth_{0};  // Phases entered past the maximum depth, still to be exited
+  uint32_t mark_{0};          // When time was last charged to a phase
+  uint32_t start_{0};
+  uint32_t current_[static_cast<uint8_t>(LoopPhase::COUNT)]{};
+
+  LoopPhaseStats phases_[static_cast<uint8_t>(LoopPhase::COUNT)];
+  LoopPhaseStats loop_;
+  uint32_t loop_count_{0};
+
+  uint32_t slow_count_{0};
+  uint32_t slowest_time_{0};
+  uint32_t slowest_[static_cast<uint8_t>(LoopPhase::COUNT)]{};
+  uint32_t last_slow_[static_cast<uint8_t>(LoopPhase::COUNT)]{};
+};
+
+}  // namespace comfortnet
+
+#define COMFORTNET_PROFILE_PHASE(phase) \
+  const comfortnet::LoopProfiler::Scope profile_scope(this->loop_profiler_, this->clock_, comfortnet::LoopPhase::phase)
+
+#else
+
+#define COMFORTNET_PROFILE_PHASE(phase)
+
+#endif
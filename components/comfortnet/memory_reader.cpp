@@ -0,0 +1,116 @@
+#include <algorithm>
+#include "memory_reader.h"
+#include "esphome/core/log.h"
+
+namespace comfortnet {
+
+static const char *const TAG = "comfortnet.memory_reader";
+
+// How long we wait for the next expected response before asking again, long enough for a few dataflow cycles
+static const uint32_t DMA_RESPONSE_TIMEOUT = 10000;
+// Retries without progress before the read is abandoned
+static const uint8_t DMA_MAX_RETRIES = 3;
+
+bool MemoryReader::start(NodeType node_type, uint16_t start_address, uint32_t length, Callback callback,
+                         uint32_t now) {
+  if (this->active_) {
+    ESP_LOGW(TAG, "A memory read is already running");
+    return false;
+  }
+  if (length == 0) {
+    return false;
+  }
+  this->node_type_ = node_type;
+  this->callback_ = std::move(callback);
+  this->next_request_address_ = start_address;
+  this->next_response_address_ = start_address;
+  this->end_address_ = std::min<uint32_t>(static_cast<uint32_t>(start_address) + length, 0x10000);
+  this->in_flight_ = 0;
+  this->last_progress_time_ = now;
+  this->retries_ = 0;
+  this->retry_count_ = 0;
+  this->bytes_read_ = 0;
+  this->cycles_ = 0;
+  this->active_ = true;
+  ESP_LOGI(TAG, "Reading 0x%04X-0x%04X from node type 0x%02X", start_address, this->end_address_ - 1, node_type);
+  return true;
+}
+
+void MemoryReader::cancel() {
+  this->active_ = false;
+  this->in_flight_ = 0;
+}
+
+bool MemoryReader::next_request(uint8_t *payload) {
+  if (!this->active_ || this->in_flight_ >= DMA_REQUEST_WINDOW || this->next_request_address_ >= this->end_address_) {
+    return false;
+  }
+  uint8_t chunk = std::min<uint32_t>(this->end_address_ - this->next_request_address_, DMA_MAX_CHUNK_SIZE);
+  payload[0] = this->next_request_address_ & 0xFF;
+  payload[1] = (this->next_request_address_ >> 8) & 0xFF;
+  payload[2] = chunk;
+  this->next_request_address_ += chunk;
+  this->in_flight_++;
+  return true;
+}
+
+void MemoryReader::handle_response(const uint8_t *payload, uint8_t payload_len, uint32_t now) {
+  if (!this->active_ || payload_len < DMA_RESPONSE_HEADER_SIZE) {
+    return;
+  }
+  uint16_t address = (payload[1] << 8) | payload[0];
+  if (this->in_flight_ > 0) {
+    this->in_flight_--;
+  }
+  if (address != this->next_response_address_) {
+    // A shorter chunk than we asked for leaves a gap, so ask again from where the data actually ended
+    ESP_LOGD(TAG, "Expected memory at 0x%04X, got 0x%04X", this->next_response_address_, address);
+    if (this->in_flight_ == 0) {
+      this->next_request_address_ = this->next_response_address_;
+    }
+    return;
+  }
+  const uint8_t *data = payload + DMA_RESPONSE_HEADER_SIZE;
+  uint8_t data_len = payload_len - DMA_RESPONSE_HEADER_SIZE;
+  this->next_response_address_ += data_len;
+  this->bytes_read_ += data_len;
+  this->last_progress_time_ = now;
+  this->retries_ = 0;
+  if (this->callback_) {
+    this->callback_(address, data, data_len);
+  }
+  if (data_len == 0 || this->next_response_address_ >= this->end_address_) {
+    // An empty response means the node has nothing more to give us
+    this->active_ = false;
+    ESP_LOGI(TAG, "Memory read finished, %" PRIu32 " bytes in %" PRIu32 " cycles (%.1f bytes/cycle)",
+             this->bytes_read_, this->cycles_, this->get_bytes_per_cycle());
+  }
+}
+
+bool MemoryReader::expire(uint32_t now) {
+  if (!this->active_ || now - this->last_progress_time_ <= DMA_RESPONSE_TIMEOUT) {
+    return false;
+  }
+  if (this->retries_ >= DMA_MAX_RETRIES) {
+    ESP_LOGW(TAG, "No response for memory at 0x%04X after %u retries, abandoning the read",
+             this->next_response_address_, this->retries_);
+    this->cancel();
+    return false;
+  }
+  this->retries_++;
+  this->retry_count_++;
+  ESP_LOGD(TAG, "No response for memory at 0x%04X, asking again", this->next_response_address_);
+  // Requests still queued or lost on the way are forgotten, late responses to them are ignored or simply accepted
+  this->next_request_address_ = this->next_response_address_;
+  this->in_flight_ = 0;
+  this->last_progress_time_ = now;
+  return true;
+}
+
+void MemoryReader::on_cycle() {
+  if (this->active_) {
+    this->cycles_++;
+  }
+}
+
+}  // namespace comfortnet
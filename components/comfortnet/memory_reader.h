@@ -0,0 +1,79 @@
+#pragma once
+
+#include <functional>
+#include "types.h"
+
+namespace comfortnet {
+
+// Request: address (little endian), byte count. Response: address (little endian), data.
+#define DMA_REQUEST_SIZE 3
+#define DMA_RESPONSE_HEADER_SIZE 2
+#define DMA_MAX_CHUNK_SIZE (MAX_PAYLOAD_SIZE - DMA_RESPONSE_HEADER_SIZE)
+// Requests kept queued ahead of the bus, so the next one is ready on the very next token. They aren't pipelined, the
+// bus still carries one request per token and each waits for its response.
+#define DMA_REQUEST_WINDOW 2
+
+/**
+ * Walks a node's memory with DIRECT_MEMORY_ACCESS_READ requests in maximum-sized chunks.
+ *
+ * The reader only tracks progress. Comfortnet queues the requests it hands out and feeds back the responses. If no
+ * response arrives in time, the read restarts from the first missing address, and gives up after a few tries.
+ */
+class MemoryReader {
+ public:
+  /**
+   * Called with each chunk as it arrives, in address order
+   */
+  using Callback = std::function<void(uint16_t address, const uint8_t *data, uint8_t data_len)>;
+
+  /**
+   * Starts reading length bytes from start_address. Fails if a read is already running.
+   */
+  bool start(NodeType node_type, uint16_t start_address, uint32_t length, Callback callback, uint32_t now);
+  void cancel();
+  inline bool is_active() const { return this->active_; }
+  inline NodeType get_node_type() const { return this->node_type_; }
+
+  /**
+   * Writes the next request payload if another request should be queued, and returns false otherwise
+   */
+  bool next_request(uint8_t *payload);
+  /**
+   * Handles a DIRECT_MEMORY_ACCESS_READ_RESPONSE payload from the node being read
+   */
+  void handle_response(const uint8_t *payload, uint8_t payload_len, uint32_t now);
+  /**
+   * Requests the missing data again if no response arrived in time. Returns true if new requests should be queued.
+   */
+  bool expire(uint32_t now);
+  /**
+   * Marks the start of a new dataflow cycle, for throughput statistics
+   */
+  void on_cycle();
+
+  inline uint32_t get_bytes_read() const { return this->bytes_read_; }
+  inline uint32_t get_cycles() const { return this->cycles_; }
+  inline uint32_t get_retry_count() const { return this->retry_count_; }
+  /**
+   * Average bytes read per dataflow cycle over the current, or most recent, read
+   */
+  inline float get_bytes_per_cycle() const {
+    return this->cycles_ == 0 ? 0.0f : static_cast<float>(this->bytes_read_) / this->cycles_;
+  }
+
+ protected:
+  NodeType node_type_{NodeType::ANY};
+  Callback callback_;
+  bool active_{false};
+  uint32_t next_request_address_{0};   // Next address to request
+  uint32_t next_response_address_{0};  // Next address we expect a response for
+  uint32_t end_address_{0};
+  uint8_t in_flight_{0};
+  uint32_t last_progress_time_{0};  // When the read started or last received the data it expected
+  uint8_t retries_{0};              // Retries since the read last made progress
+  uint32_t retry_count_{0};         // Retries over the current, or most recent, read
+  uint32_t bytes_read_{0};
+  uint32_t cycles_{0};
+};
+
+}  // namespace comfortnet
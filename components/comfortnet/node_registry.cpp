@@ -0,0 +1,120 @@
+#include "node_registry.h"
+
+namespace comfortnet {
+
+// Weight given to each new latency sample (1/8)
+static const float LATENCY_EWMA_WEIGHT = 0.125f;
+
+// Length of a dataflow ACK carrying the sender's MAC and session ID
+static const uint8_t ACK_IDENTITY_LENGTH = 1 + MAC_ADDRESS_SIZE + SESSION_ID_SIZE;
+
+void NodeRegistry::set_node_list(const uint8_t *data, uint8_t data_len) {
+  // The coordinator is never part of the list, but we still want to keep track of it
+  auto is_stale = [data, data_len](const NodeInfo &node) {
+    uint8_t addr = static_cast<uint8_t>(node.address);
+    if (addr >= data_len) {
+      return node.address != NodeAddress::COORDINATOR;
+    }
+    return static_cast<NodeType>(data[addr]) != node.node_type;
+  };
+
+  // Skip all work if the coordinator just sent the same list again
+  size_t count = 0;
+  bool unchanged = true;
+  for (uint8_t i = 0; i < data_len; i++) {
+    if (data[i] == static_cast<uint8_t>(NodeType::ANY)) {
+      continue;
+    }
+    count++;
+    const NodeInfo *node = this->find(static_cast<NodeAddress>(i));
+    if (node == nullptr || node->node_type != static_cast<NodeType>(data[i])) {
+      unchanged = false;
+    }
+  }
+  if (unchanged && count + (this->find(NodeAddress::COORDINATOR) != nullptr ? 1 : 0) == this->nodes_.size()) {
+    return;
+  }
+
+  // Drop nodes that left the network, or changed type
+  this->nodes_.erase(std::remove_if(this->nodes_.begin(), this->nodes_.end(), is_stale), this->nodes_.end());
+  this->rebuild_index_();
+
+  for (uint8_t i = 0; i < data_len; i++) {
+    if (data[i] != static_cast<uint8_t>(NodeType::ANY)) {
+      NodeInfo *node = this->get_or_add_(static_cast<NodeAddress>(i));
+      if (node != nullptr) {
+        node->node_type = static_cast<NodeType>(data[i]);
+      }
+    }
+  }
+}
+
+void NodeRegistry::observe_frame(NodeAddress dst_adr, NodeAddress src_adr, NodeType src_node_type,
+                                 MessageType message_type, uint8_t packet_number, const uint8_t *payload,
+                                 uint8_t payload_len, uint32_t now) {
+  if (src_adr != NodeAddress::BROADCAST) {
+    NodeInfo *node = this->get_or_add_(src_adr);
+    if (node != nullptr) {
+      node->last_seen = now;
+      if (node->node_type == NodeType::ANY) {
+        node->node_type = src_node_type;
+      }
+      if (node->awaiting_response) {
+        float latency = static_cast<float>(now - node->request_time);
+        node->latency_ewma = node->latency_ewma == 0.0f
+                                 ? latency
+                                 : node->latency_ewma + (latency - node->latency_ewma) * LATENCY_EWMA_WEIGHT;
+        node->awaiting_response = false;
+      }
+      if (PACKET_IS_DATAFLOW(packet_number) && payload_len > 0) {
+        if (payload[0] == R2R_NACK) {
+          node->nak_count++;
+        } else if (payload[0] == R2R_ACK && payload_len == ACK_IDENTITY_LENGTH) {
+          std::copy(payload + 1, payload + 1 + MAC_ADDRESS_SIZE, node->mac_address.mac);
+          std::copy(payload + 1 + MAC_ADDRESS_SIZE, payload + ACK_IDENTITY_LENGTH, node->session_id.sessionid);
+          node->has_mac = true;
+        }
+      }
+    }
+  }
+
+  // Requests addressed to a single node start a latency measurement
+  bool is_request = (static_cast<uint8_t>(message_type) & 0x80) == 0 && !PACKET_IS_DATAFLOW(packet_number);
+  if (is_request && dst_adr != NodeAddress::BROADCAST) {
+    NodeInfo *node = this->find(dst_adr);
+    if (node != nullptr) {
+      if (node->awaiting_response) {
+        node->missed_responses++;
+      }
+      node->awaiting_response = true;
+      node->request_time = now;
+    }
+  }
+}
+
+void NodeRegistry::clear() {
+  this->nodes_.clear();
+  std::fill(std::begin(this->index_), std::end(this->index_), 0);
+}
+
+NodeInfo *NodeRegistry::get_or_add_(NodeAddress address) {
+  NodeInfo *node = this->find(address);
+  if (node != nullptr) {
+    return node;
+  }
+  if (this->nodes_.size() >= 255) {
+    return nullptr;  // Index can't address any more entries
+  }
+  this->nodes_.emplace_back(address);
+  this->index_[static_cast<uint8_t>(address)] = this->nodes_.size();
+  return &this->nodes_.back();
+}
+
+void NodeRegistry::rebuild_index_() {
+  std::fill(std::begin(this->index_), std::end(this->index_), 0);
+  for (size_t i = 0; i < this->nodes_.size(); i++) {
+    this->index_[static_cast<uint8_t>(this->nodes_[i].address)] = i + 1;
+  }
+}
+
+}  // namespace comfortnet
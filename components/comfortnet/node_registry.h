@@ -0,0 +1,81 @@
+#pragma once
+
+#include <vector>
+#include <optional>
+#include <algorithm>
+#include "types.h"
+
+namespace comfortnet {
+
+/**
+ * Everything we have learned about a single node on the network, either from the coordinator's node list, or by
+ * watching the node's traffic
+ */
+struct NodeInfo {
+  NodeAddress address;
+  NodeType node_type{NodeType::ANY};
+  bool has_mac{false};
+  MacAddress mac_address{};
+  SessionId session_id{};
+  uint32_t last_seen{0};         // Last time this node transmitted anything
+  uint32_t request_time{0};      // When the request this node has yet to answer was seen
+  bool awaiting_response{false};
+  float latency_ewma{0.0f};      // Smoothed time between a request to this node and its reply, in milliseconds
+  uint16_t nak_count{0};         // Number of NAKs this node has sent
+  uint16_t missed_responses{0};  // Number of requests to this node that were never answered
+
+  explicit NodeInfo(NodeAddress address) : address(address) {};
+};
+
+/**
+ * Compact registry of the nodes on the network.
+ *
+ * Entries are only kept for nodes that actually exist, with a small address index for O(1) lookups.
+ */
+class NodeRegistry {
+ public:
+  /**
+   * Applies a node list from the coordinator. The position in the list is the node's address, and the value is the
+   * node's type. Nodes no longer in the list are dropped.
+   */
+  void set_node_list(const uint8_t *data, uint8_t data_len);
+  /**
+   * Updates statistics from a validated frame seen on the bus
+   */
+  void observe_frame(NodeAddress dst_adr, NodeAddress src_adr, NodeType src_node_type, MessageType message_type,
+                     uint8_t packet_number, const uint8_t *payload, uint8_t payload_len, uint32_t now);
+  void clear();
+
+  inline NodeInfo *find(NodeAddress address) {
+    uint8_t idx = this->index_[static_cast<uint8_t>(address)];
+    return idx == 0 ? nullptr : &this->nodes_[idx - 1];
+  }
+  inline const NodeInfo *find(NodeAddress address) const {
+    uint8_t idx = this->index_[static_cast<uint8_t>(address)];
+    return idx == 0 ? nullptr : &this->nodes_[idx - 1];
+  }
+  inline NodeType get_node_type(NodeAddress address) const {
+    const NodeInfo *node = this->find(address);
+    return node == nullptr ? NodeType::ANY : node->node_type;
+  }
+  inline std::optional<MacAddress> get_node_mac(NodeAddress address) const {
+    const NodeInfo *node = this->find(address);
+    if (node == nullptr || !node->has_mac) {
+      return std::nullopt;
+    }
+    return node->mac_address;
+  }
+
+  inline size_t size() const { return this->nodes_.size(); }
+  inline std::vector<NodeInfo>::const_iterator begin() const { return this->nodes_.cbegin(); }
+  inline std::vector<NodeInfo>::const_iterator end() const { return this->nodes_.cend(); }
+
+ protected:
+  NodeInfo *get_or_add_(NodeAddress address);
+  void rebuild_index_();
+
+  std::vector<NodeInfo> nodes_;
+  uint8_t index_[256]{};  // Node address -> position in nodes_ + 1, or 0 if unknown
+};
+
+}  // namespace comfortnet
@@ -5,17 +5,18 @@ from esphome.const import (
     CONF_ID,
     CONF_MAX_VALUE,
     CONF_MIN_VALUE,
-    CONF_NUMBER_DATAPOINT,
     CONF_STEP,
 )
 
 from .. import (
     CONF_COMFORTNET_ID,
     COMFORTNET_CLIENT_SCHEMA,
+    CONF_CONTROL_COMMAND,
     CONF_SENSOR_KEY,
     CONF_TARGET_DEVICE_TYPE,
     ComfortnetClient,
     comfortnet_ns,
+    validate_control_command_target,
 )
 
 DEPENDENCIES = ["comfortnet"]
@@ -38,11 +39,13 @@ CONFIG_SCHEMA = cv.All(
             cv.Required(CONF_MAX_VALUE): cv.float_,
             cv.Required(CONF_MIN_VALUE): cv.float_,
             cv.Required(CONF_STEP): cv.positive_float,
+            cv.Optional(CONF_CONTROL_COMMAND): cv.uint16_t,
         }
     )
     .extend(COMFORTNET_CLIENT_SCHEMA)
     .extend(cv.COMPONENT_SCHEMA),
     validate_min_max,
+    validate_control_command_target,
 )
 
 
@@ -61,3 +64,6 @@ async def to_code(config):
     cg.add(var.set_comfortnet_parent(paren))
     cg.add(var.set_sensor_key(config[CONF_SENSOR_KEY]))
     cg.add(var.set_sensor_target_device_type(config[CONF_TARGET_DEVICE_TYPE]))
+    if CONF_CONTROL_COMMAND in config:
+        cg.add_define("USE_COMFORTNET_COMMAND_LISTENERS")
+        cg.add(var.set_control_command(config[CONF_CONTROL_COMMAND]))
@@ -6,34 +6,53 @@ namespace comfortnet {
 static const char *const TAG = "comfortnet.number";
 
 void ComfortnetNumber::setup() {
+  this->parent_->register_catalog_polling(this->sensor_key_, this->sensor_target_device_type_);
   this->parent_->register_listener(
     this->sensor_key_,
     [this](const ComfortnetData &datapoint) {
       if (datapoint.device_type == this->sensor_target_device_type_ || this->sensor_target_device_type_ == NodeType::ANY) {
         if (datapoint.type == ComfortnetData::DataType::FLOAT) {
-          ESP_LOGV(TAG, "Callback Number: %s Device: 0x%02X Value: %.1f%%", this->sensor_key_.c_str(), datapoint.device_type, std::get<float>(datapoint.data));
+          ESP_LOGV(TAG, "Callback Number: %s Device: 0x%02X Value: %.1f", this->sensor_key_.c_str(), datapoint.device_type, std::get<float>(datapoint.data));
           this->publish_state(std::get<float>(datapoint.data));
         } else {
-          ESP_LOGW(TAG, "Callback Number: %s received wrong data type %u", datapoint.type);
+          ESP_LOGW(TAG, "Callback Number: %s received wrong data type %u", this->sensor_key_.c_str(), datapoint.type);
         }
       }
     });
+#ifdef USE_COMFORTNET_COMMAND_LISTENERS
+  if (this->control_command_.has_value()) {
+    // Follow the command on the bus too, ours included, so the state doesn't wait for the next poll
+    this->parent_->register_command_listener(*this->control_command_, [this](const ComfortnetCommandData &data) {
+      if (data.response || data.node_type != this->sensor_target_device_type_) {
+        return;
+      }
+      auto value = decode_command_value(command_layout(data.cmd_type), data.payload, data.payload_len);
+      if (value.has_value()) {
+        this->publish_state(*value);
+      }
+    });
+  }
+#endif
 }
 
 void ComfortnetNumber::control(float value) {
-  ESP_LOGV(TAG, "Setting number %s: %f", this->number_id_.c_str(), value);
-  if (this->type_ == ComfortnetDatapointType::FLOAT) {
-    this->parent_->set_float_datapoint_value(this->number_id_, value, this->src_adr_);
-  } else if (this->type_ == ComfortnetDatapointType::ENUM_TEXT) {
-    this->parent_->set_enum_datapoint_value(this->number_id_, value, this->src_adr_);
+  if (!this->control_command_.has_value()) {
+    ESP_LOGW(TAG, "Number %s has no control command to write with", this->sensor_key_.c_str());
+    return;
+  }
+  ESP_LOGV(TAG, "Setting number %s: %f", this->sensor_key_.c_str(), value);
+  if (!this->parent_->set_control_command(this->sensor_target_device_type_, *this->control_command_, value)) {
+    ESP_LOGW(TAG, "Unable to send control command 0x%04X", *this->control_command_);
   }
-  this->publish_state(value);
 }
 
 void ComfortnetNumber::dump_config() {
   LOG_NUMBER("", "ComfortNet Number", this);
   ESP_LOGCONFIG(TAG, "  Sensor Key: %s", this->sensor_key_.c_str());
   ESP_LOGCONFIG(TAG, "  Target Device Type: %02x", this->sensor_target_device_type_);
+  if (this->control_command_.has_value()) {
+    ESP_LOGCONFIG(TAG, "  Control Command: 0x%04X", *this->control_command_);
+  }
 }
 
 }  // namespace comfortnet
@@ -12,12 +12,14 @@ class ComfortnetNumber : public esphome::number::Number, public esphome::Compone
   void dump_config() override;
   void set_sensor_key(const std::string &sensor_key) { this->sensor_key_ = sensor_key; };
   void set_sensor_target_device_type(uint8_t type) { this->sensor_target_device_type_ = static_cast<NodeType>(type); };
+  void set_control_command(uint16_t command) { this->control_command_ = static_cast<CommandType>(command); };
 
  protected:
   void control(float value) override;
 
   std::string sensor_key_{""};
   NodeType sensor_target_device_type_{NodeType::ANY};
+  std::optional<CommandType> control_command_;
 };
 
 }  // namespace comfortnet
@@ -0,0 +1,77 @@
+#include <algorithm>
+#include "payload_pool.h"
+
+namespace comfortnet {
+
+uint8_t PayloadPool::blocks_[PAYLOAD_POOL_SIZE][MAX_PAYLOAD_SIZE];
+uint32_t PayloadPool::in_use_mask_ = 0;
+uint32_t PayloadPool::exhausted_count_ = 0;
+
+uint8_t *PayloadPool::acquire() {
+  for (uint8_t i = 0; i < PAYLOAD_POOL_SIZE; i++) {
+    if ((in_use_mask_ & (1UL << i)) == 0) {
+      in_use_mask_ |= 1UL << i;
+      return blocks_[i];
+    }
+  }
+  exhausted_count_++;
+  return nullptr;
+}
+
+void PayloadPool::release(uint8_t *block) {
+  if (block == nullptr) {
+    return;
+  }
+  uint8_t i = (block - blocks_[0]) / MAX_PAYLOAD_SIZE;
+  in_use_mask_ &= ~(1UL << i);
+}
+
+uint8_t PayloadPool::get_blocks_in_use() {
+  uint8_t count = 0;
+  for (uint8_t i = 0; i < PAYLOAD_POOL_SIZE; i++) {
+    if ((in_use_mask_ & (1UL << i)) != 0) {
+      count++;
+    }
+  }
+  return count;
+}
+
+PooledPayload::PooledPayload(const uint8_t *data, size_t data_len) {
+  if (data_len == 0) {
+    return;  // Empty payloads don't need a block
+  }
+  if (data_len > MAX_PAYLOAD_SIZE) {
+    this->too_large_ = true;
+    return;
+  }
+  this->block_ = PayloadPool::acquire();
+  if (this->block_ == nullptr) {
+    this->exhausted_ = true;
+    return;
+  }
+  this->length_ = data_len;
+  std::copy(data, data + this->length_, this->block_);
+}
+
+PooledPayload::PooledPayload(PooledPayload &&other) noexcept
+    : block_(other.block_), length_(other.length_), exhausted_(other.exhausted_), too_large_(other.too_large_) {
+  other.block_ = nullptr;
+  other.length_ = 0;
+}
+
+PooledPayload &PooledPayload::operator=(PooledPayload &&other) noexcept {
+  if (this != &other) {
+    PayloadPool::release(this->block_);
+    this->block_ = other.block_;
+    this->length_ = other.length_;
+    this->exhausted_ = other.exhausted_;
+    this->too_large_ = other.too_large_;
+    other.block_ = nullptr;
+    other.length_ = 0;
+  }
+  return *this;
+}
+
+PooledPayload::~PooledPayload() { PayloadPool::release(this->block_); }
+
+}  // namespace comfortnet
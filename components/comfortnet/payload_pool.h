@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cinttypes>
+#include <vector>
+#include "esphome/core/defines.h"
+#include "types.h"
+
+namespace comfortnet {
+
+// Shared by every bus, so scale it with the number of buses
+#ifdef COMFORTNET_BUS_COUNT
+#define PAYLOAD_POOL_SIZE (8 * COMFORTNET_BUS_COUNT)
+#else
+#define PAYLOAD_POOL_SIZE 8
+#endif
+
+/**
+ * Fixed slab of MAX_PAYLOAD_SIZE blocks backing queued message payloads, so queueing a message never touches the heap
+ */
+class PayloadPool {
+ public:
+  /**
+   * Takes a free block from the pool, or returns nullptr if the pool is exhausted
+   */
+  static uint8_t *acquire();
+  static void release(uint8_t *block);
+
+  static uint8_t get_blocks_in_use();
+  /**
+   * Number of times a block was requested while the pool was empty
+   */
+  static uint32_t get_exhausted_count() { return exhausted_count_; }
+
+ protected:
+  static uint8_t blocks_[PAYLOAD_POOL_SIZE][MAX_PAYLOAD_SIZE];
+  static uint32_t in_use_mask_;
+  static uint32_t exhausted_count_;
+};
+
+/**
+ * Move-only handle to a payload stored in the PayloadPool. The block is returned to the pool when the handle is
+ * destroyed.
+ */
+class PooledPayload {
+ public:
+  PooledPayload() = default;
+  /**
+   * Payloads over MAX_PAYLOAD_SIZE aren't stored at all, see is_too_large()
+   */
+  PooledPayload(const uint8_t *data, size_t data_len);
+  PooledPayload(const std::vector<uint8_t> &data) : PooledPayload(data.data(), data.size()) {};
+  PooledPayload(PooledPayload &&other) noexcept;
+  PooledPayload &operator=(PooledPayload &&other) noexcept;
+  PooledPayload(const PooledPayload &) = delete;
+  PooledPayload &operator=(const PooledPayload &) = delete;
+  ~PooledPayload();
+
+  inline const uint8_t *data() const { return this->block_; }
+  inline uint8_t size() const { return this->length_; }
+  inline bool empty() const { return this->length_ == 0; }
+  /**
+   * False if the pool was exhausted and the payload could not be stored
+   */
+  inline bool is_valid() const { return !this->exhausted_; }
+  /**
+   * True if the payload didn't fit in one frame, so nothing was stored
+   */
+  inline bool is_too_large() const { return this->too_large_; }
+
+ protected:
+  uint8_t *block_{nullptr};
+  uint8_t length_{0};
+  bool exhausted_{false};
+  bool too_large_{false};
+};
+
+}  // namespace comfortnet
@@ -0,0 +1,36 @@
+#include "runtime_accumulator.h"
+
+namespace comfortnet {
+
+void RuntimeAccumulator::add(float percent, uint32_t now) {
+  bool running = percent > 0.0f;
+  if (this->has_last_) {
+    uint32_t elapsed = now - this->last_time_;
+    if (elapsed <= this->max_gap_) {
+      this->window_tracked_millis_ += elapsed;
+      if (this->last_percent_ > 0.0f) {
+        this->totals_.on_millis += elapsed;
+        this->totals_.full_load_millis += static_cast<uint64_t>(elapsed * this->last_percent_ / 100.0f);
+        this->window_on_millis_ += elapsed;
+      }
+    }
+    if (running && this->last_percent_ <= 0.0f) {
+      this->totals_.cycles++;
+    }
+  }
+  this->last_time_ = now;
+  this->last_percent_ = percent;
+  this->has_last_ = true;
+}
+
+std::optional<float> RuntimeAccumulator::take_duty() {
+  if (this->window_tracked_millis_ == 0) {
+    return std::nullopt;
+  }
+  float duty = 100.0f * this->window_on_millis_ / this->window_tracked_millis_;
+  this->window_on_millis_ = 0;
+  this->window_tracked_millis_ = 0;
+  return duty;
+}
+
+}  // namespace comfortnet
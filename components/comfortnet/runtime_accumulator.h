@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+
+namespace comfortnet {
+
+/**
+ * Lifetime totals of one stage, saved to flash
+ */
+struct RuntimeTotals {
+  uint64_t on_millis;         // Time the stage was running at any level
+  uint64_t full_load_millis;  // Running time weighted by how hard the stage ran, 50% for an hour is half an hour
+  uint32_t cycles;            // Times the stage started
+};
+
+/**
+ * Integrates a stage's actual demand, in percent, into running time, full load time, start count and duty.
+ *
+ * The last value is held until the next one arrives. Gaps longer than max_gap, such as when the node stops answering,
+ * are left out rather than guessed at.
+ */
+class RuntimeAccumulator {
+ public:
+  void add(float percent, uint32_t now);
+  inline void set_max_gap(uint32_t max_gap) { this->max_gap_ = max_gap; }
+  inline void set_totals(const RuntimeTotals &totals) { this->totals_ = totals; }
+  inline const RuntimeTotals &get_totals() const { return this->totals_; }
+  /**
+   * Percent of the time since the last call that the stage was running. Returns nullopt if no data arrived.
+   */
+  std::optional<float> take_duty();
+
+ protected:
+  RuntimeTotals totals_{};
+  uint32_t max_gap_{300000};
+  uint32_t last_time_{0};
+  float last_percent_{0.0f};
+  bool has_last_{false};
+  uint32_t window_on_millis_{0};       // Running time since take_duty() was last called
+  uint32_t window_tracked_millis_{0};  // Time with data since take_duty() was last called
+};
+
+}  // namespace comfortnet
@@ -0,0 +1,118 @@
+#include <algorithm>
+#include "segment_assembler.h"
+#include "esphome/core/log.h"
+
+namespace comfortnet {
+
+static const char *const TAG = "comfortnet.segments";
+
+// How long an assembly waits for its next segment, before it is passed on as it is
+static const uint32_t SEGMENT_TIMEOUT = 5000;
+
+bool SegmentAssembler::feed(const FrameView &frame, uint32_t now) {
+  NodeAddress source = frame.source();
+  MessageType message_type = frame.message_type();
+  uint8_t segment = PACKET_SEGMENT(frame.packet_number());
+  uint8_t payload_len = frame.payload_length();
+  SegmentAssembly *assembly = this->find_(source);
+  if (assembly != nullptr && (assembly->message_type != message_type || segment == 0)) {
+    // Its source moved on, so the message ended on a full frame
+    this->finish_(*assembly, now);
+    assembly = nullptr;
+  }
+
+  if (segment == 0) {
+    if (payload_len < MAX_PAYLOAD_SIZE) {
+      return false;  // Fits in a single frame
+    }
+    assembly = this->start_(frame, now);
+  } else if (assembly == nullptr) {
+    ESP_LOGV(TAG, "Segment %u of 0x%02X from 0x%02X without a start, ignoring", segment, message_type, source);
+    return true;
+  } else if (segment != assembly->next_segment) {
+    this->drop_(*assembly, "out of order");
+    return true;
+  }
+
+  if (assembly->length + payload_len > MAX_SEGMENTED_PAYLOAD_SIZE) {
+    this->drop_(*assembly, "too large");
+    return true;
+  }
+  const uint8_t *payload = frame.payload();
+  std::copy(payload, payload + payload_len, assembly->data + assembly->length);
+  assembly->length += payload_len;
+  assembly->next_segment++;
+  assembly->last_segment_time = now;
+  if (payload_len < MAX_PAYLOAD_SIZE) {
+    this->finish_(*assembly, now);
+  }
+  return true;
+}
+
+void SegmentAssembler::expire(uint32_t now) {
+  for (auto &assembly : this->assemblies_) {
+    if (assembly.in_use && now - assembly.last_segment_time > SEGMENT_TIMEOUT) {
+      this->finish_(assembly, now);
+    }
+  }
+}
+
+void SegmentAssembler::clear() {
+  for (auto &assembly : this->assemblies_) {
+    assembly.in_use = false;
+  }
+}
+
+SegmentAssembly *SegmentAssembler::find_(NodeAddress source) {
+  for (auto &assembly : this->assemblies_) {
+    if (assembly.in_use && assembly.source == source) {
+      return &assembly;
+    }
+  }
+  return nullptr;
+}
+
+SegmentAssembly *SegmentAssembler::start_(const FrameView &frame, uint32_t now) {
+  SegmentAssembly *assembly = nullptr;
+  for (auto &slot : this->assemblies_) {
+    if (!slot.in_use) {
+      assembly = &slot;
+      break;
+    }
+  }
+  if (assembly == nullptr) {
+    // Every slot is busy, so give up on whichever has waited the longest
+    assembly = &this->assemblies_[0];
+    for (auto &slot : this->assemblies_) {
+      if (now - slot.last_segment_time > now - assembly->last_segment_time) {
+        assembly = &slot;
+      }
+    }
+    this->drop_(*assembly, "evicted");
+  }
+  assembly->source = frame.source();
+  assembly->message_type = frame.message_type();
+  std::copy(frame.data(), frame.data() + PACKET_HEADER_SIZE, assembly->header);
+  assembly->in_use = true;
+  assembly->next_segment = 0;
+  assembly->length = 0;
+  return assembly;
+}
+
+void SegmentAssembler::finish_(SegmentAssembly &assembly, uint32_t now) {
+  // Freed first, the slot is only reused by a new message, which can't start until the callback returns
+  assembly.in_use = false;
+  this->completed_count_++;
+  if (this->callback_) {
+    this->callback_(FrameView(assembly.header), assembly.data, assembly.length, now);
+  }
+}
+
+void SegmentAssembler::drop_(SegmentAssembly &assembly, const char *reason) {
+  ESP_LOGW(TAG, "Dropping 0x%02X message from 0x%02X after %u segments: %s", assembly.message_type, assembly.source,
+           assembly.next_segment, reason);
+  assembly.in_use = false;
+  this->dropped_count_++;
+}
+
+}  // namespace comfortnet
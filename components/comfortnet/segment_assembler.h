@@ -0,0 +1,69 @@
+#pragma once
+
+#include <functional>
+#include "frame.h"
+
+namespace comfortnet {
+
+#define SEGMENT_ASSEMBLY_SLOTS 2
+#define MAX_SEGMENTS 4
+#define MAX_SEGMENTED_PAYLOAD_SIZE (MAX_PAYLOAD_SIZE * MAX_SEGMENTS)
+
+/**
+ * A message being put back together from its segments
+ */
+struct SegmentAssembly {
+  NodeAddress source;
+  MessageType message_type;
+  uint8_t header[PACKET_HEADER_SIZE];  // Header of the first segment, which the whole message is passed on with
+  bool in_use{false};
+  uint8_t next_segment{0};  // Index of the segment we expect next
+  uint16_t length{0};
+  uint32_t last_segment_time{0};
+  uint8_t data[MAX_SEGMENTED_PAYLOAD_SIZE];
+};
+
+/**
+ * Reassembles messages too large for a single frame.
+ *
+ * Segments are numbered by the low bits of the packet number. A frame with a full payload means another segment
+ * follows, and a shorter or empty one ends the message. A message that ends on a full frame has nothing to mark its
+ * end, so it is finished once it goes quiet, or once its source sends something else. Each source has at most one
+ * message being assembled, which is dropped if a segment goes missing or it grows too large.
+ */
+class SegmentAssembler {
+ public:
+  /**
+   * Called with each complete message, along with the header of its first segment
+   */
+  using Callback = std::function<void(const FrameView &header, const uint8_t *payload, uint16_t payload_len,
+                                      uint32_t now)>;
+
+  inline void set_callback(Callback callback) { this->callback_ = std::move(callback); }
+  /**
+   * Takes a frame that is part of a multi-frame message, and returns false for a whole message on its own. Any
+   * message its source left unfinished is passed on first.
+   */
+  bool feed(const FrameView &frame, uint32_t now);
+  /**
+   * Finishes messages that have stopped receiving segments
+   */
+  void expire(uint32_t now);
+  void clear();
+
+  uint32_t get_completed_count() const { return this->completed_count_; }
+  uint32_t get_dropped_count() const { return this->dropped_count_; }
+
+ protected:
+  SegmentAssembly *find_(NodeAddress source);
+  SegmentAssembly *start_(const FrameView &frame, uint32_t now);
+  void finish_(SegmentAssembly &assembly, uint32_t now);
+  void drop_(SegmentAssembly &assembly, const char *reason);
+
+  Callback callback_;
+  SegmentAssembly assemblies_[SEGMENT_ASSEMBLY_SLOTS];
+  uint32_t completed_count_{0};
+  uint32_t dropped_count_{0};
+};
+
+}  // namespace comfortnet
@@ -1,16 +1,17 @@
 import esphome.codegen as cg
 import esphome.config_validation as cv
 from esphome.components import select
-from esphome.const import CONF_ENUM_DATAPOINT, CONF_OPTIONS
+from esphome.const import CONF_OPTIONS
 
 from .. import (
     CONF_COMFORTNET_ID,
-    CONF_DEVICE_ADDRESS,
-    CONF_REQUEST_ONCE,
-    CONF_SRC_ADDRESS,
     COMFORTNET_CLIENT_SCHEMA,
+    CONF_CONTROL_COMMAND,
+    CONF_SENSOR_KEY,
+    CONF_TARGET_DEVICE_TYPE,
     ComfortnetClient,
     comfortnet_ns,
+    validate_control_command_target,
 )
 
 DEPENDENCIES = ["comfortnet"]
@@ -31,16 +32,17 @@ def ensure_option_map(value):
     return value
 
 
-CONFIG_SCHEMA = (
+CONFIG_SCHEMA = cv.All(
     select.select_schema(ComfortnetSelect)
     .extend(
         {
-            cv.Required(CONF_ENUM_DATAPOINT): cv.string,
             cv.Required(CONF_OPTIONS): ensure_option_map,
+            cv.Optional(CONF_CONTROL_COMMAND): cv.uint16_t,
         }
     )
     .extend(COMFORTNET_CLIENT_SCHEMA)
-    .extend(cv.COMPONENT_SCHEMA)
+    .extend(cv.COMPONENT_SCHEMA),
+    validate_control_command_target,
 )
 
 
@@ -49,9 +51,11 @@ async def to_code(config):
     var = await select.new_select(config, options=list(options_map.values()))
     await cg.register_component(var, config)
     cg.add(var.set_select_mappings(list(options_map.keys())))
+
     paren = await cg.get_variable(config[CONF_COMFORTNET_ID])
     cg.add(var.set_comfortnet_parent(paren))
-    cg.add(var.set_request_mod(config[CONF_DEVICE_ADDRESS]))
-    cg.add(var.set_request_once(config[CONF_REQUEST_ONCE]))
-    cg.add(var.set_select_id(config[CONF_ENUM_DATAPOINT]))
-    cg.add(var.set_src_adr(config[CONF_SRC_ADDRESS]))
+    cg.add(var.set_sensor_key(config[CONF_SENSOR_KEY]))
+    cg.add(var.set_sensor_target_device_type(config[CONF_TARGET_DEVICE_TYPE]))
+    if CONF_CONTROL_COMMAND in config:
+        cg.add_define("USE_COMFORTNET_COMMAND_LISTENERS")
+        cg.add(var.set_control_command(config[CONF_CONTROL_COMMAND]))
@@ -1,50 +1,81 @@
 #include "esphome/core/log.h"
 #include "comfortnet_select.h"
 
-namespace esphome {
 namespace comfortnet {
 
 static const char *const TAG = "comfortnet.select";
 
 void ComfortnetSelect::setup() {
-  this->parent_->register_listener(
-      this->select_id_, this->request_mod_, this->request_once_,
-      [this](const ComfortnetDatapoint &datapoint) {
-        uint8_t enum_value = datapoint.value_enum;
-        ESP_LOGV(TAG, "MCU reported select %s value %u", this->select_id_.c_str(), enum_value);
-        auto mappings = this->mappings_;
-        auto it = std::find(mappings.cbegin(), mappings.cend(), enum_value);
-        if (it == mappings.end()) {
-          ESP_LOGW(TAG, "Invalid value %u", enum_value);
-          return;
-        }
-        size_t mapping_idx = std::distance(mappings.cbegin(), it);
-        auto value = this->at(mapping_idx);
-        this->publish_state(value.value());
-      },
-      false, this->src_adr_);
+  this->parent_->register_catalog_polling(this->sensor_key_, this->sensor_target_device_type_);
+  this->parent_->register_listener(this->sensor_key_, [this](const ComfortnetData &datapoint) {
+    if (datapoint.device_type != this->sensor_target_device_type_ &&
+        this->sensor_target_device_type_ != NodeType::ANY) {
+      return;
+    }
+    if (datapoint.type != ComfortnetData::DataType::FLOAT) {
+      ESP_LOGW(TAG, "Callback Select: %s received wrong data type %u", this->sensor_key_.c_str(), datapoint.type);
+      return;
+    }
+    this->publish_mapping_(static_cast<uint8_t>(std::get<float>(datapoint.data)));
+  });
+#ifdef USE_COMFORTNET_COMMAND_LISTENERS
+  if (this->control_command_.has_value()) {
+    // Follow the command on the bus too, ours included, so the state doesn't wait for the next poll
+    this->parent_->register_command_listener(*this->control_command_, [this](const ComfortnetCommandData &data) {
+      if (data.response || data.node_type != this->sensor_target_device_type_) {
+        return;
+      }
+      auto value = decode_command_value(command_layout(data.cmd_type), data.payload, data.payload_len);
+      if (value.has_value()) {
+        this->publish_mapping_(static_cast<uint8_t>(*value));
+      }
+    });
+  }
+#endif
+}
+
+void ComfortnetSelect::publish_mapping_(uint8_t mapping) {
+  ESP_LOGV(TAG, "Select %s reported value %u", this->sensor_key_.c_str(), mapping);
+  auto it = std::find(this->mappings_.cbegin(), this->mappings_.cend(), mapping);
+  if (it == this->mappings_.cend()) {
+    ESP_LOGW(TAG, "Select %s has no option for value %u", this->sensor_key_.c_str(), mapping);
+    return;
+  }
+  auto value = this->at(std::distance(this->mappings_.cbegin(), it));
+  if (value.has_value()) {
+    this->publish_state(value.value());
+  }
 }
 
 void ComfortnetSelect::control(const std::string &value) {
+  if (!this->control_command_.has_value()) {
+    ESP_LOGW(TAG, "Select %s has no control command to write with", this->sensor_key_.c_str());
+    return;
+  }
   auto idx = this->index_of(value);
-  if (idx.has_value()) {
-    uint8_t mapping = this->mappings_.at(idx.value());
-    ESP_LOGV(TAG, "Setting %s datapoint value to %u:%s", this->select_id_.c_str(), mapping, value.c_str());
-    this->parent_->set_enum_datapoint_value(this->select_id_, mapping, this->src_adr_);
+  if (!idx.has_value()) {
+    ESP_LOGW(TAG, "Invalid value %s", value.c_str());
     return;
   }
-  ESP_LOGW(TAG, "Invalid value %s", value.c_str());
+  uint8_t mapping = this->mappings_.at(idx.value());
+  ESP_LOGV(TAG, "Setting select %s to %u:%s", this->sensor_key_.c_str(), mapping, value.c_str());
+  if (!this->parent_->set_control_command(this->sensor_target_device_type_, *this->control_command_, mapping)) {
+    ESP_LOGW(TAG, "Unable to send control command 0x%04X", *this->control_command_);
+  }
 }
 
 void ComfortnetSelect::dump_config() {
   LOG_SELECT("", "ComfortNet Select", this);
-  ESP_LOGCONFIG(TAG, "  Select has datapoint ID %s", this->select_id_.c_str());
+  ESP_LOGCONFIG(TAG, "  Sensor Key: %s", this->sensor_key_.c_str());
+  ESP_LOGCONFIG(TAG, "  Target Device Type: %02x", this->sensor_target_device_type_);
+  if (this->control_command_.has_value()) {
+    ESP_LOGCONFIG(TAG, "  Control Command: 0x%04X", *this->control_command_);
+  }
   ESP_LOGCONFIG(TAG, "  Options are:");
   auto options = this->traits.get_options();
-  for (auto i = 0; i < this->mappings_.size(); i++) {
-    ESP_LOGCONFIG(TAG, "    %i: %s", this->mappings_.at(i), options.at(i).c_str());
+  for (size_t i = 0; i < this->mappings_.size(); i++) {
+    ESP_LOGCONFIG(TAG, "    %u: %s", this->mappings_.at(i), options.at(i).c_str());
   }
 }
 
 }  // namespace comfortnet
-}  // namespace esphome
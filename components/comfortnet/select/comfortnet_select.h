@@ -6,22 +6,25 @@
 
 #include <vector>
 
-namespace esphome {
 namespace comfortnet {
 
-class ComfortnetSelect : public select::Select, public Component, public ComfortnetClient {
+class ComfortnetSelect : public esphome::select::Select, public esphome::Component, public ComfortnetClient {
  public:
   void setup() override;
   void dump_config() override;
-  void set_select_id(const std::string &select_id) { this->select_id_ = select_id; }
+  void set_sensor_key(const std::string &sensor_key) { this->sensor_key_ = sensor_key; };
+  void set_sensor_target_device_type(uint8_t type) { this->sensor_target_device_type_ = static_cast<NodeType>(type); };
+  void set_control_command(uint16_t command) { this->control_command_ = static_cast<CommandType>(command); };
   void set_select_mappings(std::vector<uint8_t> mappings) { this->mappings_ = std::move(mappings); }
 
  protected:
   void control(const std::string &value) override;
+  void publish_mapping_(uint8_t mapping);
 
-  std::string select_id_{""};
+  std::string sensor_key_{""};
+  NodeType sensor_target_device_type_{NodeType::ANY};
+  std::optional<CommandType> control_command_;
   std::vector<uint8_t> mappings_;
 };
 
 }  // namespace comfortnet
-}  // namespace esphome
@@ -1,36 +1,154 @@
 import esphome.codegen as cg
 import esphome.config_validation as cv
+import esphome.final_validate as fv
 from esphome.components import sensor
-from esphome.const import CONF_ID, CONF_SENSOR_DATAPOINT
+from esphome.const import (
+    CONF_ID,
+    CONF_PLATFORM,
+    CONF_SENSOR_DATAPOINT,
+    CONF_TYPE,
+    DEVICE_CLASS_DURATION,
+    STATE_CLASS_MEASUREMENT,
+    STATE_CLASS_TOTAL_INCREASING,
+    UNIT_HOUR,
+    UNIT_PERCENT,
+)
+from esphome.core import CORE
+from esphome.helpers import fnv1a_32bit_hash
 
 from .. import (
     CONF_COMFORTNET_ID,
     COMFORTNET_CLIENT_SCHEMA,
     CONF_SENSOR_KEY,
     CONF_TARGET_DEVICE_TYPE,
+    DOMAIN,
     ComfortnetClient,
     comfortnet_ns,
 )
 
 DEPENDENCIES = ["comfortnet"]
 
+CONF_AGGREGATE = "aggregate"
+CONF_AGGREGATE_WINDOW = "aggregate_window"
+CONF_RUNNING_HOURS = "running_hours"
+CONF_FULL_LOAD_HOURS = "full_load_hours"
+CONF_CYCLES = "cycles"
+CONF_DUTY = "duty"
+
+TYPE_DATA = "data"
+TYPE_RUNTIME = "runtime"
+
 ComfortnetSensor = comfortnet_ns.class_(
     "ComfortnetSensor", sensor.Sensor, cg.Component, ComfortnetClient
 )
+ComfortnetRuntime = comfortnet_ns.class_(
+    "ComfortnetRuntime", cg.PollingComponent, ComfortnetClient
+)
+AggregateType = comfortnet_ns.enum("AggregateType", is_class=True)
+AGGREGATE_TYPES = {
+    "mean": AggregateType.MEAN,
+    "min": AggregateType.MIN,
+    "max": AggregateType.MAX,
+}
 
-CONFIG_SCHEMA = (
-    sensor.sensor_schema(ComfortnetSensor)
-    .extend(COMFORTNET_CLIENT_SCHEMA)
-    .extend(cv.COMPONENT_SCHEMA)
+HOURS_SCHEMA = sensor.sensor_schema(
+    unit_of_measurement=UNIT_HOUR,
+    icon="mdi:timer-outline",
+    accuracy_decimals=1,
+    device_class=DEVICE_CLASS_DURATION,
+    state_class=STATE_CLASS_TOTAL_INCREASING,
 )
 
+CONFIG_SCHEMA = cv.typed_schema(
+    {
+        TYPE_DATA: sensor.sensor_schema(ComfortnetSensor)
+        .extend(
+            {
+                cv.Optional(CONF_AGGREGATE): cv.enum(AGGREGATE_TYPES, lower=True),
+                cv.Optional(
+                    CONF_AGGREGATE_WINDOW, default="60s"
+                ): cv.positive_time_period_milliseconds,
+            }
+        )
+        .extend(COMFORTNET_CLIENT_SCHEMA)
+        .extend(cv.COMPONENT_SCHEMA),
+        TYPE_RUNTIME: cv.Schema(
+            {
+                cv.GenerateID(): cv.declare_id(ComfortnetRuntime),
+                cv.Optional(CONF_RUNNING_HOURS): HOURS_SCHEMA,
+                cv.Optional(CONF_FULL_LOAD_HOURS): HOURS_SCHEMA,
+                cv.Optional(CONF_CYCLES): sensor.sensor_schema(
+                    icon="mdi:counter",
+                    accuracy_decimals=0,
+                    state_class=STATE_CLASS_TOTAL_INCREASING,
+                ),
+                cv.Optional(CONF_DUTY): sensor.sensor_schema(
+                    unit_of_measurement=UNIT_PERCENT,
+                    icon="mdi:percent",
+                    accuracy_decimals=1,
+                    state_class=STATE_CLASS_MEASUREMENT,
+                ),
+            }
+        )
+        .extend(COMFORTNET_CLIENT_SCHEMA)
+        .extend(cv.polling_component_schema("10min")),
+    },
+    default_type=TYPE_DATA,
+)
+
+
+def runtime_preference_key(config):
+    # Built from what is tracked rather than the entity ID, which may be generated
+    # and would shift as packages are added or removed
+    key = f"{config[CONF_SENSOR_KEY]}:{config[CONF_TARGET_DEVICE_TYPE]:02X}"
+    if len(CORE.config[DOMAIN]) > 1:
+        key = f"{config[CONF_COMFORTNET_ID]}:{key}"
+    return key
+
+
+def validate_unique_runtime(config):
+    if config[CONF_TYPE] != TYPE_RUNTIME:
+        return config
+    key = runtime_preference_key(config)
+    matches = [
+        conf
+        for conf in fv.full_config.get().get("sensor", [])
+        if conf.get(CONF_PLATFORM) == DOMAIN
+        and conf.get(CONF_TYPE) == TYPE_RUNTIME
+        and runtime_preference_key(conf) == key
+    ]
+    if len(matches) > 1:
+        raise cv.Invalid(
+            f"Only one runtime sensor can track {config[CONF_SENSOR_KEY]} of "
+            f"node type 0x{config[CONF_TARGET_DEVICE_TYPE]:02X}"
+        )
+    return config
+
+
+FINAL_VALIDATE_SCHEMA = validate_unique_runtime
+
 
 async def to_code(config):
     var = cg.new_Pvariable(config[CONF_ID])
     await cg.register_component(var, config)
-    await sensor.register_sensor(var, config)
 
     paren = await cg.get_variable(config[CONF_COMFORTNET_ID])
     cg.add(var.set_comfortnet_parent(paren))
     cg.add(var.set_sensor_key(config[CONF_SENSOR_KEY]))
     cg.add(var.set_sensor_target_device_type(config[CONF_TARGET_DEVICE_TYPE]))
+
+    if config[CONF_TYPE] == TYPE_RUNTIME:
+        cg.add(
+            var.set_preference_hash(fnv1a_32bit_hash(runtime_preference_key(config)))
+        )
+        for key in (CONF_RUNNING_HOURS, CONF_FULL_LOAD_HOURS, CONF_CYCLES, CONF_DUTY):
+            if key in config:
+                sens = await sensor.new_sensor(config[key])
+                cg.add(getattr(var, f"set_{key}_sensor")(sens))
+        return
+
+    await sensor.register_sensor(var, config)
+    if CONF_AGGREGATE in config:
+        cg.add(
+            var.set_aggregate(config[CONF_AGGREGATE], config[CONF_AGGREGATE_WINDOW])
+        )
@@ -0,0 +1,83 @@
+#include <cstring>
+#include "esphome/core/log.h"
+#include "comfortnet_runtime.h"
+
+namespace comfortnet {
+
+static const char *const TAG = "comfortnet.runtime";
+
+static const uint32_t SAVE_INTERVAL = 60 * 60 * 1000;  // Totals only move slowly, so an hour's loss on reset is fine
+static const float MILLIS_PER_HOUR = 60.0f * 60.0f * 1000.0f;
+
+void ComfortnetRuntime::setup() {
+  this->pref_ = esphome::global_preferences->make_preference<RuntimeTotals>(this->preference_hash_, true);
+  if (this->pref_.load(&this->saved_totals_)) {
+    this->accumulator_.set_totals(this->saved_totals_);
+  }
+  this->last_save_time_ = this->parent_->get_clock()->millis();
+
+  this->parent_->register_catalog_polling(this->sensor_key_, this->sensor_target_device_type_);
+  this->parent_->register_listener(this->sensor_key_, [this](const ComfortnetData &datapoint) {
+    if (datapoint.device_type != this->sensor_target_device_type_ &&
+        this->sensor_target_device_type_ != NodeType::ANY) {
+      return;
+    }
+    if (datapoint.type == ComfortnetData::DataType::FLOAT) {
+      this->accumulator_.add(std::get<float>(datapoint.data), this->parent_->get_clock()->millis());
+    } else if (datapoint.type == ComfortnetData::DataType::BOOLEAN) {
+      this->accumulator_.add(std::get<bool>(datapoint.data) ? 100.0f : 0.0f, this->parent_->get_clock()->millis());
+    } else {
+      ESP_LOGW(TAG, "Callback Runtime: %s received wrong data type %u", this->sensor_key_.c_str(), datapoint.type);
+    }
+  });
+}
+
+void ComfortnetRuntime::update() {
+  const RuntimeTotals &totals = this->accumulator_.get_totals();
+  if (this->running_hours_sensor_ != nullptr) {
+    this->running_hours_sensor_->publish_state(totals.on_millis / MILLIS_PER_HOUR);
+  }
+  if (this->full_load_hours_sensor_ != nullptr) {
+    this->full_load_hours_sensor_->publish_state(totals.full_load_millis / MILLIS_PER_HOUR);
+  }
+  if (this->cycles_sensor_ != nullptr) {
+    this->cycles_sensor_->publish_state(totals.cycles);
+  }
+  auto duty = this->accumulator_.take_duty();
+  if (this->duty_sensor_ != nullptr && duty.has_value()) {
+    this->duty_sensor_->publish_state(*duty);
+  }
+  this->save_(false);
+}
+
+void ComfortnetRuntime::on_safe_shutdown() { this->save_(true); }
+
+void ComfortnetRuntime::save_(bool force) {
+  uint32_t now = this->parent_->get_clock()->millis();
+  if (!force && now - this->last_save_time_ < SAVE_INTERVAL) {
+    return;
+  }
+  const RuntimeTotals &totals = this->accumulator_.get_totals();
+  if (memcmp(&totals, &this->saved_totals_, sizeof(RuntimeTotals)) == 0) {
+    return;  // Nothing ran, save a flash write
+  }
+  if (this->pref_.save(&totals)) {
+    this->saved_totals_ = totals;
+    this->last_save_time_ = now;
+  }
+}
+
+void ComfortnetRuntime::dump_config() {
+  ESP_LOGCONFIG(TAG, "ComfortNet Runtime:");
+  ESP_LOGCONFIG(TAG, "  Sensor Key: %s", this->sensor_key_.c_str());
+  ESP_LOGCONFIG(TAG, "  Target Device Type: %02x", this->sensor_target_device_type_);
+  const RuntimeTotals &totals = this->accumulator_.get_totals();
+  ESP_LOGCONFIG(TAG, "  Running: %.1f h, Full Load: %.1f h, Starts: %" PRIu32, totals.on_millis / MILLIS_PER_HOUR,
+                totals.full_load_millis / MILLIS_PER_HOUR, totals.cycles);
+  LOG_SENSOR("  ", "Running Hours", this->running_hours_sensor_);
+  LOG_SENSOR("  ", "Full Load Hours", this->full_load_hours_sensor_);
+  LOG_SENSOR("  ", "Cycles", this->cycles_sensor_);
+  LOG_SENSOR("  ", "Duty", this->duty_sensor_);
+}
+
+}  // namespace comfortnet
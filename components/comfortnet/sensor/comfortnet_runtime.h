@@ -0,0 +1,48 @@
+#pragma once
+
+#include "esphome/core/component.h"
+#include "esphome/core/preferences.h"
+#include "esphome/components/sensor/sensor.h"
+#include "../comfortnet.h"
+#include "../runtime_accumulator.h"
+
+namespace comfortnet {
+
+/**
+ * Running hours, full load hours, starts and duty of one stage, from its actual demand data_key
+ */
+class ComfortnetRuntime : public esphome::PollingComponent, public ComfortnetClient {
+ public:
+  void setup() override;
+  void update() override;
+  void dump_config() override;
+  void on_safe_shutdown() override;
+  void set_sensor_key(const std::string &sensor_key) { this->sensor_key_ = sensor_key; };
+  void set_sensor_target_device_type(uint8_t type) { this->sensor_target_device_type_ = static_cast<NodeType>(type); };
+  void set_preference_hash(uint32_t hash) { this->preference_hash_ = hash; };
+  void set_running_hours_sensor(esphome::sensor::Sensor *sensor) { this->running_hours_sensor_ = sensor; };
+  void set_full_load_hours_sensor(esphome::sensor::Sensor *sensor) { this->full_load_hours_sensor_ = sensor; };
+  void set_cycles_sensor(esphome::sensor::Sensor *sensor) { this->cycles_sensor_ = sensor; };
+  void set_duty_sensor(esphome::sensor::Sensor *sensor) { this->duty_sensor_ = sensor; };
+
+ protected:
+  /**
+   * Writes the totals to flash if they changed and the last write was long enough ago, or right away if forced
+   */
+  void save_(bool force);
+
+  std::string sensor_key_{""};
+  NodeType sensor_target_device_type_{NodeType::ANY};
+  esphome::sensor::Sensor *running_hours_sensor_{nullptr};
+  esphome::sensor::Sensor *full_load_hours_sensor_{nullptr};
+  esphome::sensor::Sensor *cycles_sensor_{nullptr};
+  esphome::sensor::Sensor *duty_sensor_{nullptr};
+
+  RuntimeAccumulator accumulator_;
+  uint32_t preference_hash_{0};
+  esphome::ESPPreferenceObject pref_;
+  RuntimeTotals saved_totals_{};
+  uint32_t last_save_time_{0};
+};
+
+}  // namespace comfortnet
@@ -6,24 +6,48 @@ namespace comfortnet {
 static const char *const TAG = "comfortnet.sensor";
 
 void ComfortnetSensor::setup() {
+  this->parent_->register_catalog_polling(this->sensor_key_, this->sensor_target_device_type_);
   this->parent_->register_listener(
     this->sensor_key_,
     [this](const ComfortnetData &datapoint) {
       if (datapoint.device_type == this->sensor_target_device_type_ || this->sensor_target_device_type_ == NodeType::ANY) {
         if (datapoint.type == ComfortnetData::DataType::FLOAT) {
           ESP_LOGV(TAG, "Callback Sensor: %s Device: 0x%02X Value: %.1f%%", this->sensor_key_.c_str(), datapoint.device_type, std::get<float>(datapoint.data));
-          this->publish_state(std::get<float>(datapoint.data));
+          this->add_value(std::get<float>(datapoint.data));
         } else {
           ESP_LOGW(TAG, "Callback Sensor: %s received wrong data type %u", datapoint.type);
         }
       }
     });
+  if (this->aggregate_type_ != AggregateType::NONE) {
+    this->set_interval("aggregate", this->aggregate_window_, [this]() { this->publish_window_(); });
+  }
+}
+
+void ComfortnetSensor::add_value(float value) {
+  if (this->aggregate_type_ == AggregateType::NONE) {
+    this->publish_state(value);
+  } else {
+    this->aggregator_.add(value);
+  }
+}
+
+void ComfortnetSensor::publish_window_() {
+  uint32_t count = this->aggregator_.get_count();
+  auto value = this->aggregator_.close(this->aggregate_type_);
+  if (value.has_value()) {
+    ESP_LOGV(TAG, "Sensor: %s Window of %" PRIu32 " values: %.1f", this->sensor_key_.c_str(), count, *value);
+    this->publish_state(*value);
+  }
 }
 
 void ComfortnetSensor::dump_config() {
   LOG_SENSOR("", "ComfortNet Sensor", this);
   ESP_LOGCONFIG(TAG, "  Sensor Key: %s", this->sensor_key_.c_str());
   ESP_LOGCONFIG(TAG, "  Target Device Type: %02x", this->sensor_target_device_type_);
+  if (this->aggregate_type_ != AggregateType::NONE) {
+    ESP_LOGCONFIG(TAG, "  Aggregate: %u over %" PRIu32 " ms", this->aggregate_type_, this->aggregate_window_);
+  }
 }
 
 }  // namespace comfortnet
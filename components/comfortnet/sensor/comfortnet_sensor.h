@@ -3,6 +3,7 @@
 #include "esphome/core/component.h"
 #include "esphome/components/sensor/sensor.h"
 #include "../comfortnet.h"
+#include "../window_aggregator.h"
 
 namespace comfortnet {
 
@@ -12,10 +13,27 @@ class ComfortnetSensor : public esphome::sensor::Sensor, public esphome::Compone
   void dump_config() override;
   void set_sensor_key(const std::string &sensor_key) { this->sensor_key_ = sensor_key; };
   void set_sensor_target_device_type(uint8_t type) { this->sensor_target_device_type_ = static_cast<NodeType>(type); };
+  /**
+   * Publishes only the given statistic of the values seen over each window, instead of every value
+   */
+  void set_aggregate(AggregateType type, uint32_t window) {
+    this->aggregate_type_ = type;
+    this->aggregate_window_ = window;
+  };
+  /**
+   * Publishes value, or adds it to the current window when aggregating. Use this rather than publish_state() to feed
+   * the sensor from a lambda.
+   */
+  void add_value(float value);
 
  protected:
+  void publish_window_();
+
   std::string sensor_key_{""};
   NodeType sensor_target_device_type_{NodeType::ANY};
+  AggregateType aggregate_type_{AggregateType::NONE};
+  uint32_t aggregate_window_{0};
+  WindowAggregator aggregator_;
 };
 
 }  // namespace comfortnet
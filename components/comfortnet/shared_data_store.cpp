@@ -0,0 +1,110 @@
+#include "shared_data_store.h"
+
+#ifdef USE_COMFORTNET_SHARED_DATA
+
+#include <algorithm>
+#include "esphome/core/helpers.h"
+#include "esphome/core/log.h"
+
+namespace comfortnet {
+
+static const char *const TAG = "comfortnet.shared_data";
+
+// Minimum time between flash writes of the shared data
+static const uint32_t SHARED_DATA_WRITE_INTERVAL = 900000;
+
+void SharedDataStore::setup(uint32_t preference_hash) {
+  this->pref_ = esphome::global_preferences->make_preference<SharedDataArena>(preference_hash, true);
+  if (!this->pref_.load(&this->arena_)) {
+    this->arena_ = {};
+    return;
+  }
+  if (this->arena_.crc != this->calculate_crc_()) {
+    ESP_LOGW(TAG, "Saved network shared data is corrupt, discarding");
+    this->arena_ = {};
+    return;
+  }
+  ESP_LOGD(TAG, "Loaded network shared data for %u nodes", this->slots_used());
+}
+
+void SharedDataStore::loop(uint32_t now) {
+  if (this->dirty_ && (!this->has_flushed_ || now - this->last_flush_time_ >= SHARED_DATA_WRITE_INTERVAL)) {
+    this->flush();
+    this->has_flushed_ = true;
+    this->last_flush_time_ = now;
+    // Otherwise this would sit in RAM until the next preferences flash write interval
+    esphome::global_preferences->sync();
+  }
+}
+
+void SharedDataStore::flush() {
+  if (!this->dirty_) {
+    return;
+  }
+  this->arena_.crc = this->calculate_crc_();
+  if (this->pref_.save(&this->arena_)) {
+    this->dirty_ = false;
+  } else {
+    ESP_LOGW(TAG, "Failed to save network shared data");
+  }
+}
+
+const SharedDataSlot *SharedDataStore::find(NodeType node_type) const {
+  for (const SharedDataSlot &slot : this->arena_.slots) {
+    if (slot.length > 0 && slot.image[0] == static_cast<uint8_t>(node_type)) {
+      return &slot;
+    }
+  }
+  return nullptr;
+}
+
+const SharedDataSlot *SharedDataStore::write(NodeType node_type, const uint8_t *data, uint8_t data_len) {
+  if (data_len > SHARED_DATA_IMAGE_SIZE) {
+    data_len = SHARED_DATA_IMAGE_SIZE;
+  }
+  SharedDataSlot *target = const_cast<SharedDataSlot *>(this->find(node_type));
+  if (target == nullptr && data_len == 0) {
+    return nullptr;  // Nothing stored, nothing to clear
+  }
+  if (target == nullptr) {
+    for (SharedDataSlot &slot : this->arena_.slots) {
+      if (slot.length == 0) {
+        target = &slot;
+        break;
+      }
+    }
+  }
+  if (target == nullptr) {
+    ESP_LOGW(TAG, "No free slot to store network shared data for node type 0x%02X", node_type);
+    return nullptr;
+  }
+  if (data_len == 0) {
+    target->length = 0;  // Empty image frees the slot
+  } else if (target->length == data_len && std::equal(data, data + data_len, target->image + 1)) {
+    return target;  // Unchanged, no need to touch flash
+  } else {
+    target->image[0] = static_cast<uint8_t>(node_type);
+    std::copy(data, data + data_len, target->image + 1);
+    target->length = data_len;
+  }
+  this->dirty_ = true;
+  return target;
+}
+
+uint8_t SharedDataStore::slots_used() const {
+  uint8_t used = 0;
+  for (const SharedDataSlot &slot : this->arena_.slots) {
+    if (slot.length > 0) {
+      used++;
+    }
+  }
+  return used;
+}
+
+uint16_t SharedDataStore::calculate_crc_() const {
+  return esphome::crc16(reinterpret_cast<const uint8_t *>(this->arena_.slots), sizeof(this->arena_.slots));
+}
+
+}  // namespace comfortnet
+
+#endif  // USE_COMFORTNET_SHARED_DATA
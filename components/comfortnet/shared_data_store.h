@@ -0,0 +1,72 @@
+#pragma once
+
+#include "esphome/core/defines.h"
+
+#ifdef USE_COMFORTNET_SHARED_DATA
+
+#include "types.h"
+#include "esphome/core/preferences.h"
+
+namespace comfortnet {
+
+#define SHARED_DATA_SLOT_COUNT 4
+#define SHARED_DATA_IMAGE_SIZE (MAX_PAYLOAD_SIZE - 1)
+
+/**
+ * A single node's network shared data sector image
+ */
+struct SharedDataSlot {
+  uint8_t length;                             // Length of the sector image, 0 if the slot is unused
+  uint8_t image[1 + SHARED_DATA_IMAGE_SIZE];  // Node type, followed by the sector image, so it can be sent as-is
+};
+
+struct SharedDataArena {
+  SharedDataSlot slots[SHARED_DATA_SLOT_COUNT];
+  uint16_t crc;
+};
+
+/**
+ * Fixed-slot storage for network shared data (CT-485 Networking Specification 9.8).
+ *
+ * Every node on the network stores a redundant copy of the other nodes' shared data, so it is persisted to flash.
+ * Writes are coalesced and rate-limited to keep flash wear down.
+ */
+class SharedDataStore {
+ public:
+  /**
+   * Loads the saved sector images, discarding them if they fail the CRC check
+   */
+  void setup(uint32_t preference_hash);
+  /**
+   * Writes any changes to flash if enough time has passed since the last write
+   */
+  void loop(uint32_t now);
+  /**
+   * Immediately writes any changes to flash
+   */
+  void flush();
+
+  /**
+   * Returns the slot for the given node type, or nullptr if it has no stored data
+   */
+  const SharedDataSlot *find(NodeType node_type) const;
+  /**
+   * Stores a sector image for the given node type. Returns the updated slot, or nullptr if every slot is in use.
+   */
+  const SharedDataSlot *write(NodeType node_type, const uint8_t *data, uint8_t data_len);
+
+  uint8_t slots_used() const;
+
+ protected:
+  uint16_t calculate_crc_() const;
+
+  esphome::ESPPreferenceObject pref_;
+  SharedDataArena arena_{};
+  bool dirty_{false};
+  bool has_flushed_{false};
+  uint32_t last_flush_time_{0};
+};
+
+}  // namespace comfortnet
+
+#endif  // USE_COMFORTNET_SHARED_DATA
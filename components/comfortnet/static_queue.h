@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cinttypes>
+#include <new>
+#include <utility>
+
+namespace comfortnet {
+
+/**
+ * Fixed capacity FIFO queue with inline storage, for move-only types
+ */
+template<typename T, uint8_t N> class StaticQueue {
+ public:
+  StaticQueue() = default;
+  StaticQueue(const StaticQueue &) = delete;
+  StaticQueue &operator=(const StaticQueue &) = delete;
+  ~StaticQueue() { this->clear(); }
+
+  /**
+   * Adds an item to the back of the queue. Returns false if the queue is full.
+   */
+  bool push(T &&item) {
+    if (this->count_ >= N) {
+      return false;
+    }
+    new (this->slot_((this->head_ + this->count_) % N)) T(std::move(item));
+    this->count_++;
+    return true;
+  }
+  void pop() {
+    if (this->count_ == 0) {
+      return;
+    }
+    this->slot_(this->head_)->~T();
+    this->head_ = (this->head_ + 1) % N;
+    this->count_--;
+  }
+  void clear() {
+    while (this->count_ > 0) {
+      this->pop();
+    }
+  }
+  /**
+   * Removes every item the predicate matches, keeping the rest in order. Returns how many were removed.
+   */
+  template<typename Predicate> uint8_t remove_if(Predicate predicate) {
+    uint8_t kept = 0;
+    for (uint8_t i = 0; i < this->count_; i++) {
+      T *item = this->slot_((this->head_ + i) % N);
+      if (predicate(*item)) {
+        item->~T();
+        continue;
+      }
+      if (kept != i) {
+        // Everything between the kept items and this one has already been destroyed or moved out
+        new (this->slot_((this->head_ + kept) % N)) T(std::move(*item));
+        item->~T();
+      }
+      kept++;
+    }
+    uint8_t removed = this->count_ - kept;
+    this->count_ = kept;
+    return removed;
+  }
+  T &front() { return *this->slot_(this->head_); }
+  const T &front() const { return *this->slot_(this->head_); }
+  T &at(uint8_t index) { return *this->slot_((this->head_ + index) % N); }
+  const T &at(uint8_t index) const { return *this->slot_((this->head_ + index) % N); }
+
+  inline uint8_t size() const { return this->count_; }
+  inline bool empty() const { return this->count_ == 0; }
+  inline bool full() const { return this->count_ >= N; }
+  static constexpr uint8_t capacity() { return N; }
+
+ protected:
+  inline T *slot_(uint8_t index) { return std::launder(reinterpret_cast<T *>(this->storage_[index])); }
+  inline const T *slot_(uint8_t index) const {
+    return std::launder(reinterpret_cast<const T *>(this->storage_[index]));
+  }
+
+  alignas(T) uint8_t storage_[N][sizeof(T)];
+  uint8_t head_{0};
+  uint8_t count_{0};
+};
+
+}  // namespace comfortnet
@@ -1,16 +1,16 @@
 import esphome.codegen as cg
 import esphome.config_validation as cv
 from esphome.components import switch
-from esphome.const import CONF_SWITCH_DATAPOINT
 
 from .. import (
     CONF_COMFORTNET_ID,
-    CONF_DEVICE_ADDRESS,
-    CONF_REQUEST_ONCE,
-    CONF_SRC_ADDRESS,
     COMFORTNET_CLIENT_SCHEMA,
+    CONF_CONTROL_COMMAND,
+    CONF_SENSOR_KEY,
+    CONF_TARGET_DEVICE_TYPE,
     ComfortnetClient,
     comfortnet_ns,
+    validate_control_command_target,
 )
 
 DEPENDENCIES = ["comfortnet"]
@@ -19,15 +19,16 @@ ComfortnetSwitch = comfortnet_ns.class_(
     "ComfortnetSwitch", switch.Switch, cg.Component, ComfortnetClient
 )
 
-CONFIG_SCHEMA = (
+CONFIG_SCHEMA = cv.All(
     switch.switch_schema(ComfortnetSwitch)
     .extend(
         {
-            cv.Required(CONF_SWITCH_DATAPOINT): cv.string,
+            cv.Optional(CONF_CONTROL_COMMAND): cv.uint16_t,
         }
     )
     .extend(cv.COMPONENT_SCHEMA)
-    .extend(COMFORTNET_CLIENT_SCHEMA)
+    .extend(COMFORTNET_CLIENT_SCHEMA),
+    validate_control_command_target,
 )
 
 
@@ -37,7 +38,8 @@ async def to_code(config):
 
     paren = await cg.get_variable(config[CONF_COMFORTNET_ID])
     cg.add(var.set_comfortnet_parent(paren))
-    cg.add(var.set_request_mod(config[CONF_DEVICE_ADDRESS]))
-    cg.add(var.set_request_once(config[CONF_REQUEST_ONCE]))
-    cg.add(var.set_switch_id(config[CONF_SWITCH_DATAPOINT]))
-    cg.add(var.set_src_adr(config[CONF_SRC_ADDRESS]))
+    cg.add(var.set_sensor_key(config[CONF_SENSOR_KEY]))
+    cg.add(var.set_sensor_target_device_type(config[CONF_TARGET_DEVICE_TYPE]))
+    if CONF_CONTROL_COMMAND in config:
+        cg.add_define("USE_COMFORTNET_COMMAND_LISTENERS")
+        cg.add(var.set_control_command(config[CONF_CONTROL_COMMAND]))
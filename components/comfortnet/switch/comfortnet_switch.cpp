@@ -1,31 +1,59 @@
 #include "esphome/core/log.h"
 #include "comfortnet_switch.h"
 
-namespace esphome {
 namespace comfortnet {
 
 static const char *const TAG = "comfortnet.switch";
 
 void ComfortnetSwitch::setup() {
-  this->parent_->register_listener(
-      this->switch_id_, this->request_mod_, this->request_once_,
-      [this](const ComfortnetDatapoint &datapoint) {
-        ESP_LOGV(TAG, "MCU reported switch %s is: %s", this->switch_id_.c_str(), ONOFF(datapoint.value_enum));
-        this->publish_state(datapoint.value_enum);
-      },
-      false, this->src_adr_);
+  this->parent_->register_catalog_polling(this->sensor_key_, this->sensor_target_device_type_);
+  this->parent_->register_listener(this->sensor_key_, [this](const ComfortnetData &datapoint) {
+    if (datapoint.device_type != this->sensor_target_device_type_ &&
+        this->sensor_target_device_type_ != NodeType::ANY) {
+      return;
+    }
+    if (datapoint.type != ComfortnetData::DataType::BOOLEAN) {
+      ESP_LOGW(TAG, "Callback Switch: %s received wrong data type %u", this->sensor_key_.c_str(), datapoint.type);
+      return;
+    }
+    ESP_LOGV(TAG, "Switch %s reported: %s", this->sensor_key_.c_str(), ONOFF(std::get<bool>(datapoint.data)));
+    this->publish_state(std::get<bool>(datapoint.data));
+  });
+#ifdef USE_COMFORTNET_COMMAND_LISTENERS
+  if (this->control_command_.has_value()) {
+    // Follow the command on the bus too, ours included, so the state doesn't wait for the next poll
+    this->parent_->register_command_listener(*this->control_command_, [this](const ComfortnetCommandData &data) {
+      if (data.response || data.node_type != this->sensor_target_device_type_) {
+        return;
+      }
+      auto value = decode_command_value(command_layout(data.cmd_type), data.payload, data.payload_len);
+      if (value.has_value()) {
+        this->publish_state(*value != 0.0f);
+      }
+    });
+  }
+#endif
 }
 
 void ComfortnetSwitch::write_state(bool state) {
-  ESP_LOGV(TAG, "Setting switch %s: %s", this->switch_id_.c_str(), ONOFF(state));
-  this->parent_->set_enum_datapoint_value(this->switch_id_, state, this->src_adr_);
-  this->publish_state(state);
+  if (!this->control_command_.has_value()) {
+    ESP_LOGW(TAG, "Switch %s has no control command to write with", this->sensor_key_.c_str());
+    return;
+  }
+  ESP_LOGV(TAG, "Setting switch %s: %s", this->sensor_key_.c_str(), ONOFF(state));
+  if (!this->parent_->set_control_command(this->sensor_target_device_type_, *this->control_command_,
+                                          state ? 1.0f : 0.0f)) {
+    ESP_LOGW(TAG, "Unable to send control command 0x%04X", *this->control_command_);
+  }
 }
 
 void ComfortnetSwitch::dump_config() {
   LOG_SWITCH("", "ComfortNet Switch", this);
-  ESP_LOGCONFIG(TAG, "  Switch has datapoint ID %s", this->switch_id_.c_str());
+  ESP_LOGCONFIG(TAG, "  Sensor Key: %s", this->sensor_key_.c_str());
+  ESP_LOGCONFIG(TAG, "  Target Device Type: %02x", this->sensor_target_device_type_);
+  if (this->control_command_.has_value()) {
+    ESP_LOGCONFIG(TAG, "  Control Command: 0x%04X", *this->control_command_);
+  }
 }
 
 }  // namespace comfortnet
-}  // namespace esphome
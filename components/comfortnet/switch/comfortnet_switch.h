@@ -4,20 +4,22 @@
 #include "esphome/components/switch/switch.h"
 #include "../comfortnet.h"
 
-namespace esphome {
 namespace comfortnet {
 
-class ComfortnetSwitch : public switch_::Switch, public Component, public ComfortnetClient {
+class ComfortnetSwitch : public esphome::switch_::Switch, public esphome::Component, public ComfortnetClient {
  public:
   void setup() override;
   void dump_config() override;
-  void set_switch_id(const std::string &switch_id) { this->switch_id_ = switch_id; }
+  void set_sensor_key(const std::string &sensor_key) { this->sensor_key_ = sensor_key; };
+  void set_sensor_target_device_type(uint8_t type) { this->sensor_target_device_type_ = static_cast<NodeType>(type); };
+  void set_control_command(uint16_t command) { this->control_command_ = static_cast<CommandType>(command); };
 
  protected:
   void write_state(bool state) override;
 
-  std::string switch_id_{""};
+  std::string sensor_key_{""};
+  NodeType sensor_target_device_type_{NodeType::ANY};
+  std::optional<CommandType> control_command_;
 };
 
 }  // namespace comfortnet
-}  // namespace esphome
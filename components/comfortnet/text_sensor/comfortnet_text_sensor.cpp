@@ -1,25 +1,30 @@
 #include "esphome/core/log.h"
 #include "comfortnet_text_sensor.h"
 
-namespace esphome {
 namespace comfortnet {
 
 static const char *const TAG = "comfortnet.text_sensor";
 
 void ComfortnetTextSensor::setup() {
-  this->parent_->register_listener(
-      this->sensor_id_, this->request_mod_, this->request_once_,
-      [this](const ComfortnetDatapoint &datapoint) {
-        ESP_LOGD(TAG, "MCU reported text sensor %s is: %s", this->sensor_id_.c_str(), datapoint.value_string.c_str());
-        this->publish_state(datapoint.value_string);
-      },
-      false, this->src_adr_);
+  this->parent_->register_catalog_polling(this->sensor_key_, this->sensor_target_device_type_);
+  this->parent_->register_listener(this->sensor_key_, [this](const ComfortnetData &datapoint) {
+    if (datapoint.device_type == this->sensor_target_device_type_ ||
+        this->sensor_target_device_type_ == NodeType::ANY) {
+      if (datapoint.type == ComfortnetData::DataType::STRING) {
+        ESP_LOGV(TAG, "Callback TextSensor: %s Device: 0x%02X Value: %s", this->sensor_key_.c_str(),
+                 datapoint.device_type, std::get<std::string>(datapoint.data).c_str());
+        this->publish_state(std::get<std::string>(datapoint.data));
+      } else {
+        ESP_LOGW(TAG, "Callback TextSensor: %s received wrong data type %u", this->sensor_key_.c_str(), datapoint.type);
+      }
+    }
+  });
 }
 
 void ComfortnetTextSensor::dump_config() {
-  ESP_LOGCONFIG(TAG, "ComfortNet Text Sensor:");
-  ESP_LOGCONFIG(TAG, "  Text Sensor has datapoint ID %s", this->sensor_id_.c_str());
+  LOG_TEXT_SENSOR("", "ComfortNet Text Sensor", this);
+  ESP_LOGCONFIG(TAG, "  Sensor Key: %s", this->sensor_key_.c_str());
+  ESP_LOGCONFIG(TAG, "  Target Device Type: %02x", this->sensor_target_device_type_);
 }
 
 }  // namespace comfortnet
-}  // namespace esphome
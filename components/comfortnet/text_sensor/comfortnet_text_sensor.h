@@ -4,18 +4,20 @@
 #include "esphome/components/text_sensor/text_sensor.h"
 #include "../comfortnet.h"
 
-namespace esphome {
 namespace comfortnet {
 
-class ComfortnetTextSensor : public text_sensor::TextSensor, public Component, public ComfortnetClient {
+class ComfortnetTextSensor : public esphome::text_sensor::TextSensor,
+                             public esphome::Component,
+                             public ComfortnetClient {
  public:
   void setup() override;
   void dump_config() override;
-  void set_sensor_id(const std::string &sensor_id) { this->sensor_id_ = sensor_id; }
+  void set_sensor_key(const std::string &sensor_key) { this->sensor_key_ = sensor_key; };
+  void set_sensor_target_device_type(uint8_t type) { this->sensor_target_device_type_ = static_cast<NodeType>(type); };
 
  protected:
-  std::string sensor_id_{""};
+  std::string sensor_key_{""};
+  NodeType sensor_target_device_type_{NodeType::ANY};
 };
 
 }  // namespace comfortnet
-}  // namespace esphome
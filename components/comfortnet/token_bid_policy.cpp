@@ -0,0 +1,81 @@
+#include <algorithm>
+#include "token_bid_policy.h"
+
+namespace comfortnet {
+
+static const uint8_t MAX_BID_CREDITS = 4;  // Most extra wins we may bank up for a burst
+static const uint8_t REBID_COST = 1;       // Credits spent by each win after the first in a cycle
+
+static const uint8_t URGENT_SCORE = 4;  // From here on, bid more than once per cycle
+static const uint8_t URGENT_PRIORITY_SCORE = 4;
+static const uint8_t NORMAL_PRIORITY_SCORE = 1;
+static const uint32_t AGE_SCORE_STEP = 1000;  // One point for each second the oldest message has waited
+static const uint8_t MAX_AGE_SCORE = 4;
+
+uint8_t TokenBidPolicy::score(const BidBacklog &backlog) {
+  if (backlog.pending_messages == 0) {
+    return 0;
+  }
+  uint8_t score = backlog.pending_messages - 1;
+  if (backlog.top_priority == MessagePriority::URGENT) {
+    score += URGENT_PRIORITY_SCORE;
+  } else if (backlog.top_priority == MessagePriority::NORMAL) {
+    score += NORMAL_PRIORITY_SCORE;
+  }
+  score += std::min<uint32_t>(backlog.oldest_age / AGE_SCORE_STEP, MAX_AGE_SCORE);
+  if (backlog.top_priority == MessagePriority::BACKGROUND) {
+    // However deep or old, background work alone never counts as urgent
+    score = std::min<uint8_t>(score, URGENT_SCORE - 1);
+  }
+  return score;
+}
+
+bool TokenBidPolicy::should_bid(const BidBacklog &backlog) {
+  if (backlog.pending_messages == 0 && !backlog.has_due_poll) {
+    return false;
+  }
+  // The first token of a cycle is free, only a burst beyond it spends credits
+  uint8_t cost = this->cycle_wins_ == 0 ? 0 : REBID_COST;
+  bool allowed = this->cycle_wins_ == 0 || (TokenBidPolicy::score(backlog) >= URGENT_SCORE && this->credits_ >= cost);
+  if (!allowed) {
+    this->deferred_count_++;
+    return false;
+  }
+  this->bid_outstanding_ = true;
+  this->bid_cost_ = cost;
+  this->bid_count_++;
+  return true;
+}
+
+void TokenBidPolicy::on_cycle() {
+  this->resolve_lost_();
+  this->cycle_wins_ = 0;
+  this->credits_ = std::min<uint8_t>(this->credits_ + 1, MAX_BID_CREDITS);
+}
+
+void TokenBidPolicy::on_offer() { this->resolve_lost_(); }
+
+void TokenBidPolicy::on_granted() {
+  if (!this->bid_outstanding_) {
+    return;
+  }
+  this->bid_outstanding_ = false;
+  this->credits_ -= std::min(this->bid_cost_, this->credits_);
+  this->cycle_wins_++;
+  this->win_count_++;
+}
+
+void TokenBidPolicy::reset() {
+  this->bid_outstanding_ = false;
+  this->cycle_wins_ = 0;
+  this->credits_ = 0;
+}
+
+void TokenBidPolicy::resolve_lost_() {
+  if (this->bid_outstanding_) {
+    this->bid_outstanding_ = false;
+    this->loss_count_++;
+  }
+}
+
+}  // namespace comfortnet
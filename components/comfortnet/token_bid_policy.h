@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cinttypes>
+
+namespace comfortnet {
+
+enum class MessagePriority : uint8_t {
+  BACKGROUND,  // Bulk transfers and the like, which can wait for a quiet moment
+  NORMAL,
+  URGENT,  // Commands a user is waiting on
+};
+
+/**
+ * What we have waiting to send when a token is offered
+ */
+struct BidBacklog {
+  uint8_t pending_messages{0};
+  MessagePriority top_priority{MessagePriority::BACKGROUND};  // Highest priority of the pending messages
+  uint32_t oldest_age{0};                                     // How long the oldest pending message has waited
+  bool has_due_poll{false};
+};
+
+/**
+ * Decides whether to bid on a token offer, based on how much and how important the work we have waiting is.
+ *
+ * The first bid of every dataflow cycle is open to any backlog, so polls keep the pace they were configured with.
+ * Winning again in the same cycle takes a backlog scoring as urgent, which background work alone never does, and
+ * spends a bid credit. Each cycle earns one credit, up to a small budget, so an urgent backlog drains in a burst while
+ * everything else takes at most one token per cycle.
+ */
+class TokenBidPolicy {
+ public:
+  /**
+   * Returns whether to bid on this token offer, and remembers the bid so its outcome can be recorded
+   */
+  bool should_bid(const BidBacklog &backlog);
+  /**
+   * A new dataflow cycle started
+   */
+  void on_cycle();
+  /**
+   * Another token offer went out, so any bid still waiting for a token was lost
+   */
+  void on_offer();
+  /**
+   * The coordinator handed us the token
+   */
+  void on_granted();
+  void reset();
+
+  inline uint8_t get_credits() const { return this->credits_; }
+  inline uint32_t get_bid_count() const { return this->bid_count_; }
+  inline uint32_t get_win_count() const { return this->win_count_; }
+  inline uint32_t get_loss_count() const { return this->loss_count_; }
+  inline uint32_t get_deferred_count() const { return this->deferred_count_; }
+
+  /**
+   * How pressing a backlog is, from its depth, priority and age
+   */
+  static uint8_t score(const BidBacklog &backlog);
+
+ protected:
+  void resolve_lost_();
+
+  uint8_t credits_{0};
+  uint8_t bid_cost_{0};         // Credits the outstanding bid will spend if it wins
+  bool bid_outstanding_{false};
+  uint8_t cycle_wins_{0};       // Tokens won in the current dataflow cycle
+
+  uint32_t bid_count_{0};
+  uint32_t win_count_{0};
+  uint32_t loss_count_{0};
+  uint32_t deferred_count_{0};  // Offers we had work for, but held back on to leave room for others
+};
+
+}  // namespace comfortnet
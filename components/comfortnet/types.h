@@ -4,6 +4,8 @@
 #include <vector>
 #ifdef ARDUINO
 #include <Arduino.h>
+#elif defined(USE_HOST)
+#include "esphome/core/helpers.h"
 #else
 #include "esp_random.h"
 #include "esp_mac.h"
@@ -11,6 +13,8 @@
 
 namespace comfortnet {
 
+class FrameBuilder;
+
 /**
  * Defined in ClimateTalk Alliance CT2.0 CT-485 Networking Specification Revision 01
  * 6.1 Node Address
@@ -192,6 +196,7 @@ enum class MessageType : uint8_t {
 #define PACKET_REQUEST(packet) static_cast<MessageType>(static_cast<uint8_t>(packet) & ~0x80)
 #define PACKET_NUMBER(isDataFlow, isVersion1) ((isDataFlow) ? 0x80 : 0x00) | ((isVersion1) ? 0x20 : 0x00)
 #define PACKET_IS_DATAFLOW(packetNumber) ((packetNumber & 0x80) > 0)
+#define PACKET_SEGMENT(packetNumber) ((packetNumber) & 0x1F)
 
 #define R2R_ACK 0x06
 #define R2R_NACK 0x15
@@ -296,13 +301,21 @@ enum class CommandType : uint16_t {
 
 struct MacAddress {
   uint8_t mac[MAC_ADDRESS_SIZE];
+  /**
+   * Generates a new MAC address, preferring the hardware MAC when one is available.
+   * Comfortnet persists whichever MAC is chosen, so this only runs on the very first boot.
+   */
   void setRandom() {
-    // TODO Random MACs are okay, but really should be persisted across restarts...
 #ifdef ARDUINO
     for (int i = 1; i < MAC_ADDRESS_SIZE; i++) {  // We don't need to set the first byte
       mac[i] = random(0x00, 0xFF);                // Just generate a random MAC for now...
     }
     mac[MAC_ADDRESS_RESERVED_POS] = 0xFF;  // Non-zero value flags a random MAC
+#elif defined(USE_HOST)
+    for (int i = 1; i < MAC_ADDRESS_SIZE; i++) {
+      mac[i] = esphome::random_uint32() & 0xFF;
+    }
+    mac[MAC_ADDRESS_RESERVED_POS] = 0xFF;  // Non-zero value flags a random MAC
 #else
     if (esp_mac_addr_len_get(esp_mac_type_t::ESP_MAC_IEEE802154) == 8) {
       esp_efuse_mac_get_default(mac);        // Copy hardware efuse MAC
@@ -319,7 +332,11 @@ struct MacAddress {
     }
 #endif
   }
-  void write(std::vector<uint8_t> &data) { data.insert(data.end(), mac, mac + MAC_ADDRESS_SIZE); };
+  /**
+   * Kept for lambdas written before FrameBuilder, new code should append to a FrameBuilder instead
+   */
+  void write(std::vector<uint8_t> &data) const { data.insert(data.end(), mac, mac + MAC_ADDRESS_SIZE); };
+  void write(FrameBuilder &builder) const;
 };
 
 #undef MAC_ADDRESS_RESERVED_POS
@@ -337,12 +354,18 @@ struct SessionId {
     for (int i = 0; i < SESSION_ID_SIZE; i++) {
 #ifdef ARDUINO
       sessionid[i] = random(0x00, 0xFF);
+#elif defined(USE_HOST)
+      sessionid[i] = esphome::random_uint32() & 0xFF;
 #else
       sessionid[i] = esp_random() & 0xFF;
 #endif
     }
   }
-  void write(std::vector<uint8_t> &data) { data.insert(data.end(), sessionid, sessionid + SESSION_ID_SIZE); };
+  /**
+   * Kept for lambdas written before FrameBuilder, new code should append to a FrameBuilder instead
+   */
+  void write(std::vector<uint8_t> &data) const { data.insert(data.end(), sessionid, sessionid + SESSION_ID_SIZE); };
+  void write(FrameBuilder &builder) const;
 };
 
 }  // namespace comfortnet
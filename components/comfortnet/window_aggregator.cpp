@@ -0,0 +1,40 @@
+#include <algorithm>
+#include "window_aggregator.h"
+
+namespace comfortnet {
+
+void WindowAggregator::add(float value) {
+  if (this->count_ == 0) {
+    this->min_ = value;
+    this->max_ = value;
+  } else {
+    this->min_ = std::min(this->min_, value);
+    this->max_ = std::max(this->max_, value);
+  }
+  this->sum_ += value;
+  this->count_++;
+}
+
+std::optional<float> WindowAggregator::close(AggregateType type) {
+  if (this->count_ == 0) {
+    return std::nullopt;
+  }
+  float result;
+  switch (type) {
+    case AggregateType::MIN:
+      result = this->min_;
+      break;
+    case AggregateType::MAX:
+      result = this->max_;
+      break;
+    case AggregateType::MEAN:
+    default:
+      result = this->sum_ / this->count_;
+      break;
+  }
+  this->sum_ = 0.0f;
+  this->count_ = 0;
+  return result;
+}
+
+}  // namespace comfortnet
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+
+namespace comfortnet {
+
+enum class AggregateType : uint8_t {
+  NONE,  // Publish every value as it arrives
+  MEAN,
+  MIN,
+  MAX,
+};
+
+/**
+ * Running statistics over one window of samples, in constant memory no matter how many samples arrive
+ */
+class WindowAggregator {
+ public:
+  void add(float value);
+  /**
+   * Returns the statistic over the window and starts a new one. Returns nullopt if no samples arrived.
+   */
+  std::optional<float> close(AggregateType type);
+  inline uint32_t get_count() const { return this->count_; }
+
+ protected:
+  float sum_{0.0f};
+  float min_{0.0f};
+  float max_{0.0f};
+  uint32_t count_{0};
+};
+
+}  // namespace comfortnet
@@ -0,0 +1,424 @@
+#include "fake_coordinator.h"
+#include <algorithm>
+#include <cstring>
+#include "simulation.h"
+
+namespace comfortnet {
+namespace testing {
+
+// Quiet time the coordinator leaves on the bus before each of its frames, in micros
+static const uint32_t COORDINATOR_GAP = 20000;
+// A partial frame is dropped after the line has been quiet this long, in micros
+static const uint32_t PARTIAL_FRAME_TIMEOUT = 5000;
+// Longer than the largest slot delay, plus a loop interval and the response's airtime
+static const uint32_t DISCOVERY_WINDOW = 3000;
+static const uint32_t TOKEN_OFFER_WINDOW = 3000;
+// SET_ADDRESS responses wait out the minimum slot delay
+static const uint32_t JOIN_TIMEOUT = 1000;
+// How long a member has to start answering once our frame is out
+static const uint32_t REPLY_TIMEOUT = 200;
+
+// First address handed out to members, stand-in appliances count down from the top
+static const uint8_t FIRST_MEMBER_ADDRESS = 0x01;
+static const uint8_t FIRST_DEVICE_ADDRESS = 0xF0;
+
+FakeCoordinator::FakeCoordinator(Simulation *simulation, SimulatedBus *bus)
+    : simulation_(simulation), bus_(bus), uart_(bus->add_endpoint()) {}
+
+uint32_t FakeCoordinator::now_() { return this->simulation_->millis(); }
+
+void FakeCoordinator::add_device(NodeType node_type, Responder responder) {
+  Device &device = this->devices_[node_type];
+  device.address = static_cast<NodeAddress>(FIRST_DEVICE_ADDRESS - (this->devices_.size() - 1));
+  device.responder = std::move(responder);
+}
+
+void FakeCoordinator::set_command_reply(NodeType node_type, CommandReply reply) {
+  auto it = this->devices_.find(node_type);
+  if (it == this->devices_.end()) {
+    this->add_device(node_type, nullptr);
+    it = this->devices_.find(node_type);
+  }
+  it->second.command_reply = reply;
+}
+
+void FakeCoordinator::forget_members() {
+  this->members_.clear();
+  this->join_queue_.clear();
+  this->granted_ = nullptr;
+  this->tx_queue_.clear();
+  this->state_ = State::IDLE;
+  this->next_cycle_ = this->now_();
+}
+
+void FakeCoordinator::set_ignore_probability(double probability, uint32_t seed) {
+  this->ignore_probability_ = probability;
+  this->random_state_ = seed == 0 ? 1 : seed;
+}
+
+const CoordinatorMember *FakeCoordinator::find_member(const MacAddress &mac_address) const {
+  for (const auto &member : this->members_) {
+    if (memcmp(member.mac_address.mac, mac_address.mac, MAC_ADDRESS_SIZE) == 0) {
+      return &member;
+    }
+  }
+  return nullptr;
+}
+
+CoordinatorMember *FakeCoordinator::find_member_(NodeAddress address) {
+  for (auto &member : this->members_) {
+    if (member.address == address) {
+      return &member;
+    }
+  }
+  return nullptr;
+}
+
+bool FakeCoordinator::ignore_() {
+  if (this->ignore_probability_ <= 0.0) {
+    return false;
+  }
+  uint32_t x = this->random_state_;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  this->random_state_ = x;
+  return x < this->ignore_probability_ * UINT32_MAX;
+}
+
+void FakeCoordinator::loop() {
+  this->read_();
+  if (this->silent_) {
+    this->tx_queue_.clear();
+    this->granted_ = nullptr;
+    this->state_ = State::IDLE;
+    this->next_cycle_ = this->now_();
+    return;
+  }
+
+  if (!this->tx_queue_.empty() && !this->bus_->is_busy() &&
+      this->simulation_->now() - this->bus_->get_idle_since() >= COORDINATOR_GAP) {
+    const Frame &frame = this->tx_queue_.front();
+    this->uart_->write_array(frame.data, frame.size);
+    this->tx_queue_.pop_front();
+  }
+  if (!this->tx_queue_.empty() || this->bus_->is_busy()) {
+    // Timeouts only start once our frames are out, and never cut off a frame on the wire
+    this->deadline_armed_ = false;
+    return;
+  }
+
+  uint32_t now = this->now_();
+  if (this->state_ == State::IDLE) {
+    if (static_cast<int32_t>(now - this->next_cycle_) >= 0) {
+      this->start_cycle_();
+    }
+    return;
+  }
+  if (!this->deadline_armed_) {
+    this->deadline_armed_ = true;
+    this->state_deadline_ = now + this->state_timeout_;
+  }
+  if (static_cast<int32_t>(now - this->state_deadline_) < 0) {
+    return;
+  }
+  switch (this->state_) {
+    case State::DISCOVERY:
+      this->next_join_();
+      break;
+    case State::JOINING:
+      this->join_queue_.erase(this->join_queue_.begin());
+      this->next_join_();
+      break;
+    case State::GRANTED:
+      this->granted_->missed_count++;
+      this->after_grant_();
+      break;
+    case State::ROUTING:
+      this->after_grant_();
+      break;
+    case State::TOKEN_OFFER:
+      this->finish_cycle_();
+      break;
+    case State::IDLE:
+      break;
+  }
+}
+
+void FakeCoordinator::wait_(State state, uint32_t timeout) {
+  this->state_ = state;
+  this->state_timeout_ = timeout;
+  this->deadline_armed_ = false;
+}
+
+void FakeCoordinator::read_() {
+  uint64_t now = this->simulation_->now();
+  int available = this->uart_->available();
+  if (available == 0 && !this->rx_frame_.empty() && now - this->last_rx_byte_ > PARTIAL_FRAME_TIMEOUT) {
+    this->bad_frame_count_++;
+    this->rx_frame_.clear();
+  }
+  while (available-- > 0) {
+    uint8_t byte;
+    this->uart_->read_array(&byte, 1);
+    this->last_rx_byte_ = now;
+    if (!this->rx_frame_.push_back(byte)) {
+      this->bad_frame_count_++;
+      this->rx_frame_.clear();
+      continue;
+    }
+    if (this->rx_frame_.is_complete()) {
+      const FrameView frame(this->rx_frame_);
+      if (frame.is_checksum_valid()) {
+        this->handle_frame_(frame);
+      } else {
+        this->bad_frame_count_++;
+      }
+      this->rx_frame_.clear();
+    }
+  }
+}
+
+void FakeCoordinator::handle_frame_(const FrameView &frame) {
+  if (this->silent_ || this->ignore_()) {
+    return;
+  }
+  const uint8_t *payload = frame.payload();
+  uint8_t len = frame.payload_length();
+  switch (this->state_) {
+    case State::DISCOVERY: {
+      if (frame.message_type() != MessageType::NODE_DISCOVERY_RESPONSE ||
+          len < 2 + MAC_ADDRESS_SIZE + SESSION_ID_SIZE) {
+        return;
+      }
+      MacAddress mac_address;
+      SessionId session_id;
+      memcpy(mac_address.mac, payload + 2, MAC_ADDRESS_SIZE);
+      memcpy(session_id.sessionid, payload + 2 + MAC_ADDRESS_SIZE, SESSION_ID_SIZE);
+      size_t index;
+      for (index = 0; index < this->members_.size(); index++) {
+        if (memcmp(this->members_[index].mac_address.mac, mac_address.mac, MAC_ADDRESS_SIZE) == 0) {
+          break;
+        }
+      }
+      if (index == this->members_.size()) {
+        uint8_t address = FIRST_MEMBER_ADDRESS;
+        while (this->find_member_(static_cast<NodeAddress>(address)) != nullptr) {
+          address++;
+        }
+        CoordinatorMember member;
+        member.address = static_cast<NodeAddress>(address);
+        member.mac_address = mac_address;
+        this->members_.push_back(member);
+      }
+      CoordinatorMember &member = this->members_[index];
+      member.node_type = static_cast<NodeType>(payload[0]);
+      member.session_id = session_id;
+      member.confirmed = false;
+      if (std::find(this->join_queue_.begin(), this->join_queue_.end(), index) == this->join_queue_.end()) {
+        this->join_queue_.push_back(index);
+      }
+      return;
+    }
+    case State::JOINING: {
+      CoordinatorMember &member = this->members_[this->join_queue_.front()];
+      if (frame.message_type() != MessageType::SET_ADDRESS_RESPONSE || len < 2 + MAC_ADDRESS_SIZE ||
+          memcmp(payload + 2, member.mac_address.mac, MAC_ADDRESS_SIZE) != 0) {
+        return;
+      }
+      member.confirmed = true;
+      this->join_queue_.erase(this->join_queue_.begin());
+      this->next_join_();
+      return;
+    }
+    case State::TOKEN_OFFER: {
+      if (frame.message_type() != MessageType::TOKEN_OFFER_RESPONSE || len < 1) {
+        return;
+      }
+      CoordinatorMember *member = this->find_member_(static_cast<NodeAddress>(payload[0]));
+      if (member != nullptr && member->confirmed) {
+        this->granted_by_offer_ = true;
+        this->grant_(member);
+      }
+      return;
+    }
+    case State::GRANTED:
+      if (frame.source() == this->granted_->address) {
+        this->handle_granted_reply_(frame);
+      }
+      return;
+    case State::ROUTING:
+      if (frame.source() == this->granted_->address && PACKET_IS_DATAFLOW(frame.packet_number())) {
+        this->after_grant_();  // The member ACKed the answer
+      }
+      return;
+    case State::IDLE:
+      return;
+  }
+}
+
+void FakeCoordinator::handle_granted_reply_(const FrameView &frame) {
+  MessageType message_type = frame.message_type();
+  if (message_type == MessageType::REQUEST_TO_RECEIVE_RESPONSE) {
+    this->after_grant_();  // Nothing to send
+    return;
+  }
+  NodeAddress member = this->granted_->address;
+  uint8_t send_param_1 = frame.send_param_1();
+  auto device = this->devices_.find(static_cast<NodeType>(send_param_1));
+  bool routable = frame.send_method() == SendMethod::NODE_TYPE && device != this->devices_.end();
+  const uint8_t ack = R2R_ACK;
+  const uint8_t nak = R2R_NACK;
+
+  if (message_type == MessageType::SET_CONTROL_COMMAND) {
+    this->command_count_++;
+    CommandReply reply = routable ? device->second.command_reply : CommandReply::SILENT;
+    if (reply == CommandReply::SILENT) {
+      this->after_grant_();
+      return;
+    }
+    this->send_(member, Subnet::VERSION_2, frame.send_method(), send_param_1, message_type, PACKET_NUMBER(false, false),
+                reply == CommandReply::ACK ? &ack : &nak, 1);
+    if (reply == CommandReply::NAK) {
+      this->after_grant_();
+      return;
+    }
+    // The appliance echoes the command type back
+    this->send_(member, Subnet::VERSION_2, SendMethod::NODE_TYPE, send_param_1,
+                MessageType::SET_CONTROL_COMMAND_RESPONSE, PACKET_NUMBER(false, false), frame.payload(),
+                std::min<uint8_t>(frame.payload_length(), 2), device->second.address, device->first);
+    this->wait_(State::ROUTING, REPLY_TIMEOUT);
+    return;
+  }
+
+  if (!routable || device->second.responder == nullptr) {
+    this->send_(member, Subnet::VERSION_2, frame.send_method(), send_param_1, message_type, PACKET_NUMBER(false, false),
+                &nak, 1);
+    this->after_grant_();
+    return;
+  }
+  this->send_(member, Subnet::VERSION_2, frame.send_method(), send_param_1, message_type, PACKET_NUMBER(false, false),
+              &ack, 1);
+  if (frame.payload_length() == MAX_PAYLOAD_SIZE) {
+    this->after_grant_();  // A full frame means more segments follow, and only the last one is answered
+    return;
+  }
+  this->routed_counts_[message_type]++;
+  if (this->lost_responses_ > 0) {
+    this->lost_responses_--;
+    this->after_grant_();
+    return;
+  }
+  std::vector<uint8_t> response = device->second.responder(message_type, frame.payload(), frame.payload_length());
+  this->send_(member, Subnet::VERSION_2, SendMethod::NODE_TYPE, send_param_1, PACKET_RESPONSE(message_type),
+              PACKET_NUMBER(false, false), response.data(), response.size(), device->second.address, device->first);
+  this->wait_(State::ROUTING, REPLY_TIMEOUT);
+}
+
+void FakeCoordinator::start_cycle_() {
+  this->cycle_count_++;
+  this->cycle_start_ = this->now_();
+  if (this->discovery_every_ != 0 && (this->cycle_count_ - 1) % this->discovery_every_ == 0) {
+    const uint8_t any = static_cast<uint8_t>(NodeType::ANY);
+    this->send_(NodeAddress::BROADCAST, Subnet::BROADCAST, SendMethod::NO_ROUTE, 0, MessageType::NODE_DISCOVERY,
+                PACKET_NUMBER(false, false), &any, 1);
+    this->wait_(State::DISCOVERY, DISCOVERY_WINDOW);
+    return;
+  }
+  this->next_join_();
+}
+
+void FakeCoordinator::next_join_() {
+  if (this->join_queue_.empty()) {
+    if (this->confirming_) {
+      this->send_node_list_();
+    }
+    this->token_index_ = 0;
+    this->granted_by_offer_ = false;
+    this->next_token_();
+    return;
+  }
+  const CoordinatorMember &member = this->members_[this->join_queue_.front()];
+  uint8_t payload[2 + MAC_ADDRESS_SIZE + SESSION_ID_SIZE + 1];
+  payload[0] = static_cast<uint8_t>(member.address);
+  payload[1] = static_cast<uint8_t>(Subnet::VERSION_2);
+  memcpy(payload + 2, member.mac_address.mac, MAC_ADDRESS_SIZE);
+  memcpy(payload + 2 + MAC_ADDRESS_SIZE, member.session_id.sessionid, SESSION_ID_SIZE);
+  payload[2 + MAC_ADDRESS_SIZE + SESSION_ID_SIZE] = 0x01;
+  this->send_(NodeAddress::BROADCAST, Subnet::BROADCAST, SendMethod::NO_ROUTE, 0, MessageType::SET_ADDRESS,
+              PACKET_NUMBER(false, false), payload, sizeof(payload));
+  this->wait_(State::JOINING, JOIN_TIMEOUT);
+}
+
+void FakeCoordinator::send_node_list_() {
+  uint8_t payload[MAX_PAYLOAD_SIZE]{};
+  uint8_t len = 1;
+  for (const auto &member : this->members_) {
+    uint8_t address = static_cast<uint8_t>(member.address);
+    if (member.confirmed && address < MAX_PAYLOAD_SIZE) {
+      payload[address] = static_cast<uint8_t>(member.node_type);
+      len = std::max<uint8_t>(len, address + 1);
+    }
+  }
+  this->send_(NodeAddress::BROADCAST, Subnet::VERSION_2, SendMethod::NO_ROUTE, 0, MessageType::ADDRESS_CONFIRMATION,
+              PACKET_NUMBER(false, false), payload, len);
+}
+
+void FakeCoordinator::next_token_() {
+  while (this->token_index_ < this->members_.size()) {
+    CoordinatorMember &member = this->members_[this->token_index_++];
+    if (member.confirmed) {
+      this->grant_(&member);
+      return;
+    }
+  }
+  if (!this->token_offers_) {
+    this->finish_cycle_();
+    return;
+  }
+  const uint8_t any = static_cast<uint8_t>(NodeType::ANY);
+  this->granted_ = nullptr;
+  this->send_(NodeAddress::BROADCAST, Subnet::VERSION_2, SendMethod::NO_ROUTE, 0, MessageType::TOKEN_OFFER,
+              PACKET_NUMBER(false, false), &any, 1);
+  this->wait_(State::TOKEN_OFFER, TOKEN_OFFER_WINDOW);
+}
+
+void FakeCoordinator::grant_(CoordinatorMember *member) {
+  this->granted_ = member;
+  member->r2r_count++;
+  this->send_(member->address, Subnet::VERSION_2, SendMethod::NO_ROUTE, 0, MessageType::REQUEST_TO_RECEIVE_RESPONSE,
+              PACKET_NUMBER(true, false), nullptr, 0);
+  this->wait_(State::GRANTED, REPLY_TIMEOUT);
+}
+
+void FakeCoordinator::after_grant_() {
+  this->granted_ = nullptr;
+  if (this->granted_by_offer_) {
+    this->finish_cycle_();
+  } else {
+    this->next_token_();
+  }
+}
+
+void FakeCoordinator::finish_cycle_() {
+  this->state_ = State::IDLE;
+  this->granted_ = nullptr;
+  uint32_t now = this->now_();
+  this->next_cycle_ = this->cycle_start_ + this->cycle_period_;
+  if (static_cast<int32_t>(this->next_cycle_ - now) < 0) {
+    this->next_cycle_ = now;
+  }
+}
+
+void FakeCoordinator::send_(NodeAddress dst_adr, Subnet subnet, SendMethod send_method, uint8_t send_param_1,
+                            MessageType msg_type, uint8_t packet_number, const uint8_t *payload, uint8_t len,
+                            NodeAddress src_adr, NodeType src_type) {
+  this->tx_queue_.emplace_back();
+  FrameBuilder(this->tx_queue_.back())
+      .header(dst_adr, src_adr, subnet, send_method, send_param_1, 0, src_type, msg_type, packet_number)
+      .append(payload, len)
+      .finish();
+}
+
+}  // namespace testing
+}  // namespace comfortnet
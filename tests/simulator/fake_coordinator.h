@@ -0,0 +1,178 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <vector>
+#include "frame.h"
+#include "simulated_bus.h"
+
+namespace comfortnet {
+namespace testing {
+
+class Simulation;
+
+/**
+ * A node the coordinator has handed an address to
+ */
+struct CoordinatorMember {
+  NodeAddress address;
+  NodeType node_type;
+  MacAddress mac_address;
+  SessionId session_id;
+  bool confirmed{false};  // Answered SET_ADDRESS, so it is listed in address confirmations
+  uint32_t r2r_count{0};
+  uint32_t missed_count{0};  // R2Rs that got no answer
+};
+
+/**
+ * How a stand-in appliance answers control commands routed to it
+ */
+enum class CommandReply : uint8_t {
+  ACK,
+  NAK,
+  SILENT,  // Never answers, like a node type that isn't on the bus
+};
+
+/**
+ * Scripted CT-485 network coordinator with stand-ins for the appliances behind it.
+ *
+ * Every cycle it optionally runs node discovery and hands out addresses, confirms addresses, gives each member the
+ * token with a R2R, then offers the token to whoever bids for it. Requests a member sends are ACKed and answered by the
+ * stand-in appliance of the requested node type. Faults can be switched on at any time to exercise timeouts and
+ * rejoins.
+ */
+class FakeCoordinator {
+ public:
+  using Responder = std::function<std::vector<uint8_t>(MessageType request, const uint8_t *payload, uint8_t len)>;
+
+  FakeCoordinator(Simulation *simulation, SimulatedBus *bus);
+
+  void loop();
+
+  inline void set_cycle_period(uint32_t cycle_period) { this->cycle_period_ = cycle_period; }
+  /**
+   * Runs node discovery on every nth cycle, 0 to never run it
+   */
+  inline void set_discovery_every(uint32_t discovery_every) { this->discovery_every_ = discovery_every; }
+  inline void set_token_offers(bool token_offers) { this->token_offers_ = token_offers; }
+  /**
+   * Adds an appliance of the given type that answers requests routed to it
+   */
+  void add_device(NodeType node_type, Responder responder);
+  void set_command_reply(NodeType node_type, CommandReply reply);
+
+  /**
+   * Stops transmitting altogether, like a coordinator that lost power
+   */
+  inline void set_silent(bool silent) { this->silent_ = silent; }
+  /**
+   * Keeps the bus busy but stops sending address confirmations
+   */
+  inline void set_confirming(bool confirming) { this->confirming_ = confirming; }
+  /**
+   * Forgets every address it handed out, like a coordinator that rebooted
+   */
+  void forget_members();
+  /**
+   * Ignores frames from members with the given probability, drawn from its own seeded sequence
+   */
+  void set_ignore_probability(double probability, uint32_t seed);
+  /**
+   * Loses the next count answers from the stand-in appliances, as if they never made it onto the bus
+   */
+  inline void set_lost_responses(uint32_t count) { this->lost_responses_ = count; }
+
+  inline const std::vector<CoordinatorMember> &get_members() const { return this->members_; }
+  const CoordinatorMember *find_member(const MacAddress &mac_address) const;
+  inline uint32_t get_cycle_count() const { return this->cycle_count_; }
+  inline uint32_t get_bad_frame_count() const { return this->bad_frame_count_; }
+  /**
+   * Requests routed to the stand-in appliances, by message type
+   */
+  inline uint32_t get_routed_count(MessageType message_type) const {
+    auto it = this->routed_counts_.find(message_type);
+    return it == this->routed_counts_.end() ? 0 : it->second;
+  }
+  inline uint32_t get_command_count() const { return this->command_count_; }
+
+ protected:
+  enum class State : uint8_t {
+    IDLE,
+    DISCOVERY,
+    JOINING,
+    TOKEN_OFFER,
+    GRANTED,  // Waiting for the member holding the token
+    ROUTING,  // Waiting for the member to ACK an appliance's answer
+  };
+
+  struct Device {
+    NodeAddress address;
+    Responder responder;
+    CommandReply command_reply{CommandReply::ACK};
+  };
+
+  void read_();
+  void handle_frame_(const FrameView &frame);
+  void handle_granted_reply_(const FrameView &frame);
+  void start_cycle_();
+  void next_join_();
+  void next_token_();
+  void grant_(CoordinatorMember *member);
+  /**
+   * Moves on once the member granted the token is done with it
+   */
+  void after_grant_();
+  void finish_cycle_();
+  /**
+   * Enters a state that times out once our frames are out and the bus has been quiet for the given time
+   */
+  void wait_(State state, uint32_t timeout);
+  /**
+   * Queues a frame from the coordinator, or from a stand-in appliance when src_adr and src_type say so
+   */
+  void send_(NodeAddress dst_adr, Subnet subnet, SendMethod send_method, uint8_t send_param_1, MessageType msg_type,
+             uint8_t packet_number, const uint8_t *payload, uint8_t len, NodeAddress src_adr = NodeAddress::COORDINATOR,
+             NodeType src_type = NodeType::NETWORK_COORDINATOR);
+  void send_node_list_();
+  uint32_t now_();
+  bool ignore_();
+  CoordinatorMember *find_member_(NodeAddress address);
+
+  Simulation *simulation_;
+  SimulatedBus *bus_;
+  SimulatedUART *uart_;
+  Frame rx_frame_;
+  uint64_t last_rx_byte_{0};
+  std::deque<Frame> tx_queue_;
+
+  State state_{State::IDLE};
+  uint32_t state_timeout_{0};
+  uint32_t state_deadline_{0};
+  bool deadline_armed_{false};
+  uint32_t next_cycle_{0};
+  uint32_t cycle_start_{0};
+  uint32_t cycle_count_{0};
+  uint32_t cycle_period_{5000};
+  uint32_t discovery_every_{1};
+  bool token_offers_{true};
+  bool silent_{false};
+  bool confirming_{true};
+  double ignore_probability_{0.0};
+  uint32_t lost_responses_{0};
+  uint32_t random_state_{1};
+
+  std::vector<CoordinatorMember> members_;
+  std::vector<size_t> join_queue_;  // Members that answered discovery and are waiting for SET_ADDRESS
+  size_t token_index_{0};
+  CoordinatorMember *granted_{nullptr};
+  bool granted_by_offer_{false};
+  std::map<NodeType, Device> devices_;
+  std::map<MessageType, uint32_t> routed_counts_;
+  uint32_t command_count_{0};
+  uint32_t bad_frame_count_{0};
+};
+
+}  // namespace testing
+}  // namespace comfortnet
@@ -0,0 +1,123 @@
+#include "simulated_bus.h"
+#include "simulation.h"
+
+namespace comfortnet {
+namespace testing {
+
+void SimulatedUART::write_array(const uint8_t *data, size_t len) { this->bus_->transmit_(this, data, len); }
+
+int SimulatedUART::available() {
+  uint64_t now = this->bus_->now_();
+  int count = 0;
+  for (const auto &byte : this->rx_) {
+    if (byte.arrival > now) {
+      break;
+    }
+    count++;
+  }
+  return count;
+}
+
+bool SimulatedUART::read_array(uint8_t *data, size_t len) {
+  if (this->available() < static_cast<int>(len)) {
+    return false;
+  }
+  for (size_t i = 0; i < len; i++) {
+    data[i] = this->rx_.front().value;
+    this->rx_.pop_front();
+  }
+  return true;
+}
+
+SimulatedBus::SimulatedBus(Simulation *simulation, uint32_t baud_rate)
+    : simulation_(simulation), baud_rate_(baud_rate), byte_time_(10 * 1000000 / baud_rate) {}
+
+SimulatedUART *SimulatedBus::add_endpoint() {
+  this->endpoints_.push_back(std::make_unique<SimulatedUART>(this, this->endpoints_.size()));
+  SimulatedUART *uart = this->endpoints_.back().get();
+  uart->set_baud_rate(this->baud_rate_);
+  return uart;
+}
+
+uint64_t SimulatedBus::now_() const { return this->simulation_->now(); }
+
+bool SimulatedBus::is_busy() const { return this->busy_until_ > this->now_(); }
+
+void SimulatedBus::set_corruption(double probability, uint32_t seed) {
+  this->corruption_ = probability;
+  this->random_state_ = seed == 0 ? 1 : seed;
+}
+
+uint32_t SimulatedBus::next_random_() {
+  uint32_t x = this->random_state_;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  this->random_state_ = x;
+  return x;
+}
+
+void SimulatedBus::transmit_(SimulatedUART *from, const uint8_t *data, size_t len) {
+  if (len == 0) {
+    return;
+  }
+  uint64_t now = this->now_();
+  BusFrame frame;
+  frame.sender = from->get_id();
+  frame.start = now;
+  frame.end = now + static_cast<uint64_t>(len) * this->byte_time_;
+  frame.idle_before = now > this->busy_until_ ? now - this->busy_until_ : 0;
+  frame.data.assign(data, data + len);
+
+  // Anything still on the wire is garbled along with this frame
+  for (auto &other : this->in_flight_) {
+    if (other.end > now && !other.collided) {
+      other.collided = true;
+      frame.collided = true;
+      this->collision_count_++;
+    } else if (other.end > now) {
+      frame.collided = true;
+    }
+  }
+
+  std::vector<uint8_t> wire = frame.data;
+  if (this->corruption_ > 0.0 && this->next_random_() < this->corruption_ * UINT32_MAX) {
+    wire[this->next_random_() % wire.size()] ^= 1 << (this->next_random_() % 8);
+    this->corrupted_count_++;
+  }
+  for (auto &endpoint : this->endpoints_) {
+    if (endpoint.get() == from) {
+      continue;
+    }
+    for (size_t i = 0; i < len; i++) {
+      endpoint->rx_.push_back({now + (i + 1) * this->byte_time_, wire[i]});
+    }
+  }
+  if (frame.collided) {
+    // Receivers can't make sense of overlapping frames, so garble whatever they haven't read yet
+    for (auto &endpoint : this->endpoints_) {
+      for (auto &byte : endpoint->rx_) {
+        if (byte.arrival > now) {
+          byte.value ^= 0x5A;
+        }
+      }
+    }
+  }
+  this->busy_until_ = std::max(this->busy_until_, frame.end);
+  this->frame_count_++;
+  this->in_flight_.push_back(std::move(frame));
+}
+
+void SimulatedBus::poll() {
+  uint64_t now = this->now_();
+  while (!this->in_flight_.empty() && this->in_flight_.front().end <= now) {
+    BusFrame frame = std::move(this->in_flight_.front());
+    this->in_flight_.pop_front();
+    if (this->observer_) {
+      this->observer_(frame);
+    }
+  }
+}
+
+}  // namespace testing
+}  // namespace comfortnet
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <vector>
+#include "esphome/components/uart/uart.h"
+
+namespace comfortnet {
+namespace testing {
+
+class Simulation;
+class SimulatedBus;
+
+/**
+ * A frame as it went over the wire
+ */
+struct BusFrame {
+  uint8_t sender;                // Endpoint that wrote it
+  uint64_t start;                // When its first bit went out, in simulation micros
+  uint64_t end;                  // When its last byte arrived at the other endpoints
+  uint64_t idle_before;          // How long the line was quiet before it, in micros
+  bool collided{false};          // Overlapped another transmission, so every receiver saw garbage
+  std::vector<uint8_t> data;
+};
+
+/**
+ * One transceiver on the bus, seen by its owner as a UART
+ */
+class SimulatedUART : public esphome::uart::UARTComponent {
+ public:
+  SimulatedUART(SimulatedBus *bus, uint8_t id) : bus_(bus), id_(id) {}
+
+  void write_array(const uint8_t *data, size_t len) override;
+  bool read_array(uint8_t *data, size_t len) override;
+  int available() override;
+  void flush() override {}
+
+  inline uint8_t get_id() const { return this->id_; }
+
+ protected:
+  friend class SimulatedBus;
+
+  struct PendingByte {
+    uint64_t arrival;
+    uint8_t value;
+  };
+
+  SimulatedBus *bus_;
+  uint8_t id_;
+  std::deque<PendingByte> rx_;
+};
+
+/**
+ * Half duplex RS-485 line shared by every endpoint.
+ *
+ * A write goes out one byte time after another and reaches every other endpoint, but not the writer, like a
+ * transceiver with its receiver disabled while driving the line. Transmissions that overlap garble each other.
+ */
+class SimulatedBus {
+ public:
+  SimulatedBus(Simulation *simulation, uint32_t baud_rate = 9600);
+
+  SimulatedUART *add_endpoint();
+
+  /**
+   * Micros per byte on the wire, with a start and stop bit
+   */
+  inline uint32_t byte_time() const { return this->byte_time_; }
+  inline uint32_t get_baud_rate() const { return this->baud_rate_; }
+  /**
+   * Whether any byte is still on its way to a receiver
+   */
+  bool is_busy() const;
+  /**
+   * When the line last went quiet, in simulation micros
+   */
+  inline uint64_t get_idle_since() const { return this->busy_until_; }
+
+  /**
+   * Flips one bit in each frame with the given probability, drawn from its own seeded sequence
+   */
+  void set_corruption(double probability, uint32_t seed);
+  /**
+   * Called with every frame once its last byte has arrived
+   */
+  void set_frame_observer(std::function<void(const BusFrame &)> &&observer) { this->observer_ = std::move(observer); }
+
+  inline uint32_t get_frame_count() const { return this->frame_count_; }
+  inline uint32_t get_collision_count() const { return this->collision_count_; }
+  inline uint32_t get_corrupted_count() const { return this->corrupted_count_; }
+
+  /**
+   * Hands completed frames to the observer
+   */
+  void poll();
+
+ protected:
+  friend class SimulatedUART;
+
+  void transmit_(SimulatedUART *from, const uint8_t *data, size_t len);
+  uint64_t now_() const;
+  uint32_t next_random_();
+
+  Simulation *simulation_;
+  uint32_t baud_rate_;
+  uint32_t byte_time_;
+  std::vector<std::unique_ptr<SimulatedUART>> endpoints_;
+  uint64_t busy_until_{0};
+  std::deque<BusFrame> in_flight_;
+  std::function<void(const BusFrame &)> observer_;
+
+  double corruption_{0.0};
+  uint32_t random_state_{1};
+
+  uint32_t frame_count_{0};
+  uint32_t collision_count_{0};
+  uint32_t corrupted_count_{0};
+};
+
+}  // namespace testing
+}  // namespace comfortnet
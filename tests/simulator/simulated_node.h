@@ -0,0 +1,78 @@
+#pragma once
+
+#include <memory>
+#include "comfortnet.h"
+#include "simulation.h"
+
+namespace comfortnet {
+namespace testing {
+
+/**
+ * A Comfortnet instance on a simulated bus, that can be rebooted without losing what it saved to flash
+ */
+class SimulatedNode {
+ public:
+  SimulatedNode(Simulation *simulation, SimulatedBus *bus, uint32_t preference_salt = 0)
+      : simulation_(simulation), uart_(bus->add_endpoint()), preference_salt_(preference_salt) {}
+
+  /**
+   * Builds and sets up a fresh Comfortnet, replacing the running one if there is one
+   */
+  void boot() {
+    auto comfortnet = std::make_unique<Comfortnet>();
+    comfortnet->set_uart_parent(this->uart_);
+    comfortnet->set_clock(this->simulation_->get_clock());
+    comfortnet->set_preference_salt(this->preference_salt_);
+    comfortnet->register_listener("NETWORK_STATUS", [this](const ComfortnetData &data) {
+      bool joined = std::get<bool>(data.data);
+      if (joined && !this->joined_) {
+        this->join_count_++;
+      } else if (!joined && this->joined_) {
+        this->drop_count_++;
+      }
+      this->joined_ = joined;
+    });
+    if (this->configure_) {
+      this->configure_(comfortnet.get());
+    }
+    comfortnet->setup();
+    // A resumed identity only reports in once the coordinator confirms it
+    this->joined_ = false;
+    if (this->comfortnet_ == nullptr) {
+      this->simulation_->add_component(comfortnet.get());
+    } else {
+      this->simulation_->replace_component(this->comfortnet_.get(), comfortnet.get());
+    }
+    this->comfortnet_ = std::move(comfortnet);
+    this->boot_count_++;
+  }
+
+  /**
+   * Applied to every new Comfortnet before setup(), e.g. to register polling
+   */
+  inline void set_configure(std::function<void(Comfortnet *)> &&configure) { this->configure_ = std::move(configure); }
+
+  inline Comfortnet *get() { return this->comfortnet_.get(); }
+  inline SimulatedUART *get_uart() { return this->uart_; }
+  /**
+   * Whether the node last reported itself as a network member
+   */
+  inline bool is_joined() const { return this->joined_; }
+  inline uint32_t get_join_count() const { return this->join_count_; }
+  inline uint32_t get_drop_count() const { return this->drop_count_; }
+  inline uint32_t get_boot_count() const { return this->boot_count_; }
+
+ protected:
+  Simulation *simulation_;
+  SimulatedUART *uart_;
+  uint32_t preference_salt_;
+  std::function<void(Comfortnet *)> configure_;
+  std::unique_ptr<Comfortnet> comfortnet_;
+  bool joined_{false};
+  uint32_t join_count_{0};
+  uint32_t drop_count_{0};
+  uint32_t boot_count_{0};
+};
+
+}  // namespace testing
+}  // namespace comfortnet
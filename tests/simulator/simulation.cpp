@@ -0,0 +1,66 @@
+#include "simulation.h"
+#include <algorithm>
+
+namespace comfortnet {
+namespace testing {
+
+Simulation::Simulation(uint32_t seed) : clock_(seed) { esphome::random_seed(seed); }
+
+SimulatedBus *Simulation::add_bus(uint32_t baud_rate) {
+  this->buses_.push_back(std::make_unique<SimulatedBus>(this, baud_rate));
+  return this->buses_.back().get();
+}
+
+void Simulation::replace_component(esphome::Component *old_component, esphome::Component *new_component) {
+  std::replace(this->components_.begin(), this->components_.end(), old_component, new_component);
+}
+
+void Simulation::run_for(uint32_t ms) {
+  uint64_t end = this->now_ + static_cast<uint64_t>(ms) * 1000;
+  while (this->now_ < end) {
+    this->step_();
+  }
+}
+
+bool Simulation::run_until(const std::function<bool()> &condition, uint32_t timeout_ms) {
+  uint64_t end = this->now_ + static_cast<uint64_t>(timeout_ms) * 1000;
+  while (!condition()) {
+    if (this->now_ >= end) {
+      return false;
+    }
+    this->step_();
+  }
+  return true;
+}
+
+void Simulation::step_() {
+  if (this->now_ >= this->next_loop_) {
+    uint64_t start = this->now_;
+    for (auto *component : this->components_) {
+      component->loop();
+      this->advance_(this->loop_cost_);
+    }
+    this->loop_count_++;
+    uint64_t interval = esphome::HighFrequencyLoopRequester::is_high_frequency()
+                            ? HIGH_FREQUENCY_LOOP_INTERVAL
+                            : static_cast<uint64_t>(this->loop_interval_) * 1000;
+    this->next_loop_ = std::max(start + interval, this->now_);
+  }
+  for (auto &bus : this->buses_) {
+    bus->poll();
+  }
+  for (auto &peer : this->peers_) {
+    peer();
+  }
+  uint64_t next_tick = (this->now_ / SIMULATION_TICK + 1) * SIMULATION_TICK;
+  uint64_t next = std::min(next_tick, std::max(this->next_loop_, this->now_ + 1));
+  this->advance_(next - this->now_);
+}
+
+void Simulation::advance_(uint64_t micros) {
+  this->now_ += micros;
+  this->clock_.advance_micros(micros);
+}
+
+}  // namespace testing
+}  // namespace comfortnet
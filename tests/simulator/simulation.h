@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+#include "esphome/core/component.h"
+#include "clock.h"
+#include "simulated_bus.h"
+
+namespace comfortnet {
+namespace testing {
+
+// ESPHome's default pause between main loop iterations while no component asks for a high frequency loop
+static const uint32_t DEFAULT_LOOP_INTERVAL = 16;
+// Pause between iterations while a component asks for a high frequency loop, in micros
+static const uint32_t HIGH_FREQUENCY_LOOP_INTERVAL = 100;
+// Resolution of the bus and of everything that isn't a component, in micros
+static const uint32_t SIMULATION_TICK = 1000;
+
+/**
+ * Runs a firmware main loop and the rest of the bus against one VirtualClock.
+ *
+ * Components are looped like ESPHome's application loop, in order, every loop interval or back to back while a
+ * high frequency loop is requested. Each call can be charged a fixed cost, so several buses in one firmware contend for
+ * the main loop the way they would on a single core. Peers, such as a coordinator on the other end of a bus, are
+ * looped every tick regardless.
+ */
+class Simulation {
+ public:
+  /**
+   * The seed drives the clock's slot delays, and the MACs and session IDs drawn from random_uint32()
+   */
+  explicit Simulation(uint32_t seed = 1);
+
+  inline VirtualClock *get_clock() { return &this->clock_; }
+  /**
+   * Time since the simulation started, in micros. Unlike the clock, this never wraps.
+   */
+  inline uint64_t now() const { return this->now_; }
+  inline uint32_t millis() { return this->clock_.millis(); }
+
+  SimulatedBus *add_bus(uint32_t baud_rate = 9600);
+  inline void add_component(esphome::Component *component) { this->components_.push_back(component); }
+  /**
+   * Swaps a component for another in the same place in the loop, e.g. to reboot a node
+   */
+  void replace_component(esphome::Component *old_component, esphome::Component *new_component);
+  inline void add_peer(std::function<void()> &&loop) { this->peers_.push_back(std::move(loop)); }
+
+  inline void set_loop_interval(uint32_t loop_interval) { this->loop_interval_ = loop_interval; }
+  /**
+   * Time charged to the clock for every component loop() call, in micros
+   */
+  inline void set_loop_cost(uint32_t loop_cost) { this->loop_cost_ = loop_cost; }
+  inline uint32_t get_loop_count() const { return this->loop_count_; }
+
+  void run_for(uint32_t ms);
+  /**
+   * Runs until the condition holds, returning false if it didn't within the timeout
+   */
+  bool run_until(const std::function<bool()> &condition, uint32_t timeout_ms);
+
+ protected:
+  void step_();
+  void advance_(uint64_t micros);
+
+  VirtualClock clock_;
+  uint64_t now_{0};
+  uint64_t next_loop_{0};
+  uint32_t loop_interval_{DEFAULT_LOOP_INTERVAL};
+  uint32_t loop_cost_{0};
+  uint32_t loop_count_{0};
+  std::vector<std::unique_ptr<SimulatedBus>> buses_;
+  std::vector<esphome::Component *> components_;
+  std::vector<std::function<void()>> peers_;
+};
+
+}  // namespace testing
+}  // namespace comfortnet
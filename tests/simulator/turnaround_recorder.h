@@ -0,0 +1,96 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include "frame.h"
+#include "simulated_bus.h"
+
+namespace comfortnet {
+namespace testing {
+
+/**
+ * Watches a bus for frames that one endpoint answers, R2Rs unless told otherwise, and records how long the line stayed
+ * quiet before its answer.
+ *
+ * Takes over the bus's frame observer.
+ */
+class TurnaroundRecorder {
+ public:
+  using Trigger = std::function<bool(const FrameView &)>;
+
+  TurnaroundRecorder(SimulatedBus *bus, const SimulatedUART *node, Trigger trigger = is_r2r)
+      : node_id_(node->get_id()), trigger_(std::move(trigger)) {
+    bus->set_frame_observer([this](const BusFrame &frame) { this->observe_(frame); });
+  }
+
+  static bool is_r2r(const FrameView &frame) {
+    return frame.message_type() == MessageType::REQUEST_TO_RECEIVE_RESPONSE &&
+           PACKET_IS_DATAFLOW(frame.packet_number());
+  }
+  static Trigger is_message(MessageType message_type) {
+    return [message_type](const FrameView &frame) { return frame.message_type() == message_type; };
+  }
+
+  /**
+   * Each turnaround seen so far, in micros
+   */
+  inline const std::vector<uint64_t> &get_samples() const { return this->samples_; }
+  inline size_t size() const { return this->samples_.size(); }
+  inline void clear() { this->samples_.clear(); }
+
+  uint64_t min() const {
+    return this->samples_.empty() ? 0 : *std::min_element(this->samples_.begin(), this->samples_.end());
+  }
+  uint64_t max() const {
+    return this->samples_.empty() ? 0 : *std::max_element(this->samples_.begin(), this->samples_.end());
+  }
+  double mean() const {
+    if (this->samples_.empty()) {
+      return 0.0;
+    }
+    double total = 0.0;
+    for (uint64_t sample : this->samples_) {
+      total += sample;
+    }
+    return total / this->samples_.size();
+  }
+  /**
+   * Nearest rank percentile, with fraction from 0 to 1
+   */
+  uint64_t percentile(double fraction) const {
+    if (this->samples_.empty()) {
+      return 0;
+    }
+    std::vector<uint64_t> sorted = this->samples_;
+    std::sort(sorted.begin(), sorted.end());
+    size_t rank = std::min(sorted.size() - 1, static_cast<size_t>(fraction * sorted.size()));
+    return sorted[rank];
+  }
+
+ protected:
+  void observe_(const BusFrame &frame) {
+    if (frame.collided || frame.data.size() < PACKET_HEADER_SIZE) {
+      this->awaiting_reply_ = false;
+      return;
+    }
+    const FrameView view(frame.data.data());
+    if (frame.sender == this->node_id_) {
+      if (this->awaiting_reply_) {
+        this->samples_.push_back(frame.idle_before);
+      }
+      this->awaiting_reply_ = false;
+      return;
+    }
+    this->awaiting_reply_ = this->trigger_(view);
+  }
+
+  uint8_t node_id_;
+  Trigger trigger_;
+  bool awaiting_reply_{false};
+  std::vector<uint64_t> samples_;
+};
+
+}  // namespace testing
+}  // namespace comfortnet
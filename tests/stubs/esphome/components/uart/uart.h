@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace esphome {
+namespace uart {
+
+enum UARTParityOptions {
+  UART_CONFIG_PARITY_NONE,
+  UART_CONFIG_PARITY_EVEN,
+  UART_CONFIG_PARITY_ODD,
+};
+
+/**
+ * A UART bus. The test harness implements it on top of a simulated CT-485 bus.
+ */
+class UARTComponent {
+ public:
+  virtual ~UARTComponent() = default;
+  virtual void write_array(const uint8_t *data, size_t len) = 0;
+  virtual bool read_array(uint8_t *data, size_t len) = 0;
+  virtual int available() = 0;
+  virtual void flush() = 0;
+
+  void set_baud_rate(uint32_t baud_rate) { this->baud_rate_ = baud_rate; }
+  uint32_t get_baud_rate() const { return this->baud_rate_; }
+  void set_stop_bits(uint8_t stop_bits) { this->stop_bits_ = stop_bits; }
+  uint8_t get_stop_bits() const { return this->stop_bits_; }
+  void set_data_bits(uint8_t data_bits) { this->data_bits_ = data_bits; }
+  uint8_t get_data_bits() const { return this->data_bits_; }
+  void set_parity(UARTParityOptions parity) { this->parity_ = parity; }
+  UARTParityOptions get_parity() const { return this->parity_; }
+
+ protected:
+  uint32_t baud_rate_{9600};
+  uint8_t stop_bits_{1};
+  uint8_t data_bits_{8};
+  UARTParityOptions parity_{UART_CONFIG_PARITY_NONE};
+};
+
+class UARTDevice {
+ public:
+  UARTDevice() = default;
+  explicit UARTDevice(UARTComponent *parent) : parent_(parent) {}
+
+  void set_uart_parent(UARTComponent *parent) { this->parent_ = parent; }
+
+  void write_array(const uint8_t *data, size_t len) { this->parent_->write_array(data, len); }
+  bool read_array(uint8_t *data, size_t len) { return this->parent_->read_array(data, len); }
+  int available() { return this->parent_->available(); }
+  void flush() { this->parent_->flush(); }
+
+ protected:
+  UARTComponent *parent_{nullptr};
+};
+
+}  // namespace uart
+}  // namespace esphome
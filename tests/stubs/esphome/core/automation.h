@@ -0,0 +1,20 @@
+#pragma once
+
+#include <functional>
+
+namespace esphome {
+
+template<typename... Ts> class Trigger {
+ public:
+  void trigger(Ts... x) {
+    if (this->on_trigger_) {
+      this->on_trigger_(x...);
+    }
+  }
+  void set_on_trigger(std::function<void(Ts...)> &&on_trigger) { this->on_trigger_ = std::move(on_trigger); }
+
+ protected:
+  std::function<void(Ts...)> on_trigger_;
+};
+
+}  // namespace esphome
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include "esphome/core/gpio.h"
+#include "esphome/core/hal.h"
+#include "esphome/core/helpers.h"
+#include "esphome/core/log.h"
+#include "esphome/core/preferences.h"
+
+namespace esphome {
+
+class Component {
+ public:
+  virtual ~Component() = default;
+  virtual void setup() {}
+  virtual void loop() {}
+  virtual void dump_config() {}
+  virtual float get_setup_priority() const { return 0.0f; }
+  virtual void on_shutdown() {}
+  virtual void on_safe_shutdown() {}
+};
+
+class PollingComponent : public Component {
+ public:
+  virtual void update() = 0;
+  void set_update_interval(uint32_t update_interval) { this->update_interval_ = update_interval; }
+  uint32_t get_update_interval() const { return this->update_interval_; }
+
+ protected:
+  uint32_t update_interval_{0};
+};
+
+}  // namespace esphome
@@ -0,0 +1,4 @@
+#pragma once
+
+// Generated by ESPHome for real builds. The test harness passes the USE_COMFORTNET_* defines on the command line
+// instead, so each test target can pick its own configuration.
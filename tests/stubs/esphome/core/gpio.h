@@ -0,0 +1,12 @@
+#pragma once
+
+namespace esphome {
+
+class GPIOPin {
+ public:
+  virtual void setup() = 0;
+  virtual void digital_write(bool value) = 0;
+  virtual bool digital_read() = 0;
+};
+
+}  // namespace esphome
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <cstdint>
+
+namespace esphome {
+
+/**
+ * Host time, read from a steady clock. Comfortnet only uses these through HardwareClock, tests install a VirtualClock.
+ */
+uint32_t millis();
+uint32_t micros();
+void delay(uint32_t ms);
+
+}  // namespace esphome
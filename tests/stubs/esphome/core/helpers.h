@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace esphome {
+
+template<typename T> using optional = std::optional<T>;
+using std::nullopt;
+
+std::string format_hex_pretty(const uint8_t *data, size_t length);
+std::string format_hex_pretty(const std::vector<uint8_t> &data);
+uint32_t fnv1_hash(const std::string &str);
+uint16_t crc16(const uint8_t *data, uint16_t len, uint16_t crc = 0xffff, uint16_t reverse_poly = 0xa001,
+               bool refin = false, bool refout = false);
+/**
+ * Seeded with a fixed value, so host runs draw the same MACs and session IDs every time
+ */
+uint32_t random_uint32();
+/**
+ * Host only, restarts the random_uint32() sequence so each scenario can draw its own identities
+ */
+void random_seed(uint32_t seed);
+
+class HighFrequencyLoopRequester {
+ public:
+  void start();
+  void stop();
+  static bool is_high_frequency();
+
+ protected:
+  bool started_{false};
+};
+
+}  // namespace esphome
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cinttypes>
+#include <cstdio>
+
+#define ESPHOME_LOG_LEVEL_NONE 0
+#define ESPHOME_LOG_LEVEL_ERROR 1
+#define ESPHOME_LOG_LEVEL_WARN 2
+#define ESPHOME_LOG_LEVEL_INFO 3
+#define ESPHOME_LOG_LEVEL_CONFIG 4
+#define ESPHOME_LOG_LEVEL_DEBUG 5
+#define ESPHOME_LOG_LEVEL_VERBOSE 6
+#define ESPHOME_LOG_LEVEL_VERY_VERBOSE 7
+
+#ifndef ESPHOME_LOG_LEVEL
+#define ESPHOME_LOG_LEVEL ESPHOME_LOG_LEVEL_DEBUG
+#endif
+
+namespace esphome {
+
+/**
+ * Formats a log line like the firmware does, and prints it if COMFORTNET_TEST_LOG is set in the environment. Every
+ * line is counted by level either way.
+ */
+void esp_log_printf_(int level, const char *tag, int line, const char *format, ...)
+    __attribute__((format(printf, 4, 5)));
+uint32_t esp_log_count(int level);
+void esp_log_reset_counts();
+
+}  // namespace esphome
+
+#define ESPHOME_LOG_IMPL_(level, tag, format, ...) \
+  ::esphome::esp_log_printf_(level, tag, __LINE__, format, ##__VA_ARGS__)
+
+#if ESPHOME_LOG_LEVEL >= ESPHOME_LOG_LEVEL_ERROR
+#define ESP_LOGE(tag, format, ...) ESPHOME_LOG_IMPL_(ESPHOME_LOG_LEVEL_ERROR, tag, format, ##__VA_ARGS__)
+#else
+#define ESP_LOGE(tag, format, ...)
+#endif
+#if ESPHOME_LOG_LEVEL >= ESPHOME_LOG_LEVEL_WARN
+#define ESP_LOGW(tag, format, ...) ESPHOME_LOG_IMPL_(ESPHOME_LOG_LEVEL_WARN, tag, format, ##__VA_ARGS__)
+#else
+#define ESP_LOGW(tag, format, ...)
+#endif
+#if ESPHOME_LOG_LEVEL >= ESPHOME_LOG_LEVEL_INFO
+#define ESP_LOGI(tag, format, ...) ESPHOME_LOG_IMPL_(ESPHOME_LOG_LEVEL_INFO, tag, format, ##__VA_ARGS__)
+#else
+#define ESP_LOGI(tag, format, ...)
+#endif
+#if ESPHOME_LOG_LEVEL >= ESPHOME_LOG_LEVEL_CONFIG
+#define ESP_LOGCONFIG(tag, format, ...) ESPHOME_LOG_IMPL_(ESPHOME_LOG_LEVEL_CONFIG, tag, format, ##__VA_ARGS__)
+#else
+#define ESP_LOGCONFIG(tag, format, ...)
+#endif
+#if ESPHOME_LOG_LEVEL >= ESPHOME_LOG_LEVEL_DEBUG
+#define ESP_LOGD(tag, format, ...) ESPHOME_LOG_IMPL_(ESPHOME_LOG_LEVEL_DEBUG, tag, format, ##__VA_ARGS__)
+#else
+#define ESP_LOGD(tag, format, ...)
+#endif
+#if ESPHOME_LOG_LEVEL >= ESPHOME_LOG_LEVEL_VERBOSE
+#define ESP_LOGV(tag, format, ...) ESPHOME_LOG_IMPL_(ESPHOME_LOG_LEVEL_VERBOSE, tag, format, ##__VA_ARGS__)
+#else
+#define ESP_LOGV(tag, format, ...)
+#endif
+#if ESPHOME_LOG_LEVEL >= ESPHOME_LOG_LEVEL_VERY_VERBOSE
+#define ESP_LOGVV(tag, format, ...) ESPHOME_LOG_IMPL_(ESPHOME_LOG_LEVEL_VERY_VERBOSE, tag, format, ##__VA_ARGS__)
+#else
+#define ESP_LOGVV(tag, format, ...)
+#endif
+
+#define LOG_PIN(prefix, pin) \
+  if ((pin) != nullptr) { \
+    ESP_LOGCONFIG(TAG, prefix "set"); \
+  }
+
+#define YESNO(b) ((b) ? "YES" : "NO")
+#define ONOFF(b) ((b) ? "ON" : "OFF")
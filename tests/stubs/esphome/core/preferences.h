@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <vector>
+
+namespace esphome {
+
+class ESPPreferences;
+
+class ESPPreferenceObject {
+ public:
+  ESPPreferenceObject() = default;
+  ESPPreferenceObject(ESPPreferences *backend, uint32_t key, size_t length)
+      : backend_(backend), key_(key), length_(length) {}
+
+  template<typename T> bool save(const T *src) {
+    return this->save_(reinterpret_cast<const uint8_t *>(src), sizeof(T));
+  }
+  template<typename T> bool load(T *dest) { return this->load_(reinterpret_cast<uint8_t *>(dest), sizeof(T)); }
+
+ protected:
+  bool save_(const uint8_t *data, size_t length);
+  bool load_(uint8_t *data, size_t length);
+
+  ESPPreferences *backend_{nullptr};
+  uint32_t key_{0};
+  size_t length_{0};
+};
+
+/**
+ * In-memory stand-in for flash. Saved values outlive the Comfortnet instance that wrote them, so a test can reboot a
+ * node by building a new one.
+ */
+class ESPPreferences {
+ public:
+  template<typename T> ESPPreferenceObject make_preference(uint32_t type, bool in_flash) {
+    return ESPPreferenceObject(this, type, sizeof(T));
+  }
+  template<typename T> ESPPreferenceObject make_preference(uint32_t type) {
+    return ESPPreferenceObject(this, type, sizeof(T));
+  }
+  bool sync();
+
+  void clear();
+  inline uint32_t get_write_count() const { return this->write_count_; }
+  inline uint32_t get_sync_count() const { return this->sync_count_; }
+
+ protected:
+  friend class ESPPreferenceObject;
+
+  std::map<uint32_t, std::vector<uint8_t>> values_;
+  uint32_t write_count_{0};
+  uint32_t sync_count_{0};
+};
+
+extern ESPPreferences *global_preferences;  // NOLINT
+
+}  // namespace esphome
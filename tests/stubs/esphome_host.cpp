@@ -0,0 +1,163 @@
+#include <chrono>
+#include <cstdarg>
+#include <cstdlib>
+#include <thread>
+#include "esphome/core/hal.h"
+#include "esphome/core/helpers.h"
+#include "esphome/core/log.h"
+#include "esphome/core/preferences.h"
+
+namespace esphome {
+
+static const auto BOOT_TIME = std::chrono::steady_clock::now();
+
+uint32_t millis() {
+  return static_cast<uint32_t>(
+      std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - BOOT_TIME).count());
+}
+
+uint32_t micros() {
+  return static_cast<uint32_t>(
+      std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - BOOT_TIME).count());
+}
+
+void delay(uint32_t ms) { std::this_thread::sleep_for(std::chrono::milliseconds(ms)); }
+
+std::string format_hex_pretty(const uint8_t *data, size_t length) {
+  if (length == 0) {
+    return "";
+  }
+  static const char *const HEX_DIGITS = "0123456789ABCDEF";
+  std::string ret;
+  ret.resize(3 * length - 1);
+  for (size_t i = 0; i < length; i++) {
+    ret[3 * i] = HEX_DIGITS[(data[i] & 0xF0) >> 4];
+    ret[3 * i + 1] = HEX_DIGITS[data[i] & 0x0F];
+    if (i != length - 1) {
+      ret[3 * i + 2] = '.';
+    }
+  }
+  if (length > 4) {
+    return ret + " (" + std::to_string(length) + ")";
+  }
+  return ret;
+}
+
+std::string format_hex_pretty(const std::vector<uint8_t> &data) { return format_hex_pretty(data.data(), data.size()); }
+
+uint32_t fnv1_hash(const std::string &str) {
+  uint32_t hash = 2166136261UL;
+  for (char c : str) {
+    hash *= 16777619UL;
+    hash ^= c;
+  }
+  return hash;
+}
+
+uint16_t crc16(const uint8_t *data, uint16_t len, uint16_t crc, uint16_t reverse_poly, bool refin, bool refout) {
+  if (refin) {
+    crc ^= 0xffff;
+  }
+  while (len--) {
+    crc ^= *data++;
+    for (uint8_t i = 0; i < 8; i++) {
+      if (crc & 0x0001) {
+        crc = (crc >> 1) ^ reverse_poly;
+      } else {
+        crc >>= 1;
+      }
+    }
+  }
+  return refout ? (crc ^ 0xffff) : crc;
+}
+
+static uint32_t random_state = 0x2545F491;
+
+uint32_t random_uint32() {
+  random_state ^= random_state << 13;
+  random_state ^= random_state >> 17;
+  random_state ^= random_state << 5;
+  return random_state;
+}
+
+void random_seed(uint32_t seed) { random_state = seed == 0 ? 0x2545F491 : seed; }
+
+static uint32_t high_frequency_requests = 0;
+
+void HighFrequencyLoopRequester::start() {
+  if (!this->started_) {
+    this->started_ = true;
+    high_frequency_requests++;
+  }
+}
+
+void HighFrequencyLoopRequester::stop() {
+  if (this->started_) {
+    this->started_ = false;
+    high_frequency_requests--;
+  }
+}
+
+bool HighFrequencyLoopRequester::is_high_frequency() { return high_frequency_requests > 0; }
+
+static uint32_t log_counts[ESPHOME_LOG_LEVEL_VERY_VERBOSE + 1];
+
+void esp_log_printf_(int level, const char *tag, int line, const char *format, ...) {
+  log_counts[level]++;
+  static const bool enabled = std::getenv("COMFORTNET_TEST_LOG") != nullptr;
+  if (!enabled) {
+    return;
+  }
+  static const char LEVEL_LETTERS[] = "?EWICDVV";
+  char buffer[512];
+  va_list args;
+  va_start(args, format);
+  vsnprintf(buffer, sizeof(buffer), format, args);
+  va_end(args);
+  printf("[%c][%s:%d]: %s\n", LEVEL_LETTERS[level], tag, line, buffer);
+}
+
+uint32_t esp_log_count(int level) { return log_counts[level]; }
+
+void esp_log_reset_counts() {
+  for (auto &count : log_counts) {
+    count = 0;
+  }
+}
+
+bool ESPPreferenceObject::save_(const uint8_t *data, size_t length) {
+  if (this->backend_ == nullptr || length != this->length_) {
+    return false;
+  }
+  this->backend_->values_[this->key_].assign(data, data + length);
+  this->backend_->write_count_++;
+  return true;
+}
+
+bool ESPPreferenceObject::load_(uint8_t *data, size_t length) {
+  if (this->backend_ == nullptr || length != this->length_) {
+    return false;
+  }
+  auto it = this->backend_->values_.find(this->key_);
+  if (it == this->backend_->values_.end() || it->second.size() != length) {
+    return false;
+  }
+  memcpy(data, it->second.data(), length);
+  return true;
+}
+
+bool ESPPreferences::sync() {
+  this->sync_count_++;
+  return true;
+}
+
+void ESPPreferences::clear() {
+  this->values_.clear();
+  this->write_count_ = 0;
+  this->sync_count_ = 0;
+}
+
+static ESPPreferences host_preferences;
+ESPPreferences *global_preferences = &host_preferences;  // NOLINT
+
+}  // namespace esphome
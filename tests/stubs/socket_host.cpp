@@ -0,0 +1,79 @@
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include "esphome/components/socket/socket.h"
+
+namespace esphome {
+namespace socket {
+
+/**
+ * Owns one file descriptor from the host's BSD sockets
+ */
+class HostSocket : public Socket {
+ public:
+  explicit HostSocket(int fd) : fd_(fd) {}
+  ~HostSocket() override { this->close(); }
+
+  std::unique_ptr<Socket> accept(struct sockaddr *addr, socklen_t *addrlen) override {
+    int fd = ::accept(this->fd_, addr, addrlen);
+    if (fd < 0) {
+      return nullptr;
+    }
+    return std::make_unique<HostSocket>(fd);
+  }
+  int bind(const struct sockaddr *addr, socklen_t addrlen) override { return ::bind(this->fd_, addr, addrlen); }
+  int close() override {
+    if (this->fd_ < 0) {
+      return 0;
+    }
+    int ret = ::close(this->fd_);
+    this->fd_ = -1;
+    return ret;
+  }
+  int listen(int backlog) override { return ::listen(this->fd_, backlog); }
+  ssize_t read(void *buf, size_t len) override { return ::recv(this->fd_, buf, len, 0); }
+  // MSG_NOSIGNAL, so a client that went away shows up as EPIPE rather than killing the test
+  ssize_t write(const void *buf, size_t len) override { return ::send(this->fd_, buf, len, MSG_NOSIGNAL); }
+  int setsockopt(int level, int optname, const void *optval, socklen_t optlen) override {
+    return ::setsockopt(this->fd_, level, optname, optval, optlen);
+  }
+  int setblocking(bool blocking) override {
+    int flags = ::fcntl(this->fd_, F_GETFL, 0);
+    if (flags < 0) {
+      return -1;
+    }
+    flags = blocking ? flags & ~O_NONBLOCK : flags | O_NONBLOCK;
+    return ::fcntl(this->fd_, F_SETFL, flags);
+  }
+
+ protected:
+  int fd_;
+};
+
+// lwIP's default TCP send buffer on an ESP32. Accepted sockets inherit it, so a client that stops reading backs up
+// into the component after a few KB, as it would on the device, rather than the megabytes a desktop kernel allows.
+static const int SEND_BUFFER_SIZE = 5744;
+
+std::unique_ptr<Socket> socket_ip(int type, int protocol) {
+  int fd = ::socket(AF_INET, type, protocol);
+  if (fd < 0) {
+    return nullptr;
+  }
+  ::setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &SEND_BUFFER_SIZE, sizeof(SEND_BUFFER_SIZE));
+  return std::make_unique<HostSocket>(fd);
+}
+
+socklen_t set_sockaddr_any(struct sockaddr *addr, socklen_t addrlen, uint16_t port) {
+  if (addrlen < sizeof(struct sockaddr_in)) {
+    return 0;
+  }
+  auto *server = reinterpret_cast<struct sockaddr_in *>(addr);
+  memset(server, 0, sizeof(struct sockaddr_in));
+  server->sin_family = AF_INET;
+  server->sin_addr.s_addr = htonl(INADDR_ANY);
+  server->sin_port = htons(port);
+  return sizeof(struct sockaddr_in);
+}
+
+}  // namespace socket
+}  // namespace esphome
@@ -0,0 +1,304 @@
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <new>
+#include <sstream>
+#include <gtest/gtest.h>
+#include "fake_coordinator.h"
+#include "simulated_node.h"
+
+using namespace comfortnet;
+using namespace comfortnet::testing;
+
+/**
+ * Heap use, only counted while Comfortnet itself is running
+ */
+static bool counting = false;
+static uint64_t allocation_count = 0;
+static uint64_t allocated_bytes = 0;
+
+void *operator new(size_t size) {
+  if (counting) {
+    allocation_count++;
+    allocated_bytes += size;
+  }
+  void *ptr = std::malloc(size == 0 ? 1 : size);
+  if (ptr == nullptr) {
+    throw std::bad_alloc();
+  }
+  return ptr;
+}
+void *operator new[](size_t size) { return operator new(size); }
+void operator delete(void *ptr) noexcept { std::free(ptr); }
+void operator delete[](void *ptr) noexcept { std::free(ptr); }
+void operator delete(void *ptr, size_t) noexcept { std::free(ptr); }
+void operator delete[](void *ptr, size_t) noexcept { std::free(ptr); }
+
+namespace {
+
+const char *const CAPTURE_FILE = TEST_DATA_DIR "/data/ct485_capture.txt";
+const char *const BASELINE_FILE = TEST_DATA_DIR "/allocation_baseline.txt";
+// The debug log dumps every frame, so each log level keeps its own baseline
+#if ESPHOME_LOG_LEVEL >= ESPHOME_LOG_LEVEL_DEBUG
+const char *const LOG_LEVEL = "debug";
+#else
+const char *const LOG_LEVEL = "info";
+#endif
+
+struct CapturedFrame {
+  uint32_t time;  // Millis since the capture started
+  std::vector<uint8_t> data;
+};
+
+std::vector<CapturedFrame> load_capture() {
+  std::vector<CapturedFrame> frames;
+  std::ifstream file(CAPTURE_FILE);
+  std::string line;
+  while (std::getline(file, line)) {
+    if (line.empty() || line[0] == '#') {
+      continue;
+    }
+    std::istringstream fields(line);
+    CapturedFrame frame;
+    std::string hex;
+    fields >> frame.time >> hex;
+    for (size_t i = 0; i + 1 < hex.size(); i += 2) {
+      frame.data.push_back(std::stoul(hex.substr(i, 2), nullptr, 16));
+    }
+    frames.push_back(std::move(frame));
+  }
+  return frames;
+}
+
+/**
+ * Plays captured frames back at their recorded times, one byte time apart like the wire. Nothing here allocates once
+ * loaded, so everything counted comes from Comfortnet.
+ */
+class ReplayUART : public esphome::uart::UARTComponent {
+ public:
+  ReplayUART(Simulation *simulation, const std::vector<CapturedFrame> &frames, uint64_t start)
+      : simulation_(simulation) {
+    const uint32_t byte_time = 10000000 / 9600;
+    for (const auto &frame : frames) {
+      uint64_t arrival = start + static_cast<uint64_t>(frame.time) * 1000;
+      for (uint8_t byte : frame.data) {
+        arrival += byte_time;
+        this->bytes_.push_back({arrival, byte});
+      }
+      this->frame_ends_.push_back(arrival);
+      this->message_types_.push_back(FrameView(frame.data.data()).message_type());
+    }
+  }
+
+  void write_array(const uint8_t *data, size_t len) override { this->written_bytes_ += len; }
+  bool read_array(uint8_t *data, size_t len) override {
+    if (static_cast<size_t>(this->available()) < len) {
+      return false;
+    }
+    for (size_t i = 0; i < len; i++) {
+      data[i] = this->bytes_[this->cursor_++].value;
+    }
+    return true;
+  }
+  int available() override {
+    size_t end = this->cursor_;
+    while (end < this->bytes_.size() && this->bytes_[end].arrival <= this->simulation_->now()) {
+      end++;
+    }
+    return end - this->cursor_;
+  }
+  void flush() override {}
+
+  /**
+   * Frames whose last byte has arrived
+   */
+  size_t get_frames_arrived() {
+    while (this->frames_arrived_ < this->frame_ends_.size() &&
+           this->frame_ends_[this->frames_arrived_] <= this->simulation_->now()) {
+      this->frames_arrived_++;
+    }
+    return this->frames_arrived_;
+  }
+  inline MessageType get_message_type(size_t frame) const { return this->message_types_[frame]; }
+  inline bool is_done() const { return this->cursor_ == this->bytes_.size(); }
+  inline size_t get_written_bytes() const { return this->written_bytes_; }
+
+ protected:
+  struct TimedByte {
+    uint64_t arrival;
+    uint8_t value;
+  };
+
+  Simulation *simulation_;
+  std::vector<TimedByte> bytes_;
+  std::vector<uint64_t> frame_ends_;
+  std::vector<MessageType> message_types_;
+  size_t cursor_{0};
+  size_t frames_arrived_{0};
+  size_t written_bytes_{0};
+};
+
+struct Usage {
+  uint64_t frames{0};
+  uint64_t allocations{0};
+  uint64_t bytes{0};
+};
+
+/**
+ * Loops Comfortnet with the counters on, and charges what it allocates to the last frame that arrived, since that is
+ * the one being handled and answered
+ */
+class CountingComponent : public esphome::Component {
+ public:
+  CountingComponent(Comfortnet *comfortnet, ReplayUART *uart, std::map<std::string, Usage> *usage)
+      : comfortnet_(comfortnet), uart_(uart), usage_(usage) {}
+
+  void loop() override {
+    size_t arrived = this->uart_->get_frames_arrived();
+    for (; this->seen_ < arrived; this->seen_++) {
+      (*this->usage_)[key(this->uart_->get_message_type(this->seen_))].frames++;
+    }
+    allocation_count = 0;
+    allocated_bytes = 0;
+    counting = true;
+    this->comfortnet_->loop();
+    counting = false;
+    if (allocation_count == 0) {
+      return;
+    }
+    Usage &usage = (*this->usage_)[arrived == 0 ? "idle" : key(this->uart_->get_message_type(arrived - 1))];
+    usage.allocations += allocation_count;
+    usage.bytes += allocated_bytes;
+  }
+
+  static std::string key(MessageType message_type) {
+    char text[5];
+    snprintf(text, sizeof(text), "0x%02X", static_cast<uint8_t>(message_type));
+    return text;
+  }
+
+ protected:
+  Comfortnet *comfortnet_;
+  ReplayUART *uart_;
+  std::map<std::string, Usage> *usage_;
+  size_t seen_{0};
+};
+
+/**
+ * Every level's baseline, keyed by level and then type
+ */
+std::map<std::string, std::map<std::string, Usage>> load_baselines() {
+  std::map<std::string, std::map<std::string, Usage>> baselines;
+  std::ifstream file(BASELINE_FILE);
+  std::string line;
+  while (std::getline(file, line)) {
+    if (line.empty() || line[0] == '#') {
+      continue;
+    }
+    std::istringstream fields(line);
+    std::string level;
+    std::string key;
+    Usage usage;
+    fields >> level >> key >> usage.frames >> usage.allocations >> usage.bytes;
+    baselines[level][key] = usage;
+  }
+  return baselines;
+}
+
+void write_baselines(const std::map<std::string, std::map<std::string, Usage>> &baselines) {
+  std::ofstream file(BASELINE_FILE);
+  file << "# Heap allocations while Comfortnet handles tests/data/ct485_capture.txt, by logger level and\n"
+          "# the message type of the frame being handled, which includes anything sent in reply.\n"
+          "# test_allocations fails if any allocation count rises above these. Bytes are for reference,\n"
+          "# they depend on the standard library.\n"
+          "#\n"
+          "# After an intended change, run test_allocations and test_allocations_info with\n"
+          "# COMFORTNET_WRITE_BASELINE=1 to rewrite their lines.\n"
+          "#\n"
+          "# level type frames allocations bytes\n";
+  for (const auto &level : baselines) {
+    for (const auto &entry : level.second) {
+      file << level.first << " " << entry.first << " " << entry.second.frames << " " << entry.second.allocations << " "
+           << entry.second.bytes << "\n";
+    }
+  }
+}
+
+std::vector<uint8_t> furnace_status(MessageType, const uint8_t *, uint8_t) { return {0x01, 0x01, 0x64}; }
+
+/**
+ * Joins a network once, so the replayed node resumes its saved address like a device that rebooted
+ */
+void join_network() {
+  Simulation simulation(1);
+  SimulatedBus *bus = simulation.add_bus();
+  FakeCoordinator coordinator(&simulation, bus);
+  coordinator.add_device(NodeType::GAS_FURNACE, furnace_status);
+  simulation.add_peer([&coordinator]() { coordinator.loop(); });
+  SimulatedNode node(&simulation, bus);
+  node.boot();
+  ASSERT_TRUE(simulation.run_until([&node]() { return node.is_joined(); }, 60000));
+}
+
+}  // namespace
+
+TEST(Allocations, RecordedTrafficStaysWithinBaseline) {
+  esphome::global_preferences->clear();
+  join_network();
+  std::vector<CapturedFrame> frames = load_capture();
+  ASSERT_FALSE(frames.empty()) << "No frames in " << CAPTURE_FILE;
+
+  Simulation simulation(1);
+  ReplayUART uart(&simulation, frames, 0);
+  std::map<std::string, Usage> usage;
+  Comfortnet comfortnet;
+  comfortnet.set_uart_parent(&uart);
+  comfortnet.set_clock(simulation.get_clock());
+  // What a furnace's sensors, climate and a packet trigger would register
+  for (const char *key : {"HEAT_DEMAND", "FAN_DEMAND", "AIRFLOW", "CRITICAL_FAULT", "RETURN_AIR_TEMPERATURE"}) {
+    comfortnet.register_listener(key, [](const ComfortnetData &) {});
+    comfortnet.register_catalog_polling(key, NodeType::GAS_FURNACE);
+  }
+  comfortnet.register_command_listener(CommandType::HEAT_DEMAND, [](const ComfortnetCommandData &) {});
+  comfortnet.register_packet_listener(MessageType::GET_STATUS_RESPONSE, [](const ComfortnetPacketData &) {});
+
+  allocation_count = 0;
+  allocated_bytes = 0;
+  counting = true;
+  comfortnet.setup();
+  counting = false;
+  usage["setup"] = {0, allocation_count, allocated_bytes};
+
+  CountingComponent counter(&comfortnet, &uart, &usage);
+  simulation.add_component(&counter);
+  ASSERT_TRUE(simulation.run_until([&uart]() { return uart.is_done(); }, frames.back().time + 1000));
+  simulation.run_for(1000);
+  EXPECT_GT(uart.get_written_bytes(), 0u) << "The node never answered, so only the receive path was measured";
+
+  printf("Logger level %s\n%-6s %7s %13s %12s\n", LOG_LEVEL, "type", "frames", "allocs/frame", "bytes/frame");
+  for (const auto &entry : usage) {
+    const Usage &used = entry.second;
+    double frames_seen = used.frames == 0 ? 1.0 : used.frames;
+    printf("%-6s %7" PRIu64 " %13.2f %12.1f\n", entry.first.c_str(), used.frames, used.allocations / frames_seen,
+           used.bytes / frames_seen);
+  }
+
+  std::map<std::string, std::map<std::string, Usage>> baselines = load_baselines();
+  if (std::getenv("COMFORTNET_WRITE_BASELINE") != nullptr) {
+    baselines[LOG_LEVEL] = usage;
+    write_baselines(baselines);
+    printf("Wrote the %s baseline to %s\n", LOG_LEVEL, BASELINE_FILE);
+    return;
+  }
+  const std::map<std::string, Usage> &baseline = baselines[LOG_LEVEL];
+  ASSERT_FALSE(baseline.empty()) << "No " << LOG_LEVEL << " baseline in " << BASELINE_FILE;
+  for (const auto &entry : usage) {
+    auto it = baseline.find(entry.first);
+    uint64_t allowed = it == baseline.end() ? 0 : it->second.allocations;
+    EXPECT_LE(entry.second.allocations, allowed) << "More allocations than the baseline for " << entry.first;
+    if (entry.second.allocations < allowed) {
+      printf("%s is down to %" PRIu64 " allocations from %" PRIu64 ", lower the baseline to keep it\n",
+             entry.first.c_str(), entry.second.allocations, allowed);
+    }
+  }
+}
@@ -0,0 +1,315 @@
+#include <arpa/inet.h>
+#include <chrono>
+#include <cinttypes>
+#include <fcntl.h>
+#include <unistd.h>
+#include <gtest/gtest.h>
+#include "fake_coordinator.h"
+#include "simulated_node.h"
+
+using namespace comfortnet;
+using namespace comfortnet::testing;
+
+namespace {
+
+const uint32_t JOIN_TIMEOUT = 60000;
+// Bus time between the client's reads, well under what fills the bridge's own buffer at 9600 baud
+const uint32_t READ_INTERVAL = 100;
+
+std::vector<uint8_t> furnace_status(MessageType, const uint8_t *, uint8_t) { return {0x01, 0x01, 0x64}; }
+
+/**
+ * A port nothing on this host is listening on right now
+ */
+uint16_t free_port() {
+  int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+  struct sockaddr_in addr {};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  socklen_t addr_len = sizeof(addr);
+  ::bind(fd, reinterpret_cast<struct sockaddr *>(&addr), addr_len);
+  ::getsockname(fd, reinterpret_cast<struct sockaddr *>(&addr), &addr_len);
+  ::close(fd);
+  return ntohs(addr.sin_port);
+}
+
+struct Record {
+  uint32_t time;
+  uint8_t direction;
+  std::vector<uint8_t> frame;
+};
+
+/**
+ * The host tool's end of the bridge, on loopback
+ */
+class BridgeClient {
+ public:
+  /**
+   * A receive buffer of 0 keeps the system default
+   */
+  BridgeClient(uint16_t port, int receive_buffer = 0) {
+    this->fd_ = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (receive_buffer != 0) {
+      // Has to be set before connecting to shrink the window the bridge sees
+      ::setsockopt(this->fd_, SOL_SOCKET, SO_RCVBUF, &receive_buffer, sizeof(receive_buffer));
+    }
+    struct sockaddr_in addr {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+    this->connected_ = ::connect(this->fd_, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)) == 0;
+    ::fcntl(this->fd_, F_SETFL, ::fcntl(this->fd_, F_GETFL, 0) | O_NONBLOCK);
+  }
+  ~BridgeClient() { ::close(this->fd_); }
+
+  inline bool is_connected() const { return this->connected_; }
+
+  /**
+   * Reads everything the bridge has sent so far, and splits it into records
+   */
+  void read() {
+    uint8_t chunk[4096];
+    ssize_t received;
+    while ((received = ::recv(this->fd_, chunk, sizeof(chunk), 0)) > 0) {
+      this->stream_.insert(this->stream_.end(), chunk, chunk + received);
+    }
+    size_t pos = 0;
+    while (this->stream_.size() - pos >= 2) {
+      uint16_t record_len = this->stream_[pos] | (this->stream_[pos + 1] << 8);
+      if (this->stream_.size() - pos - 2 < record_len) {
+        break;
+      }
+      const uint8_t *record = this->stream_.data() + pos + 2;
+      Record parsed;
+      parsed.time = record[0] | (record[1] << 8) | (record[2] << 16) | (static_cast<uint32_t>(record[3]) << 24);
+      parsed.direction = record[4];
+      parsed.frame.assign(record + 5, record + record_len);
+      this->records_.push_back(std::move(parsed));
+      pos += 2 + record_len;
+    }
+    this->stream_.erase(this->stream_.begin(), this->stream_.begin() + pos);
+  }
+
+  void send(const Frame &frame) {
+    std::vector<uint8_t> record = {frame.size, 0};
+    record.insert(record.end(), frame.data, frame.data + frame.size);
+    this->pending_.insert(this->pending_.end(), record.begin(), record.end());
+    this->write();
+  }
+  /**
+   * Writes what the socket will take of the frames sent so far
+   */
+  void write() {
+    while (!this->pending_.empty()) {
+      ssize_t written = ::send(this->fd_, this->pending_.data(), this->pending_.size(), MSG_NOSIGNAL);
+      if (written <= 0) {
+        return;
+      }
+      this->pending_.erase(this->pending_.begin(), this->pending_.begin() + written);
+    }
+  }
+
+  inline const std::vector<Record> &get_records() const { return this->records_; }
+  /**
+   * Bytes read that don't make up a whole record yet
+   */
+  inline size_t get_partial_bytes() const { return this->stream_.size(); }
+
+ protected:
+  int fd_;
+  bool connected_{false};
+  std::vector<uint8_t> stream_;
+  std::vector<Record> records_;
+  std::vector<uint8_t> pending_;
+};
+
+struct Network {
+  /**
+   * Polls the furnace every poll interval, or not at all if it's 0
+   */
+  Network(uint32_t seed, uint32_t poll_interval)
+      : simulation(seed), bus(simulation.add_bus()), coordinator(&simulation, bus), node(&simulation, bus),
+        port(free_port()) {
+    esphome::global_preferences->clear();
+    this->simulation.set_loop_interval(1);
+    this->coordinator.add_device(NodeType::GAS_FURNACE, furnace_status);
+    this->simulation.add_peer([this]() { this->coordinator.loop(); });
+    uint16_t bridge_port = this->port;
+    this->node.set_configure([bridge_port, poll_interval](Comfortnet *comfortnet) {
+      comfortnet->set_frame_bridge_port(bridge_port);
+      if (poll_interval != 0) {
+        comfortnet->register_device_polling(NodeType::GAS_FURNACE, MessageType::GET_STATUS, false, poll_interval);
+      }
+    });
+    this->bus->set_frame_observer([this](const BusFrame &frame) {
+      if (!frame.collided) {
+        this->frames.push_back(frame);
+      }
+    });
+  }
+
+  /**
+   * Boots the node, connects a client once the bridge is listening, and waits for both it and the node to be up
+   */
+  std::unique_ptr<BridgeClient> start(int receive_buffer = 0) {
+    this->node.boot();
+    this->simulation.run_for(10);
+    auto client = std::make_unique<BridgeClient>(this->port, receive_buffer);
+    EXPECT_TRUE(client->is_connected());
+    const FrameBridge &bridge = this->node.get()->get_frame_bridge();
+    EXPECT_TRUE(this->simulation.run_until([&bridge]() { return bridge.is_connected(); }, 1000));
+    EXPECT_TRUE(this->simulation.run_until([this]() { return this->node.is_joined(); }, JOIN_TIMEOUT));
+    return client;
+  }
+
+  inline const FrameBridge &bridge() { return this->node.get()->get_frame_bridge(); }
+
+  Simulation simulation;
+  SimulatedBus *bus;
+  FakeCoordinator coordinator;
+  SimulatedNode node;
+  uint16_t port;
+  // Every clean frame on the bus
+  std::vector<BusFrame> frames;
+};
+
+/**
+ * Where the records line up with the frames on the bus, checking that each is the frame itself in the right
+ * direction. Returns the index of the bus frame matching the first record.
+ */
+size_t match_records(const Network &network, const std::vector<Record> &records, uint8_t node_id) {
+  size_t first = 0;
+  while (first < network.frames.size() && network.frames[first].data != records[0].frame) {
+    first++;
+  }
+  EXPECT_LT(first, network.frames.size()) << "The first record isn't a frame from the bus";
+  for (size_t i = 0; i < records.size() && first + i < network.frames.size(); i++) {
+    const BusFrame &frame = network.frames[first + i];
+    EXPECT_EQ(records[i].frame, frame.data) << "record " << i;
+    uint8_t direction = frame.sender == node_id ? FRAME_BRIDGE_DIRECTION_TX : FRAME_BRIDGE_DIRECTION_RX;
+    EXPECT_EQ(records[i].direction, direction) << "record " << i;
+    if (::testing::Test::HasFailure()) {
+      break;
+    }
+  }
+  return first;
+}
+
+}  // namespace
+
+TEST(FrameBridge, ReadingClientGetsEveryFrame) {
+  // Polled faster than the coordinator hands out turns, so the node has traffic on every one of them
+  Network network(31, 100);
+  std::unique_ptr<BridgeClient> client = network.start();
+  uint8_t node_id = network.node.get_uart()->get_id();
+
+  const uint32_t measure_time = 600000;
+  auto started = std::chrono::steady_clock::now();
+  for (uint32_t elapsed = 0; elapsed < measure_time; elapsed += READ_INTERVAL) {
+    network.simulation.run_for(READ_INTERVAL);
+    client->read();
+  }
+  double wall_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+  const std::vector<Record> &records = client->get_records();
+  ASSERT_GT(records.size(), 1000u);
+  EXPECT_EQ(network.bridge().get_dropped_count(), 0u);
+  EXPECT_EQ(records.size(), network.bridge().get_sent_count());
+  size_t first = match_records(network, records, node_id);
+  // The last frame or two may still be on their way through the node's loop
+  EXPECT_GE(records.size() + 2, network.frames.size() - first);
+
+  size_t bytes = 0;
+  for (const Record &record : records) {
+    bytes += FRAME_BRIDGE_LENGTH_SIZE + FRAME_BRIDGE_RECORD_HEADER_SIZE + record.frame.size();
+  }
+  printf("%zu records, %zu bytes in %.0f s of bus time: %.1f records/s, %.0f bytes/s, no drops\n", records.size(),
+         bytes, measure_time / 1000.0, records.size() * 1000.0 / measure_time, bytes * 1000.0 / measure_time);
+  printf("Through loopback at simulation speed: %.0f records/s of wall time\n", records.size() / wall_seconds);
+}
+
+TEST(FrameBridge, StalledClientLosesWholeRecordsAndCountsThem) {
+  Network network(32, 100);
+  // With the smallest window the kernel allows, only a few KB of records fit between the bridge and the client
+  std::unique_ptr<BridgeClient> client = network.start(1);
+  uint8_t node_id = network.node.get_uart()->get_id();
+  const FrameBridge &bridge = network.bridge();
+
+  // Nothing is read, so the bridge's buffer fills up behind the socket's
+  ASSERT_TRUE(network.simulation.run_until([&bridge]() { return bridge.get_dropped_count() >= 100; }, 600000));
+  uint32_t dropped = bridge.get_dropped_count();
+  uint32_t sent = bridge.get_sent_count();
+  EXPECT_TRUE(bridge.is_connected());
+  printf("%" PRIu32 " records sent and %" PRIu32 " dropped before the client read anything\n", sent, dropped);
+
+  // The client catches up, and the bridge drains what it held without losing more
+  for (uint32_t elapsed = 0; elapsed < 60000; elapsed += READ_INTERVAL) {
+    client->read();
+    network.simulation.run_for(READ_INTERVAL);
+  }
+  client->read();
+  EXPECT_EQ(bridge.get_dropped_count(), dropped);
+  EXPECT_EQ(client->get_partial_bytes(), 0u);
+
+  // Drops only ever cost whole records, so the stream still parses into real frames
+  const std::vector<Record> &records = client->get_records();
+  ASSERT_EQ(records.size(), bridge.get_sent_count());
+  for (const Record &record : records) {
+    ASSERT_GE(record.frame.size(), PACKET_HEADER_SIZE + PACKET_CRC_SIZE);
+    FrameView view(record.frame.data());
+    ASSERT_EQ(view.size(), record.frame.size());
+    ASSERT_TRUE(view.is_checksum_valid());
+  }
+  // Every frame the node saw was either streamed or counted as dropped
+  size_t first = match_records(network, {records[0]}, node_id);
+  EXPECT_GE(bridge.get_sent_count() + bridge.get_dropped_count() + 2, network.frames.size() - first);
+  EXPECT_LE(bridge.get_sent_count() + bridge.get_dropped_count(), network.frames.size() - first);
+}
+
+TEST(FrameBridge, BusyQueueHoldsFramesBackWithoutLosingAny) {
+  Network network(33, 0);
+  std::unique_ptr<BridgeClient> client = network.start();
+  uint8_t node_id = network.node.get_uart()->get_id();
+  const FrameBridge &bridge = network.bridge();
+
+  // Many times what the pending message queue holds, all sent at once
+  const uint8_t count = 8 * PENDING_MESSAGE_QUEUE_SIZE;
+  for (uint8_t i = 0; i < count; i++) {
+    Frame frame;
+    FrameBuilder(frame)
+        .header(NodeAddress(0), NodeAddress(0), Subnet(0), SendMethod::NODE_TYPE,
+                static_cast<uint8_t>(NodeType::GAS_FURNACE), 0, NodeType(0), MessageType::GET_STATUS, 0)
+        .append(i)
+        .finish();
+    client->send(frame);
+  }
+  // The bridge takes no more than there is room for, and leaves the rest in the socket
+  network.simulation.run_for(50);
+  EXPECT_GT(bridge.get_injected_count(), 0u);
+  EXPECT_LE(bridge.get_injected_count(), PENDING_MESSAGE_QUEUE_SIZE + 1);
+
+  std::vector<uint8_t> sent;
+  size_t seen = 0;
+  ASSERT_TRUE(network.simulation.run_until(
+      [&]() {
+        client->write();
+        for (; network.frames.size() > seen; seen++) {
+          const BusFrame &frame = network.frames[seen];
+          FrameView view(frame.data.data());
+          if (frame.sender == node_id && view.message_type() == MessageType::GET_STATUS &&
+              view.payload_length() == 1) {
+            sent.push_back(view.payload()[0]);
+          }
+        }
+        return sent.size() >= count;
+      },
+      600000));
+  EXPECT_EQ(bridge.get_injected_count(), count);
+  EXPECT_EQ(bridge.get_rejected_count(), 0u);
+
+  // Sent in the order the client wrote them, none missing
+  ASSERT_EQ(sent.size(), count);
+  for (uint8_t i = 0; i < count; i++) {
+    EXPECT_EQ(sent[i], i);
+  }
+}
@@ -0,0 +1,141 @@
+#include <gtest/gtest.h>
+#include "fake_coordinator.h"
+#include "simulated_node.h"
+
+using namespace comfortnet;
+using namespace comfortnet::testing;
+
+namespace {
+
+const uint32_t JOIN_TIMEOUT = 60000;
+// Memory the stand-in furnace has, each byte holding the low byte of its address
+const uint32_t FURNACE_MEMORY_SIZE = 0x400;
+// DMA_RESPONSE_TIMEOUT and DMA_MAX_RETRIES from memory_reader.cpp, plus a couple of dataflow cycles
+const uint32_t ABANDON_TIMEOUT = 4 * 10000 + 15000;
+
+std::vector<uint8_t> furnace(MessageType request, const uint8_t *payload, uint8_t len) {
+  if (request != MessageType::DIRECT_MEMORY_ACCESS_READ) {
+    return {0x01, 0x01, 0x64};
+  }
+  if (len < DMA_REQUEST_SIZE) {
+    return {};
+  }
+  uint32_t address = (payload[1] << 8) | payload[0];
+  std::vector<uint8_t> response = {payload[0], payload[1]};
+  for (uint32_t i = 0; i < payload[2] && address + i < FURNACE_MEMORY_SIZE; i++) {
+    response.push_back((address + i) & 0xFF);
+  }
+  return response;
+}
+
+/**
+ * One Comfortnet polling a furnace through a coordinator, and reading memory on the side
+ */
+struct Network {
+  explicit Network(uint32_t seed)
+      : simulation(seed), bus(simulation.add_bus()), coordinator(&simulation, bus), node(&simulation, bus) {
+    esphome::global_preferences->clear();
+    coordinator.add_device(NodeType::GAS_FURNACE, furnace);
+    simulation.add_peer([this]() { this->coordinator.loop(); });
+    node.set_configure([](Comfortnet *comfortnet) {
+      comfortnet->register_device_polling(NodeType::GAS_FURNACE, MessageType::GET_STATUS, false, 1000);
+    });
+    node.boot();
+  }
+
+  bool join() {
+    return this->simulation.run_until([&]() { return this->node.is_joined(); }, JOIN_TIMEOUT);
+  }
+
+  /**
+   * Starts a read that checks every chunk follows on from the last one
+   */
+  bool start_read(NodeType node_type, uint32_t length) {
+    this->read.clear();
+    return this->node.get()->start_memory_read(node_type, 0, length,
+                                               [this](uint16_t address, const uint8_t *data, uint8_t data_len) {
+                                                 EXPECT_EQ(address, this->read.size());
+                                                 this->read.insert(this->read.end(), data, data + data_len);
+                                               });
+  }
+
+  /**
+   * Runs until the read is over, keeping track of the most messages the node had queued
+   */
+  bool finish_read(uint32_t timeout) {
+    return this->simulation.run_until(
+        [&]() {
+          this->peak_pending = std::max(this->peak_pending, this->node.get()->get_pending_message_count());
+          return !this->node.get()->get_memory_reader().is_active();
+        },
+        timeout);
+  }
+
+  Simulation simulation;
+  SimulatedBus *bus;
+  FakeCoordinator coordinator;
+  SimulatedNode node;
+  std::vector<uint8_t> read;
+  uint8_t peak_pending{0};
+};
+
+}  // namespace
+
+TEST(MemoryReader, ReadsInAddressOrder) {
+  Network network(1);
+  ASSERT_TRUE(network.join());
+  ASSERT_TRUE(network.start_read(NodeType::GAS_FURNACE, FURNACE_MEMORY_SIZE));
+  ASSERT_TRUE(network.finish_read(60000));
+  ASSERT_EQ(network.read.size(), FURNACE_MEMORY_SIZE);
+  for (uint32_t i = 0; i < network.read.size(); i++) {
+    ASSERT_EQ(network.read[i], i & 0xFF) << "at " << i;
+  }
+  EXPECT_EQ(network.node.get()->get_memory_reader().get_retry_count(), 0u);
+}
+
+TEST(MemoryReader, LostResponsesAreAskedForAgainWithoutDuplicates) {
+  Network network(2);
+  ASSERT_TRUE(network.join());
+  // Enough lost answers in a row that the reader times out and asks again
+  network.coordinator.set_lost_responses(4);
+  ASSERT_TRUE(network.start_read(NodeType::GAS_FURNACE, FURNACE_MEMORY_SIZE));
+  ASSERT_TRUE(network.finish_read(ABANDON_TIMEOUT));
+  EXPECT_EQ(network.read.size(), FURNACE_MEMORY_SIZE);
+  EXPECT_GE(network.node.get()->get_memory_reader().get_retry_count(), 1u);
+  // The requests being asked for again replace the unanswered ones, next to at most one poll
+  EXPECT_LE(network.peak_pending, DMA_REQUEST_WINDOW + 1);
+}
+
+TEST(MemoryReader, AbandonedReadUnblocksTheQueue) {
+  Network network(3);
+  ASSERT_TRUE(network.join());
+  // No heat pump on this bus, so every request is NAKed and never answered
+  ASSERT_TRUE(network.start_read(NodeType::HEAT_PUMP, FURNACE_MEMORY_SIZE));
+  ASSERT_TRUE(network.finish_read(ABANDON_TIMEOUT));
+  EXPECT_TRUE(network.read.empty());
+  EXPECT_EQ(network.node.get()->get_memory_reader().get_retry_count(), 3u);
+  EXPECT_LE(network.peak_pending, DMA_REQUEST_WINDOW + 1);
+
+  // Nothing of the read is left at the head of the queue, so polls go out again
+  network.simulation.run_for(1000);
+  EXPECT_LE(network.node.get()->get_pending_message_count(), 1u);
+  uint32_t polls = network.coordinator.get_routed_count(MessageType::GET_STATUS);
+  EXPECT_TRUE(network.simulation.run_until(
+      [&]() { return network.coordinator.get_routed_count(MessageType::GET_STATUS) >= polls + 3; }, 30000));
+}
+
+TEST(PendingMessages, UnansweredBackgroundMessageTimesOutAtTheHead) {
+  Network network(4);
+  ASSERT_TRUE(network.join());
+  // No heat pump on this bus, so the request is NAKed on every token and holds up the furnace polls behind it
+  PendingMessageToType request(NodeType::HEAT_PUMP, MessageType::GET_CONFIGURATION, nullptr, 0);
+  request.priority = MessagePriority::BACKGROUND;
+  ASSERT_TRUE(network.node.get()->queue_message(std::move(request)));
+  network.simulation.run_for(1000);
+  uint32_t polls = network.coordinator.get_routed_count(MessageType::GET_STATUS);
+  network.simulation.run_for(10000);
+  EXPECT_EQ(network.coordinator.get_routed_count(MessageType::GET_STATUS), polls);
+  // Until it times out
+  EXPECT_TRUE(network.simulation.run_until(
+      [&]() { return network.coordinator.get_routed_count(MessageType::GET_STATUS) > polls; }, 20000));
+}
@@ -0,0 +1,170 @@
+#include <cstring>
+#include <memory>
+#include <gtest/gtest.h>
+#include "fake_coordinator.h"
+#include "simulated_node.h"
+#include "turnaround_recorder.h"
+
+using namespace comfortnet;
+using namespace comfortnet::testing;
+
+namespace {
+
+// Main loop time each bus's component takes, in micros, so the buses contend for the core
+const uint32_t LOOP_COST = 500;
+const uint32_t JOIN_TIMEOUT = 60000;
+const uint32_t MEASURE_TIME = 600000;
+
+std::vector<uint8_t> furnace_status(MessageType, const uint8_t *, uint8_t) { return {0x01, 0x01, 0x64}; }
+
+struct Bus {
+  Bus(Simulation *simulation, uint32_t preference_salt)
+      : bus(simulation->add_bus()), coordinator(simulation, bus), node(simulation, bus, preference_salt) {}
+
+  bool in_sync() {
+    const CoordinatorMember *member = this->coordinator.find_member(this->node.get()->get_mac_address());
+    return this->node.is_joined() && member != nullptr && member->confirmed &&
+           member->address == this->node.get()->get_node_id();
+  }
+
+  SimulatedBus *bus;
+  FakeCoordinator coordinator;
+  SimulatedNode node;
+};
+
+/**
+ * One firmware looping a Comfortnet per bus, each bus with its own coordinator
+ */
+struct MultiBus {
+  MultiBus(size_t bus_count, uint32_t seed) : simulation(seed) {
+    esphome::global_preferences->clear();
+    this->simulation.set_loop_cost(LOOP_COST);
+    for (size_t i = 0; i < bus_count; i++) {
+      // Like the generated code, a lone bus keeps the unsalted keys
+      uint32_t salt = bus_count == 1 ? 0 : esphome::fnv1_hash("bus" + std::to_string(i));
+      auto bus = std::make_unique<Bus>(&this->simulation, salt);
+      Bus *raw = bus.get();
+      raw->coordinator.add_device(NodeType::GAS_FURNACE, furnace_status);
+      this->simulation.add_peer([raw]() { raw->coordinator.loop(); });
+      raw->node.set_configure([](Comfortnet *comfortnet) {
+        comfortnet->register_device_polling(NodeType::GAS_FURNACE, MessageType::GET_STATUS, false, 1000);
+      });
+      this->buses.push_back(std::move(bus));
+    }
+  }
+
+  void boot() {
+    for (auto &bus : this->buses) {
+      bus->node.boot();
+    }
+  }
+
+  bool all_in_sync() {
+    for (auto &bus : this->buses) {
+      if (!bus->in_sync()) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  Simulation simulation;
+  std::vector<std::unique_ptr<Bus>> buses;
+};
+
+struct Latency {
+  double mean;
+  uint64_t max;
+};
+
+/**
+ * R2R reply turnaround on every bus, in micros, once they have all joined
+ */
+std::vector<Latency> measure(size_t bus_count) {
+  MultiBus network(bus_count, 11);
+  network.boot();
+  EXPECT_TRUE(network.simulation.run_until([&]() { return network.all_in_sync(); }, JOIN_TIMEOUT));
+
+  std::vector<std::unique_ptr<TurnaroundRecorder>> recorders;
+  for (auto &bus : network.buses) {
+    recorders.push_back(std::make_unique<TurnaroundRecorder>(bus->bus, bus->node.get_uart()));
+  }
+  network.simulation.run_for(MEASURE_TIME);
+
+  std::vector<Latency> latencies;
+  for (size_t i = 0; i < bus_count; i++) {
+    const TurnaroundRecorder &recorder = *recorders[i];
+    EXPECT_GT(recorder.size(), 50u) << "bus " << i;
+    latencies.push_back({recorder.mean(), recorder.max()});
+    printf("%zu bus(es), bus %zu: %zu replies, turnaround mean %.2f ms, p99 %.2f ms, max %.2f ms\n", bus_count, i,
+           recorder.size(), recorder.mean() / 1000.0, recorder.percentile(0.99) / 1000.0, recorder.max() / 1000.0);
+  }
+  return latencies;
+}
+
+}  // namespace
+
+TEST(MultiBus, LatencyHoldsAsBusesAreAdded) {
+  Latency single = measure(1)[0];
+  for (size_t bus_count : {2, 4}) {
+    SCOPED_TRACE(std::to_string(bus_count) + " buses");
+    // The only thing another bus should cost is its share of each main loop
+    const uint64_t allowance = (bus_count - 1) * LOOP_COST + 1000;
+    for (const Latency &latency : measure(bus_count)) {
+      EXPECT_LE(latency.mean, single.mean + allowance);
+      EXPECT_LE(latency.max, single.max + allowance);
+    }
+  }
+}
+
+TEST(MultiBus, EachBusKeepsItsOwnIdentity) {
+  MultiBus network(4, 12);
+  network.boot();
+  ASSERT_TRUE(network.simulation.run_until([&]() { return network.all_in_sync(); }, JOIN_TIMEOUT));
+  std::vector<MacAddress> mac_addresses;
+  for (auto &bus : network.buses) {
+    for (const MacAddress &other : mac_addresses) {
+      EXPECT_NE(memcmp(bus->node.get()->get_mac_address().mac, other.mac, MAC_ADDRESS_SIZE), 0);
+    }
+    mac_addresses.push_back(bus->node.get()->get_mac_address());
+  }
+
+  // Every instance resumes from the same flash, each has to find its own saved identity
+  network.boot();
+  for (size_t i = 0; i < network.buses.size(); i++) {
+    EXPECT_EQ(memcmp(network.buses[i]->node.get()->get_mac_address().mac, mac_addresses[i].mac, MAC_ADDRESS_SIZE), 0)
+        << "bus " << i;
+  }
+  ASSERT_TRUE(network.simulation.run_until([&]() { return network.all_in_sync(); }, JOIN_TIMEOUT));
+  for (auto &bus : network.buses) {
+    EXPECT_EQ(bus->coordinator.get_members().size(), 1u);
+  }
+}
+
+TEST(MultiBus, ReplyTimingIsPerBus) {
+  MultiBus network(4, 13);
+  for (size_t i = 0; i < network.buses.size(); i++) {
+    network.buses[i]->node.set_configure([i](Comfortnet *comfortnet) {
+      comfortnet->set_reply_delay(10 + 20 * i);
+      comfortnet->register_device_polling(NodeType::GAS_FURNACE, MessageType::GET_STATUS, false, 1000);
+    });
+  }
+  network.boot();
+  ASSERT_TRUE(network.simulation.run_until([&]() { return network.all_in_sync(); }, JOIN_TIMEOUT));
+  std::vector<std::unique_ptr<TurnaroundRecorder>> recorders;
+  for (auto &bus : network.buses) {
+    recorders.push_back(std::make_unique<TurnaroundRecorder>(bus->bus, bus->node.get_uart()));
+  }
+  network.simulation.run_for(MEASURE_TIME);
+
+  for (size_t i = 0; i < network.buses.size(); i++) {
+    SCOPED_TRACE("bus " + std::to_string(i));
+    uint32_t reply_delay = 10 + 20 * i;
+    ASSERT_GT(recorders[i]->size(), 0u);
+    EXPECT_GT(recorders[i]->min(), reply_delay * 1000);
+    // Counted from the loop that read the R2R, so it can trail what the line saw by up to a loop
+    uint32_t turnaround = network.buses[i]->node.get()->get_max_reply_turnaround();
+    EXPECT_GT(turnaround, reply_delay);
+    EXPECT_LE(turnaround, recorders[i]->max() / 1000 + 1);
+  }
+}
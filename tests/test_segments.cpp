@@ -0,0 +1,204 @@
+#include <gtest/gtest.h>
+#include "fake_coordinator.h"
+#include "segment_assembler.h"
+#include "simulated_node.h"
+
+using namespace comfortnet;
+using namespace comfortnet::testing;
+
+namespace {
+
+const NodeAddress FURNACE = static_cast<NodeAddress>(0x40);
+const NodeAddress THERMOSTAT = static_cast<NodeAddress>(0x30);
+const uint32_t JOIN_TIMEOUT = 60000;
+// SEGMENT_TIMEOUT from segment_assembler.cpp
+const uint32_t SEGMENT_TIMEOUT = 5000;
+
+/**
+ * A frame carrying len bytes counting up from first
+ */
+Frame make_frame(NodeAddress source, MessageType message_type, uint8_t packet_number, uint8_t len, uint8_t first = 0) {
+  Frame frame;
+  FrameBuilder builder(frame);
+  builder.header(static_cast<NodeAddress>(0x01), source, Subnet::VERSION_2, SendMethod::NO_ROUTE, 0, 0,
+                 NodeType::GAS_FURNACE, message_type, packet_number);
+  for (uint8_t i = 0; i < len; i++) {
+    builder.append(static_cast<uint8_t>(first + i));
+  }
+  builder.finish();
+  return frame;
+}
+
+/**
+ * Collects the messages the assembler passes on
+ */
+struct Assembled {
+  explicit Assembled(SegmentAssembler &assembler) {
+    assembler.set_callback([this](const FrameView &header, const uint8_t *payload, uint16_t payload_len, uint32_t) {
+      this->sources.push_back(header.source());
+      this->types.push_back(header.message_type());
+      this->payloads.emplace_back(payload, payload + payload_len);
+    });
+  }
+
+  std::vector<NodeAddress> sources;
+  std::vector<MessageType> types;
+  std::vector<std::vector<uint8_t>> payloads;
+};
+
+bool feed(SegmentAssembler &assembler, const Frame &frame, uint32_t now) {
+  return assembler.feed(FrameView(frame), now);
+}
+
+}  // namespace
+
+TEST(SegmentAssembler, ShortFrameIsAWholeMessage) {
+  SegmentAssembler assembler;
+  Assembled assembled(assembler);
+  EXPECT_FALSE(feed(assembler, make_frame(FURNACE, MessageType::GET_STATUS_RESPONSE, 0x00, 20), 0));
+  // Bit 6 is reserved, and says nothing about segments
+  EXPECT_FALSE(feed(assembler, make_frame(FURNACE, MessageType::GET_STATUS_RESPONSE, 0x40, 20), 0));
+  EXPECT_TRUE(assembled.payloads.empty());
+}
+
+TEST(SegmentAssembler, ShortFrameEndsTheMessage) {
+  SegmentAssembler assembler;
+  Assembled assembled(assembler);
+  EXPECT_TRUE(feed(assembler, make_frame(FURNACE, MessageType::GET_CONFIGURATION_RESPONSE, 0x00, 240, 0), 0));
+  EXPECT_TRUE(feed(assembler, make_frame(FURNACE, MessageType::GET_CONFIGURATION_RESPONSE, 0x01, 240, 240), 100));
+  EXPECT_TRUE(assembled.payloads.empty());
+  EXPECT_TRUE(feed(assembler, make_frame(FURNACE, MessageType::GET_CONFIGURATION_RESPONSE, 0x02, 20, 480 % 256), 200));
+  ASSERT_EQ(assembled.payloads.size(), 1u);
+  EXPECT_EQ(assembled.sources[0], FURNACE);
+  EXPECT_EQ(assembled.types[0], MessageType::GET_CONFIGURATION_RESPONSE);
+  ASSERT_EQ(assembled.payloads[0].size(), 500u);
+  for (uint32_t i = 0; i < 500; i++) {
+    ASSERT_EQ(assembled.payloads[0][i], i & 0xFF) << "at " << i;
+  }
+  EXPECT_EQ(assembler.get_completed_count(), 1u);
+}
+
+TEST(SegmentAssembler, EmptyFrameEndsTheMessage) {
+  SegmentAssembler assembler;
+  Assembled assembled(assembler);
+  EXPECT_TRUE(feed(assembler, make_frame(FURNACE, MessageType::GET_CONFIGURATION_RESPONSE, 0x00, 240), 0));
+  EXPECT_TRUE(feed(assembler, make_frame(FURNACE, MessageType::GET_CONFIGURATION_RESPONSE, 0x01, 0), 100));
+  ASSERT_EQ(assembled.payloads.size(), 1u);
+  EXPECT_EQ(assembled.payloads[0].size(), 240u);
+}
+
+TEST(SegmentAssembler, LoneFullFrameFinishesOnTimeout) {
+  SegmentAssembler assembler;
+  Assembled assembled(assembler);
+  EXPECT_TRUE(feed(assembler, make_frame(FURNACE, MessageType::GET_CONFIGURATION_RESPONSE, 0x00, 240), 1000));
+  assembler.expire(1000 + SEGMENT_TIMEOUT);
+  EXPECT_TRUE(assembled.payloads.empty());
+  assembler.expire(1000 + SEGMENT_TIMEOUT + 1);
+  ASSERT_EQ(assembled.payloads.size(), 1u);
+  EXPECT_EQ(assembled.payloads[0].size(), 240u);
+  EXPECT_EQ(assembler.get_dropped_count(), 0u);
+}
+
+TEST(SegmentAssembler, LoneFullFrameFinishesOnTheNextFrameFromItsSource) {
+  SegmentAssembler assembler;
+  Assembled assembled(assembler);
+  EXPECT_TRUE(feed(assembler, make_frame(FURNACE, MessageType::GET_CONFIGURATION_RESPONSE, 0x00, 240), 0));
+  // Other sources don't affect it
+  EXPECT_FALSE(feed(assembler, make_frame(THERMOSTAT, MessageType::GET_STATUS_RESPONSE, 0x00, 10), 100));
+  EXPECT_TRUE(assembled.payloads.empty());
+  // The unrelated frame is handed back only after the finished message was passed on
+  EXPECT_FALSE(feed(assembler, make_frame(FURNACE, MessageType::GET_STATUS_RESPONSE, 0x00, 10), 200));
+  ASSERT_EQ(assembled.payloads.size(), 1u);
+  EXPECT_EQ(assembled.types[0], MessageType::GET_CONFIGURATION_RESPONSE);
+  EXPECT_EQ(assembled.payloads[0].size(), 240u);
+}
+
+TEST(SegmentAssembler, NewMessageFinishesThePreviousOne) {
+  SegmentAssembler assembler;
+  Assembled assembled(assembler);
+  EXPECT_TRUE(feed(assembler, make_frame(FURNACE, MessageType::GET_CONFIGURATION_RESPONSE, 0x00, 240, 1), 0));
+  EXPECT_TRUE(feed(assembler, make_frame(FURNACE, MessageType::GET_CONFIGURATION_RESPONSE, 0x00, 240, 2), 100));
+  EXPECT_TRUE(feed(assembler, make_frame(FURNACE, MessageType::GET_CONFIGURATION_RESPONSE, 0x01, 5), 200));
+  ASSERT_EQ(assembled.payloads.size(), 2u);
+  EXPECT_EQ(assembled.payloads[0].size(), 240u);
+  EXPECT_EQ(assembled.payloads[0][0], 1);
+  EXPECT_EQ(assembled.payloads[1].size(), 245u);
+  EXPECT_EQ(assembled.payloads[1][0], 2);
+}
+
+TEST(SegmentAssembler, MissingSegmentDropsTheMessage) {
+  SegmentAssembler assembler;
+  Assembled assembled(assembler);
+  EXPECT_TRUE(feed(assembler, make_frame(FURNACE, MessageType::GET_CONFIGURATION_RESPONSE, 0x00, 240), 0));
+  EXPECT_TRUE(feed(assembler, make_frame(FURNACE, MessageType::GET_CONFIGURATION_RESPONSE, 0x02, 20), 100));
+  assembler.expire(100 + SEGMENT_TIMEOUT + 1);
+  EXPECT_TRUE(assembled.payloads.empty());
+  EXPECT_EQ(assembler.get_dropped_count(), 1u);
+  // A stray segment without a start is ignored
+  EXPECT_TRUE(feed(assembler, make_frame(FURNACE, MessageType::GET_CONFIGURATION_RESPONSE, 0x01, 20), 200));
+  EXPECT_TRUE(assembled.payloads.empty());
+}
+
+TEST(SegmentAssembler, OversizedMessageIsDropped) {
+  SegmentAssembler assembler;
+  Assembled assembled(assembler);
+  uint8_t segment = 0;
+  for (; segment * MAX_PAYLOAD_SIZE < MAX_SEGMENTED_PAYLOAD_SIZE; segment++) {
+    EXPECT_TRUE(feed(assembler, make_frame(FURNACE, MessageType::GET_CONFIGURATION_RESPONSE, segment, 240), 0));
+  }
+  EXPECT_TRUE(feed(assembler, make_frame(FURNACE, MessageType::GET_CONFIGURATION_RESPONSE, segment, 1), 0));
+  EXPECT_TRUE(assembled.payloads.empty());
+  EXPECT_EQ(assembler.get_dropped_count(), 1u);
+}
+
+TEST(SegmentedMessages, SentWithSegmentIndexAndShortLastFrame) {
+  Simulation simulation(1);
+  SimulatedBus *bus = simulation.add_bus();
+  FakeCoordinator coordinator(&simulation, bus);
+  SimulatedNode node(&simulation, bus);
+  esphome::global_preferences->clear();
+  coordinator.add_device(NodeType::GAS_FURNACE,
+                         [](MessageType, const uint8_t *, uint8_t) { return std::vector<uint8_t>{0x00}; });
+  simulation.add_peer([&]() { coordinator.loop(); });
+  node.boot();
+  ASSERT_TRUE(simulation.run_until([&]() { return node.is_joined(); }, JOIN_TIMEOUT));
+
+  std::vector<uint8_t> packet_numbers;
+  std::vector<uint8_t> lengths;
+  bus->set_frame_observer([&](const BusFrame &frame) {
+    if (frame.collided || frame.data.size() < PACKET_HEADER_SIZE) {
+      return;
+    }
+    FrameView view(frame.data.data());
+    if (frame.sender == node.get_uart()->get_id() && view.message_type() == MessageType::SET_USER_MENU) {
+      packet_numbers.push_back(view.packet_number());
+      lengths.push_back(view.payload_length());
+    }
+  });
+  auto send = [&](uint16_t len) {
+    packet_numbers.clear();
+    lengths.clear();
+    std::vector<uint8_t> data(len, 0x5A);
+    uint32_t answered = coordinator.get_routed_count(MessageType::SET_USER_MENU);
+    EXPECT_TRUE(node.get()->queue_segmented_message(SendMethod::NODE_TYPE, static_cast<uint8_t>(NodeType::GAS_FURNACE),
+                                                    MessageType::SET_USER_MENU, data.data(), len));
+    EXPECT_TRUE(simulation.run_until(
+        [&]() { return coordinator.get_routed_count(MessageType::SET_USER_MENU) > answered; }, 60000));
+    // Only the last segment is answered
+    EXPECT_EQ(coordinator.get_routed_count(MessageType::SET_USER_MENU), answered + 1);
+  };
+
+  send(500);
+  ASSERT_EQ(lengths, (std::vector<uint8_t>{240, 240, 20}));
+  for (uint8_t i = 0; i < packet_numbers.size(); i++) {
+    EXPECT_EQ(PACKET_SEGMENT(packet_numbers[i]), i);
+    EXPECT_EQ(packet_numbers[i] & 0x40, 0) << "reserved bit set on segment " << static_cast<int>(i);
+  }
+
+  // A message that fills its last frame is ended with an empty one
+  send(480);
+  ASSERT_EQ(lengths, (std::vector<uint8_t>{240, 240, 0}));
+  for (uint8_t i = 0; i < packet_numbers.size(); i++) {
+    EXPECT_EQ(PACKET_SEGMENT(packet_numbers[i]), i);
+  }
+}
@@ -0,0 +1,249 @@
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <gtest/gtest.h>
+#include "fake_coordinator.h"
+#include "simulated_node.h"
+
+using namespace comfortnet;
+using namespace comfortnet::testing;
+
+namespace {
+
+// Protocol timeouts from comfortnet.cpp, in millis
+const uint32_t SILENCE_TIMEOUT = 60000;
+const uint32_t NETWORK_TIMEOUT = 120000;
+// Long enough for the next discovery cycle plus its discovery and token offer windows
+const uint32_t REJOIN_TIMEOUT = 60000;
+
+std::vector<uint8_t> furnace_status(MessageType, const uint8_t *, uint8_t) { return {0x01, 0x01, 0x64}; }
+
+/**
+ * One Comfortnet polling a furnace through a coordinator on a single bus
+ */
+struct Network {
+  explicit Network(uint32_t seed)
+      : simulation(seed), bus(simulation.add_bus()), coordinator(&simulation, bus), node(&simulation, bus) {
+    esphome::global_preferences->clear();
+    coordinator.add_device(NodeType::GAS_FURNACE, furnace_status);
+    simulation.add_peer([this]() { this->coordinator.loop(); });
+    node.set_configure([](Comfortnet *comfortnet) {
+      comfortnet->register_device_polling(NodeType::GAS_FURNACE, MessageType::GET_STATUS, false, 1000);
+    });
+    node.boot();
+  }
+
+  /**
+   * Whether the node and the coordinator agree on the node's address
+   */
+  bool in_sync() {
+    const CoordinatorMember *member = this->coordinator.find_member(this->node.get()->get_mac_address());
+    return this->node.is_joined() && member != nullptr && member->confirmed &&
+           member->address == this->node.get()->get_node_id();
+  }
+
+  /**
+   * Waits for the node to be in sync at the end of a full cycle, so it holds a fresh address confirmation. A membership
+   * gained during a fault can still run out right after it, so this may take a second trip through discovery.
+   */
+  bool recover(uint32_t timeout) {
+    uint64_t end = this->simulation.now() + static_cast<uint64_t>(timeout) * 1000;
+    while (this->simulation.now() < end) {
+      uint32_t cycles = this->coordinator.get_cycle_count() + 2;
+      this->simulation.run_until([&]() { return this->coordinator.get_cycle_count() >= cycles; }, timeout);
+      if (this->in_sync()) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  Simulation simulation;
+  SimulatedBus *bus;
+  FakeCoordinator coordinator;
+  SimulatedNode node;
+};
+
+uint32_t soak_seed_count() {
+  const char *seeds = std::getenv("COMFORTNET_SOAK_SEEDS");
+  return seeds == nullptr ? 100 : std::strtoul(seeds, nullptr, 10);
+}
+
+}  // namespace
+
+TEST(Soak, JoinsThroughDiscovery) {
+  Network network(1);
+  ASSERT_TRUE(network.simulation.run_until([&]() { return network.in_sync(); }, REJOIN_TIMEOUT));
+  EXPECT_EQ(network.node.get_join_count(), 1u);
+  // Polls are answered once we hold the token
+  ASSERT_TRUE(network.simulation.run_until(
+      [&]() { return network.coordinator.get_routed_count(MessageType::GET_STATUS) >= 3; }, 60000));
+  EXPECT_EQ(network.node.get_drop_count(), 0u);
+}
+
+TEST(Soak, SilenceTimeoutDropsAfterOneMinute) {
+  Network network(2);
+  // The node's own replies don't count, it only times what it reads
+  uint64_t last_heard = 0;
+  network.bus->set_frame_observer([&](const BusFrame &frame) {
+    if (frame.sender != network.node.get_uart()->get_id()) {
+      last_heard = frame.end;
+    }
+  });
+  ASSERT_TRUE(network.simulation.run_until([&]() { return network.in_sync(); }, REJOIN_TIMEOUT));
+  network.coordinator.set_silent(true);
+  ASSERT_TRUE(network.simulation.run_until([&]() { return !network.node.is_joined(); }, SILENCE_TIMEOUT + 5000));
+  uint64_t dropped_after = (network.simulation.now() - last_heard) / 1000;
+  // Both the last read and the timeout check wait for a loop
+  EXPECT_GE(dropped_after, SILENCE_TIMEOUT);
+  EXPECT_LE(dropped_after, SILENCE_TIMEOUT + 2 * DEFAULT_LOOP_INTERVAL + 1);
+
+  network.coordinator.set_silent(false);
+  EXPECT_TRUE(network.simulation.run_until([&]() { return network.in_sync(); }, REJOIN_TIMEOUT));
+}
+
+TEST(Soak, NetworkTimeoutDropsWithoutAddressConfirmation) {
+  Network network(3);
+  ASSERT_TRUE(network.simulation.run_until([&]() { return network.in_sync(); }, REJOIN_TIMEOUT));
+  // Let a confirmation through right before they stop
+  uint32_t cycles = network.coordinator.get_cycle_count();
+  network.simulation.run_until([&]() { return network.coordinator.get_cycle_count() > cycles; }, 20000);
+  network.simulation.run_for(500);
+  network.coordinator.set_confirming(false);
+  uint64_t stopped = network.simulation.now();
+
+  ASSERT_TRUE(network.simulation.run_until([&]() { return !network.node.is_joined(); }, NETWORK_TIMEOUT + 10000));
+  uint64_t dropped_after = (network.simulation.now() - stopped) / 1000;
+  // Dropped 120 s after the last confirmation, which went out shortly before they stopped
+  EXPECT_LE(dropped_after, NETWORK_TIMEOUT);
+  EXPECT_GE(dropped_after, NETWORK_TIMEOUT - 10000);
+
+  network.coordinator.set_confirming(true);
+  EXPECT_TRUE(network.simulation.run_until([&]() { return network.in_sync(); }, REJOIN_TIMEOUT));
+}
+
+TEST(Soak, RebootResumesSavedIdentity) {
+  Network network(4);
+  ASSERT_TRUE(network.simulation.run_until([&]() { return network.in_sync(); }, REJOIN_TIMEOUT));
+  MacAddress mac_address = network.node.get()->get_mac_address();
+  NodeAddress node_id = network.node.get()->get_node_id();
+
+  network.node.boot();
+  EXPECT_EQ(network.node.get()->get_node_id(), node_id);
+  EXPECT_EQ(memcmp(network.node.get()->get_mac_address().mac, mac_address.mac, MAC_ADDRESS_SIZE), 0);
+  ASSERT_TRUE(network.simulation.run_until([&]() { return network.in_sync(); }, REJOIN_TIMEOUT));
+  // Confirmed under its old address, no second trip through discovery
+  EXPECT_EQ(network.coordinator.get_members().size(), 1u);
+  EXPECT_EQ(network.node.get()->get_node_id(), node_id);
+}
+
+TEST(Soak, CoordinatorRebootForcesRejoin) {
+  Network network(5);
+  ASSERT_TRUE(network.simulation.run_until([&]() { return network.in_sync(); }, REJOIN_TIMEOUT));
+  network.coordinator.forget_members();
+  ASSERT_TRUE(network.simulation.run_until([&]() { return !network.node.is_joined(); }, 30000));
+  EXPECT_TRUE(network.simulation.run_until([&]() { return network.in_sync(); }, REJOIN_TIMEOUT));
+  EXPECT_EQ(network.node.get_drop_count(), 1u);
+}
+
+TEST(Soak, SameSeedReplaysTheSameBus) {
+  auto record = [](uint32_t seed) {
+    Network network(seed);
+    std::vector<uint8_t> wire;
+    network.bus->set_frame_observer([&](const BusFrame &frame) {
+      wire.insert(wire.end(), frame.data.begin(), frame.data.end());
+      for (int i = 0; i < 8; i++) {
+        wire.push_back((frame.start >> (8 * i)) & 0xFF);
+      }
+    });
+    network.simulation.run_for(120000);
+    return wire;
+  };
+  EXPECT_EQ(record(7), record(7));
+  // Slot delays are drawn from the clock's seed
+  EXPECT_NE(record(7), record(8));
+}
+
+/**
+ * Runs each seed through a random series of faults, checking after each that the node times out when it should, never
+ * when it shouldn't, and always finds its way back onto the network.
+ *
+ * Set COMFORTNET_SOAK_SEEDS to run more scenarios.
+ */
+TEST(Soak, RandomFaultsAlwaysRecover) {
+  enum Fault {
+    SHORT_SILENCE,
+    LONG_SILENCE,
+    SHORT_UNCONFIRMED,
+    LONG_UNCONFIRMED,
+    COORDINATOR_REBOOT,
+    NODE_REBOOT,
+    NOISE,
+  };
+  const uint32_t seeds = soak_seed_count();
+  uint64_t simulated = 0;
+  for (uint32_t seed = 1; seed <= seeds; seed++) {
+    SCOPED_TRACE("seed " + std::to_string(seed));
+    std::mt19937 plan(seed);
+    auto between = [&plan](uint32_t min, uint32_t max) {
+      return std::uniform_int_distribution<uint32_t>(min, max)(plan);
+    };
+    {
+      Network network(seed);
+      network.coordinator.set_cycle_period(between(2000, 10000));
+      network.coordinator.set_discovery_every(between(1, 3));
+      ASSERT_TRUE(network.recover(2 * REJOIN_TIMEOUT));
+      const MacAddress mac_address = network.node.get()->get_mac_address();
+
+      for (int step = 0; step < 3; step++) {
+        network.simulation.run_for(between(1000, 30000));
+        Fault fault = static_cast<Fault>(between(0, NOISE));
+        SCOPED_TRACE("step " + std::to_string(step) + " fault " + std::to_string(fault));
+        uint32_t drops = network.node.get_drop_count();
+        switch (fault) {
+          case SHORT_SILENCE:
+          case LONG_SILENCE:
+            network.coordinator.set_silent(true);
+            network.simulation.run_for(fault == SHORT_SILENCE ? between(5000, SILENCE_TIMEOUT - 10000)
+                                                              : between(SILENCE_TIMEOUT + 5000, 3 * SILENCE_TIMEOUT));
+            network.coordinator.set_silent(false);
+            EXPECT_EQ(network.node.get_drop_count() > drops, fault == LONG_SILENCE);
+            break;
+          case SHORT_UNCONFIRMED:
+          case LONG_UNCONFIRMED:
+            network.coordinator.set_confirming(false);
+            // The last confirmation can be up to a cycle old when they stop
+            network.simulation.run_for(fault == SHORT_UNCONFIRMED
+                                           ? between(10000, NETWORK_TIMEOUT - 30000)
+                                           : between(NETWORK_TIMEOUT + 5000, 2 * NETWORK_TIMEOUT));
+            network.coordinator.set_confirming(true);
+            EXPECT_EQ(network.node.get_drop_count() > drops, fault == LONG_UNCONFIRMED);
+            break;
+          case COORDINATOR_REBOOT:
+            network.coordinator.forget_members();
+            break;
+          case NODE_REBOOT:
+            network.node.boot();
+            break;
+          case NOISE:
+            network.bus->set_corruption(0.2, seed);
+            network.coordinator.set_ignore_probability(0.2, seed);
+            network.simulation.run_for(between(10000, 60000));
+            network.bus->set_corruption(0.0, seed);
+            network.coordinator.set_ignore_probability(0.0, seed);
+            break;
+        }
+        ASSERT_TRUE(network.recover(2 * REJOIN_TIMEOUT));
+        EXPECT_EQ(memcmp(network.node.get()->get_mac_address().mac, mac_address.mac, MAC_ADDRESS_SIZE), 0);
+      }
+      // Still getting its data once things settle
+      uint32_t polls = network.coordinator.get_routed_count(MessageType::GET_STATUS);
+      EXPECT_TRUE(network.simulation.run_until(
+          [&]() { return network.coordinator.get_routed_count(MessageType::GET_STATUS) > polls; }, 60000));
+      simulated += network.simulation.now();
+    }
+    // Nothing queued outlives the node
+    EXPECT_EQ(PayloadPool::get_blocks_in_use(), 0);
+  }
+  printf("Soaked %u seeds through %.1f hours of bus time\n", seeds, simulated / 3.6e9);
+}
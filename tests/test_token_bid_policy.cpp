@@ -0,0 +1,76 @@
+#include <gtest/gtest.h>
+#include "token_bid_policy.h"
+
+using namespace comfortnet;
+
+namespace {
+
+BidBacklog polls_only() {
+  BidBacklog backlog;
+  backlog.pending_messages = 1;
+  backlog.top_priority = MessagePriority::BACKGROUND;
+  backlog.has_due_poll = true;
+  return backlog;
+}
+
+BidBacklog urgent() {
+  BidBacklog backlog;
+  backlog.pending_messages = 3;
+  backlog.top_priority = MessagePriority::URGENT;
+  return backlog;
+}
+
+/**
+ * Runs one dataflow cycle of token offers, returning how many of them we won
+ */
+uint32_t offer_cycle(TokenBidPolicy &policy, const BidBacklog &backlog, uint32_t offers) {
+  policy.on_cycle();
+  uint32_t wins = 0;
+  for (uint32_t i = 0; i < offers; i++) {
+    policy.on_offer();
+    if (policy.should_bid(backlog)) {
+      policy.on_granted();
+      wins++;
+    }
+  }
+  return wins;
+}
+
+}  // namespace
+
+TEST(TokenBidPolicy, PollsBidOnEveryCycle) {
+  TokenBidPolicy policy;
+  for (int cycle = 0; cycle < 20; cycle++) {
+    EXPECT_EQ(offer_cycle(policy, polls_only(), 5), 1u) << "cycle " << cycle;
+  }
+}
+
+TEST(TokenBidPolicy, FirstBidAfterResetIsOpen) {
+  TokenBidPolicy policy;
+  offer_cycle(policy, urgent(), 10);
+  policy.reset();
+  EXPECT_TRUE(policy.should_bid(polls_only()));
+}
+
+TEST(TokenBidPolicy, UrgentBacklogBurstsOnSavedCredits) {
+  TokenBidPolicy policy;
+  // Quiet cycles bank credits
+  for (int cycle = 0; cycle < 10; cycle++) {
+    offer_cycle(policy, BidBacklog{}, 5);
+  }
+  // The free first win, plus one per banked credit
+  EXPECT_EQ(offer_cycle(policy, urgent(), 10), 5u);
+  // Then one credit a cycle pays for one extra win
+  EXPECT_EQ(offer_cycle(policy, urgent(), 10), 2u);
+}
+
+TEST(TokenBidPolicy, BackgroundWorkNeverBidsTwiceInACycle) {
+  TokenBidPolicy policy;
+  for (int cycle = 0; cycle < 10; cycle++) {
+    offer_cycle(policy, BidBacklog{}, 5);
+  }
+  BidBacklog backlog = polls_only();
+  backlog.pending_messages = 8;
+  backlog.oldest_age = 60000;
+  EXPECT_EQ(offer_cycle(policy, backlog, 10), 1u);
+}
@@ -0,0 +1,114 @@
+#include <gtest/gtest.h>
+#include "fake_coordinator.h"
+#include "simulated_node.h"
+#include "turnaround_recorder.h"
+
+using namespace comfortnet;
+using namespace comfortnet::testing;
+
+namespace {
+
+// From comfortnet.cpp, the bus must be quiet this long before an arbitrated or unprompted frame
+const uint32_t MINIMUM_SLOT_DELAY = 100;
+const uint32_t MEASURE_TIME = 600000;
+
+std::vector<uint8_t> furnace_status(MessageType, const uint8_t *, uint8_t) { return {0x01, 0x01, 0x64}; }
+
+struct Network {
+  Network(uint32_t seed, uint32_t loop_interval, uint32_t reply_delay = DEFAULT_REPLY_DELAY)
+      : simulation(seed), bus(simulation.add_bus()), coordinator(&simulation, bus), node(&simulation, bus) {
+    esphome::global_preferences->clear();
+    this->simulation.set_loop_interval(loop_interval);
+    this->coordinator.add_device(NodeType::GAS_FURNACE, furnace_status);
+    this->simulation.add_peer([this]() { this->coordinator.loop(); });
+    this->node.set_configure([reply_delay](Comfortnet *comfortnet) {
+      comfortnet->set_reply_delay(reply_delay);
+      comfortnet->register_device_polling(NodeType::GAS_FURNACE, MessageType::GET_STATUS, false, 1000);
+    });
+  }
+
+  Simulation simulation;
+  SimulatedBus *bus;
+  FakeCoordinator coordinator;
+  SimulatedNode node;
+};
+
+void print_distribution(const char *name, const TurnaroundRecorder &recorder) {
+  printf("%s: %zu replies, min %.2f ms, median %.2f ms, p99 %.2f ms, max %.2f ms\n", name, recorder.size(),
+         recorder.min() / 1000.0, recorder.percentile(0.5) / 1000.0, recorder.percentile(0.99) / 1000.0,
+         recorder.max() / 1000.0);
+}
+
+/**
+ * R2R turnaround in steady state
+ */
+TurnaroundRecorder measure_r2r(const char *name, uint32_t loop_interval, uint32_t reply_delay) {
+  Network network(21, loop_interval, reply_delay);
+  TurnaroundRecorder recorder(network.bus, network.node.get_uart());
+  network.node.boot();
+  network.simulation.run_for(MEASURE_TIME);
+  print_distribution(name, recorder);
+  EXPECT_GT(recorder.size(), 50u);
+  return recorder;
+}
+
+}  // namespace
+
+TEST(Turnaround, FastLoopRepliesRightAfterTheGap) {
+  TurnaroundRecorder recorder = measure_r2r("1 ms loop", 1, DEFAULT_REPLY_DELAY);
+  // The delay is checked in whole millis against the loop that read the R2R's last byte
+  EXPECT_GT(recorder.min(), DEFAULT_REPLY_DELAY * 1000);
+  EXPECT_LE(recorder.max(), (DEFAULT_REPLY_DELAY + 3) * 1000);
+}
+
+TEST(Turnaround, DefaultLoopStaysWellUnderTheSlotDelay) {
+  TurnaroundRecorder recorder = measure_r2r("16 ms loop", DEFAULT_LOOP_INTERVAL, DEFAULT_REPLY_DELAY);
+  EXPECT_GT(recorder.min(), DEFAULT_REPLY_DELAY * 1000);
+  // One loop to read the R2R, and one after the delay to send
+  EXPECT_LE(recorder.max(), (DEFAULT_REPLY_DELAY + 2 * DEFAULT_LOOP_INTERVAL + 2) * 1000);
+  EXPECT_LT(recorder.max(), MINIMUM_SLOT_DELAY * 1000);
+}
+
+TEST(Turnaround, ConfiguredGapIsHonoured) {
+  TurnaroundRecorder recorder = measure_r2r("40 ms gap", 1, 40);
+  EXPECT_GT(recorder.min(), 40 * 1000);
+  EXPECT_LE(recorder.max(), (40 + 3) * 1000);
+}
+
+TEST(Turnaround, AckToRoutedResponseUsesTheGap) {
+  Network network(22, 1);
+  // The stand-in furnace answers each poll, and we ACK it
+  TurnaroundRecorder recorder(network.bus, network.node.get_uart(),
+                              TurnaroundRecorder::is_message(PACKET_RESPONSE(MessageType::GET_STATUS)));
+  network.node.boot();
+  network.simulation.run_for(MEASURE_TIME);
+  print_distribution("ACK", recorder);
+  ASSERT_GT(recorder.size(), 0u);
+  EXPECT_GT(recorder.min(), DEFAULT_REPLY_DELAY * 1000);
+  EXPECT_LE(recorder.max(), (DEFAULT_REPLY_DELAY + 3) * 1000);
+}
+
+TEST(Turnaround, SetAddressResponseKeepsTheSlotDelay) {
+  for (uint32_t seed = 1; seed <= 10; seed++) {
+    Network network(seed, 1);
+    TurnaroundRecorder recorder(network.bus, network.node.get_uart(),
+                                TurnaroundRecorder::is_message(MessageType::SET_ADDRESS));
+    network.node.boot();
+    ASSERT_TRUE(network.simulation.run_until([&]() { return recorder.size() > 0; }, 60000));
+    EXPECT_GT(recorder.min(), MINIMUM_SLOT_DELAY * 1000);
+  }
+}
+
+TEST(Turnaround, ArbitratedFramesKeepTheSlotDelay) {
+  uint64_t shortest = UINT64_MAX;
+  for (uint32_t seed = 1; seed <= 20; seed++) {
+    Network network(seed, 1);
+    TurnaroundRecorder recorder(network.bus, network.node.get_uart(),
+                                TurnaroundRecorder::is_message(MessageType::NODE_DISCOVERY));
+    network.node.boot();
+    ASSERT_TRUE(network.simulation.run_until([&]() { return recorder.size() > 0; }, 60000));
+    shortest = std::min(shortest, recorder.min());
+  }
+  printf("Discovery responses: shortest gap %.2f ms\n", shortest / 1000.0);
+  EXPECT_GT(shortest, MINIMUM_SLOT_DELAY * 1000);
+}